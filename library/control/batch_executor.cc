@@ -19,9 +19,9 @@
 #include "signal_handler.hh"
 
 //external includes
+#include <algorithm>
 #include <chrono>
 #include <signal.h>
-#include <thread>
 
 namespace sandfly
 {
@@ -32,8 +32,21 @@ namespace sandfly
             control_access(),
             scarab::cancelable(),
             f_batch_commands(),
+            f_max_concurrent_actions( 8 ),
             f_request_receiver(),
             f_action_queue(),
+            f_delayed_actions(),
+            f_blocked_actions(),
+            f_unfinished_actions(),
+            f_action_ids(),
+            f_next_sequence( 0 ),
+            f_queue_generation( 0 ),
+            f_hold_until(),
+            f_running_actions(),
+            f_finished_actions(),
+            f_action_error(),
+            f_queue_mutex(),
+            f_queue_condition(),
             f_condition_actions()
     {
     }
@@ -42,10 +55,25 @@ namespace sandfly
             control_access(),
             scarab::cancelable(),
             f_batch_commands( a_config[ "batch-commands" ].as_node() ),
+            f_max_concurrent_actions( a_config.get_value( "batch-max-concurrent", 8U ) ),
             f_request_receiver( a_request_receiver ),
             f_action_queue(),
+            f_delayed_actions(),
+            f_blocked_actions(),
+            f_unfinished_actions(),
+            f_action_ids(),
+            f_next_sequence( 0 ),
+            f_queue_generation( 0 ),
+            f_hold_until(),
+            f_running_actions(),
+            f_finished_actions(),
+            f_action_error(),
+            f_queue_mutex(),
+            f_queue_condition(),
             f_condition_actions()
     {
+        if( f_max_concurrent_actions == 0 ) f_max_concurrent_actions = 1;
+
         if ( a_config.has( "on-startup" ) )
         {
             LINFO( plog, "have an initial action array" );
@@ -66,30 +94,54 @@ namespace sandfly
 
     batch_executor::~batch_executor()
     {
+        finish_running_actions();
+    }
+
+    bool batch_executor::scheduled_action_compare::operator()( const scheduled_action& a_lhs, const scheduled_action& a_rhs ) const
+    {
+        // returns true if a_lhs should be executed after a_rhs
+        if( a_lhs.f_action.f_priority != a_rhs.f_action.f_priority ) return a_lhs.f_action.f_priority < a_rhs.f_action.f_priority;
+        return a_lhs.f_sequence > a_rhs.f_sequence;
     }
 
     void batch_executor::clear_queue()
     {
-        action_info t_action;
-        while ( f_action_queue.try_pop( t_action ) )
+        std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+        // running actions remain unfinished
+        while( ! f_action_queue.empty() )
         {
+            f_unfinished_actions.erase( f_action_queue.top().f_sequence );
+            f_action_queue.pop();
         }
+        for( delayed_actions_t::const_iterator t_it = f_delayed_actions.begin(); t_it != f_delayed_actions.end(); ++t_it )
+        {
+            f_unfinished_actions.erase( t_it->second.f_sequence );
+        }
+        f_delayed_actions.clear();
+        for( std::map< unsigned long, scheduled_action >::const_iterator t_it = f_blocked_actions.begin(); t_it != f_blocked_actions.end(); ++t_it )
+        {
+            f_unfinished_actions.erase( t_it->first );
+        }
+        f_blocked_actions.clear();
     }
 
     void batch_executor::add_to_queue( const scarab::param_node& an_action )
     {
-        f_action_queue.push( parse_action( an_action ) );
+        queue_actions( std::vector< action_info >( 1, parse_action( an_action ) ) );
     }
 
     void batch_executor::add_to_queue( const scarab::param_array& actions_array )
     {
+        // parse everything first so that an invalid action does not leave part of the array queued
+        std::vector< action_info > t_actions;
         for( scarab::param_array::const_iterator action_it = actions_array.begin();
               action_it!=actions_array.end();
               ++action_it )
         {
             LDEBUG( plog, "adding an item: " << action_it->as_node() )
-            add_to_queue( action_it->as_node() );
+            t_actions.push_back( parse_action( action_it->as_node() ) );
         }
+        queue_actions( t_actions );
     }
 
     void batch_executor::add_to_queue( const std::string& a_batch_command_name )
@@ -106,22 +158,110 @@ namespace sandfly
 
     void batch_executor::replace_queue( const scarab::param_node& an_action )
     {
-        clear_queue();
+        abort_current_action();
         add_to_queue( an_action );
     }
 
     void batch_executor::replace_queue( const scarab::param_array& actions_array )
     {
-        clear_queue();
+        abort_current_action();
         add_to_queue( actions_array );
     }
 
     void batch_executor::replace_queue( const std::string& a_batch_command_name )
     {
-        clear_queue();
+        abort_current_action();
         add_to_queue( a_batch_command_name );
     }
 
+    void batch_executor::queue_actions( const std::vector< action_info >& a_actions )
+    {
+        time_point_t t_now = std::chrono::steady_clock::now();
+
+        std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+
+        // check the dependencies before queuing anything; ids have to be defined by earlier actions
+        std::set< std::string > t_new_ids;
+        for( std::vector< action_info >::const_iterator t_it = a_actions.begin(); t_it != a_actions.end(); ++t_it )
+        {
+            for( std::vector< std::string >::const_iterator t_after_it = t_it->f_after.begin(); t_after_it != t_it->f_after.end(); ++t_after_it )
+            {
+                if( t_new_ids.count( *t_after_it ) == 0 && f_action_ids.count( *t_after_it ) == 0 )
+                {
+                    throw error() << "Batch action depends on unknown action <" << *t_after_it << ">";
+                }
+            }
+            if( ! t_it->f_id.empty() ) t_new_ids.insert( t_it->f_id );
+        }
+
+        for( std::vector< action_info >::const_iterator t_it = a_actions.begin(); t_it != a_actions.end(); ++t_it )
+        {
+            scheduled_action t_scheduled;
+            t_scheduled.f_action = *t_it;
+            t_scheduled.f_not_before = t_now + std::chrono::milliseconds( t_it->f_delay_ms );
+            t_scheduled.f_sequence = f_next_sequence++;
+
+            // dependencies that are already complete are ignored
+            if( t_it->f_after_previous )
+            {
+                if( t_scheduled.f_sequence > 0 && f_unfinished_actions.count( t_scheduled.f_sequence - 1 ) != 0 )
+                {
+                    t_scheduled.f_waiting_for.insert( t_scheduled.f_sequence - 1 );
+                }
+            }
+            else
+            {
+                for( std::vector< std::string >::const_iterator t_after_it = t_it->f_after.begin(); t_after_it != t_it->f_after.end(); ++t_after_it )
+                {
+                    unsigned long t_dependency = f_action_ids[ *t_after_it ];
+                    if( f_unfinished_actions.count( t_dependency ) != 0 ) t_scheduled.f_waiting_for.insert( t_dependency );
+                }
+            }
+
+            if( ! t_it->f_id.empty() ) f_action_ids[ t_it->f_id ] = t_scheduled.f_sequence;
+            f_unfinished_actions.insert( t_scheduled.f_sequence );
+
+            if( t_scheduled.f_waiting_for.empty() ) schedule_action( t_scheduled, t_now );
+            else f_blocked_actions[ t_scheduled.f_sequence ] = t_scheduled;
+        }
+        f_queue_condition.notify_all();
+        return;
+    }
+
+    void batch_executor::abort_current_action()
+    {
+        {
+            std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+            f_action_queue = action_queue_t();
+            f_delayed_actions.clear();
+            f_blocked_actions.clear();
+            f_unfinished_actions.clear();
+            f_action_ids.clear();
+            ++f_queue_generation;
+            f_hold_until = std::chrono::steady_clock::now();
+            f_queue_condition.notify_all();
+        }
+        // a wait-for action waits on the run_control status
+        if( ! run_control_expired() ) use_run_control()->notify_status_waiters();
+        return;
+    }
+
+    unsigned batch_executor::queue_size() const
+    {
+        std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+        return f_action_queue.size() + f_delayed_actions.size() + f_blocked_actions.size();
+    }
+
+    void batch_executor::do_cancellation( int )
+    {
+        {
+            std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+            f_queue_condition.notify_all();
+        }
+        if( ! run_control_expired() ) use_run_control()->notify_status_waiters();
+        return;
+    }
+
     // this method should be bound in the request receiver to be called with a command name, the request_ptr_t is not used
     dripline::reply_ptr_t batch_executor::do_batch_cmd_request( const std::string& a_command, const dripline::request_ptr_t a_request )
     {
@@ -129,7 +269,8 @@ namespace sandfly
         {
             add_to_queue( a_command );
         }
-        catch( dripline::dripline_error& e )
+        // queue_actions() throws sandfly::error for a bad action (e.g. an unknown "after" id), so catch everything
+        catch( std::exception& e )
         {
             return a_request->reply( dl_sandfly_error(), std::string("Error processing command: ") + e.what() );
         }
@@ -141,10 +282,11 @@ namespace sandfly
     {
         try
         {
-            //TODO do we have a good way to interrupt an ongoing action here?
+            // replace_queue() also aborts the action in progress
             replace_queue( a_command );
         }
-        catch( dripline::dripline_error& e )
+        // queue_actions() throws sandfly::error for a bad action (e.g. an unknown "after" id), so catch everything
+        catch( std::exception& e )
         {
             return a_request->reply( dl_sandfly_error(), std::string("Error processing command: ") + e.what() );
         }
@@ -153,14 +295,22 @@ namespace sandfly
 
     /* considering yaml that looks like:
     batch-actions:
+        - type: set
+          id: config-str0 # optional name used by "after"
+          after: [] # optional; does not wait for the previous action
+          key: active-config
+          specifier: str0.nodeA.param
+          payload:
+            values: [ 1 ]
         - type: cmd
           sleep-for: 500 # [ms], optional element to specify the sleep after issuing the cmd, before proceeding to the next.
+          after: [ config-str0, config-str1 ]
           key: start-run
           payload:
             duration: 200
             filenames: '["/tmp/foo_t.yaml", "/tmp/foo_f.yaml"]'
     */
-    void batch_executor::execute( std::condition_variable& a_run_control_ready_cv, std::mutex& a_run_control_ready_mutex, bool a_run_forever )
+    void batch_executor::execute( std::condition_variable&, std::mutex&, bool a_run_forever )
     {
         if( run_control_expired() )
         {
@@ -170,22 +320,20 @@ namespace sandfly
         }
         dc_ptr_t t_run_control_ptr = use_run_control();
 
-        while ( ! t_run_control_ptr->is_ready_at_startup() && ! is_canceled() )
-        {
-            std::unique_lock< std::mutex > t_run_control_lock( a_run_control_ready_mutex );
-            a_run_control_ready_cv.wait_for( t_run_control_lock, std::chrono::seconds(1) );
-        }
+        // readiness depends on the run_control status; do_cancellation() wakes this up if we're canceled first
+        t_run_control_ptr->wait_for_status( [this, t_run_control_ptr]( run_control::status ){
+                    return t_run_control_ptr->is_ready_at_startup() || is_canceled();
+                } );
 
         LINFO( plog, "Batch executor is starting to execute actions" );
 
         try
         {
-            while ( ( a_run_forever || f_action_queue.size() ) && ! is_canceled() )
+            scheduled_action t_action;
+            unsigned t_generation = 0;
+            while ( wait_for_action( t_action, t_generation, a_run_forever ) )
             {
-                if ( f_action_queue.size() )
-                {
-                    do_an_action();
-                }
+                start_action( t_action, t_generation );
             }
         }
         catch( error& e )
@@ -209,23 +357,170 @@ namespace sandfly
             scarab::signal_handler::exit( RETURN_ERROR );
         }
 
+        finish_running_actions();
+
         LINFO( plog, "Batch executor has completed action execution" );
 
         return;
     }
 
-    void batch_executor::do_an_action()
+    bool batch_executor::wait_for_action( scheduled_action& a_action, unsigned& a_generation, bool a_wait_for_more )
     {
-        action_info t_action;
-        if ( !f_action_queue.try_pop( t_action ) )
+        std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+        while( ! is_canceled() )
         {
-            LDEBUG( plog, "there are no actions in the queue" );
-            return;
+            // clean up after the actions that are done; their threads have released the lock, so get() returns immediately
+            for( std::vector< unsigned long >::const_iterator t_it = f_finished_actions.begin(); t_it != f_finished_actions.end(); ++t_it )
+            {
+                std::map< unsigned long, std::future< void > >::iterator t_running_it = f_running_actions.find( *t_it );
+                if( t_running_it == f_running_actions.end() ) continue;
+                t_running_it->second.get();
+                f_running_actions.erase( t_running_it );
+            }
+            f_finished_actions.clear();
+
+            if( f_action_error )
+            {
+                std::exception_ptr t_error = f_action_error;
+                f_action_error = nullptr;
+                std::rethrow_exception( t_error );
+            }
+
+            // actions that have become due join the ready queue, where they're ordered by priority
+            time_point_t t_now = std::chrono::steady_clock::now();
+            while( ! f_delayed_actions.empty() && f_delayed_actions.begin()->first <= t_now )
+            {
+                f_action_queue.push( f_delayed_actions.begin()->second );
+                f_delayed_actions.erase( f_delayed_actions.begin() );
+            }
+
+            if( f_action_queue.empty() )
+            {
+                if( ! f_delayed_actions.empty() )
+                {
+                    // woken early if an action becomes ready, the queue is replaced, or the executor is canceled
+                    f_queue_condition.wait_until( t_lock, f_delayed_actions.begin()->first );
+                    continue;
+                }
+                if( ! a_wait_for_more && f_blocked_actions.empty() && f_running_actions.empty() )
+                {
+                    // finish the sleep after the last action before reporting that we're done
+                    if( t_now < f_hold_until )
+                    {
+                        f_queue_condition.wait_until( t_lock, f_hold_until );
+                        continue;
+                    }
+                    LDEBUG( plog, "there are no actions in the queue" );
+                    return false;
+                }
+                f_queue_condition.wait( t_lock );
+                continue;
+            }
+
+            if( f_running_actions.size() >= f_max_concurrent_actions )
+            {
+                f_queue_condition.wait( t_lock );
+                continue;
+            }
+
+            a_action = f_action_queue.top();
+            f_action_queue.pop();
+            a_generation = f_queue_generation;
+            return true;
+        }
+        return false;
+    }
+
+    void batch_executor::schedule_action( const scheduled_action& a_action, const time_point_t& a_now )
+    {
+        if( a_action.f_not_before <= a_now ) f_action_queue.push( a_action );
+        else f_delayed_actions.insert( delayed_actions_t::value_type( a_action.f_not_before, a_action ) );
+        return;
+    }
+
+    void batch_executor::start_action( const scheduled_action& a_action, unsigned a_generation )
+    {
+        // the action's thread needs the lock to report that it's done, so it can't finish before its future is stored
+        std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+        f_running_actions[ a_action.f_sequence ] = std::async( std::launch::async, &batch_executor::run_action, this, a_action, a_generation );
+        return;
+    }
+
+    void batch_executor::run_action( scheduled_action a_action, unsigned a_generation )
+    {
+        std::exception_ptr t_error;
+        try
+        {
+            do_an_action( a_action.f_action, a_generation );
+        }
+        catch( ... )
+        {
+            t_error = std::current_exception();
+        }
+
+        std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+        f_finished_actions.push_back( a_action.f_sequence );
+        if( t_error )
+        {
+            // the dependents are not released; the executing thread rethrows the error
+            if( ! f_action_error ) f_action_error = t_error;
+        }
+        else if( a_generation == f_queue_generation )
+        {
+            // hold back the dependents rather than sleeping here, so that the hold can be interrupted
+            time_point_t t_release_time = std::chrono::steady_clock::now() + std::chrono::milliseconds( a_action.f_action.f_sleep_duration_ms );
+            f_hold_until = std::max( f_hold_until, t_release_time );
+            release_dependents( a_action.f_sequence, t_release_time );
+        }
+        f_queue_condition.notify_all();
+        return;
+    }
+
+    void batch_executor::release_dependents( unsigned long a_sequence, const time_point_t& a_release_time )
+    {
+        f_unfinished_actions.erase( a_sequence );
+
+        std::map< unsigned long, scheduled_action >::iterator t_it = f_blocked_actions.begin();
+        while( t_it != f_blocked_actions.end() )
+        {
+            if( t_it->second.f_waiting_for.erase( a_sequence ) == 0 )
+            {
+                ++t_it;
+                continue;
+            }
+            t_it->second.f_not_before = std::max( t_it->second.f_not_before, a_release_time );
+            if( ! t_it->second.f_waiting_for.empty() )
+            {
+                ++t_it;
+                continue;
+            }
+            // an action held back by a sleep waits with the delayed actions, so it doesn't hold back actions that are ready
+            schedule_action( t_it->second, std::chrono::steady_clock::now() );
+            t_it = f_blocked_actions.erase( t_it );
         }
+        return;
+    }
+
+    void batch_executor::finish_running_actions()
+    {
+        std::map< unsigned long, std::future< void > > t_running;
+        {
+            std::unique_lock< std::mutex > t_lock( f_queue_mutex );
+            t_running.swap( f_running_actions );
+        }
+        // waits for each action's thread
+        for( std::map< unsigned long, std::future< void > >::iterator t_it = t_running.begin(); t_it != t_running.end(); ++t_it )
+        {
+            t_it->second.wait();
+        }
+        return;
+    }
 
-        LINFO( plog, "Running action:\n" << *t_action.f_request_ptr );
+    void batch_executor::do_an_action( const action_info& a_action, unsigned a_generation )
+    {
+        LINFO( plog, "Running action:\n" << *a_action.f_request_ptr );
 
-        dripline::reply_ptr_t t_request_reply = f_request_receiver->submit_request_message( t_action.f_request_ptr );
+        dripline::reply_ptr_t t_request_reply = f_request_receiver->submit_request_message( a_action.f_request_ptr );
         if ( ! t_request_reply )
         {
             LWARN( plog, "failed submitting action request" );
@@ -233,20 +528,28 @@ namespace sandfly
         }
 
         // wait until daq status is no longer "running"
-        if ( t_action.f_is_custom_action )
+        if ( a_action.f_is_custom_action )
         {
             run_control::status t_status = run_control::uint_to_status( t_request_reply->payload()["server"]["status-value"]().as_uint() );
-            while ( t_status == run_control::status::running )
+            if ( t_status == run_control::status::running )
             {
-                t_request_reply = f_request_receiver->submit_request_message( t_action.f_request_ptr );
-                t_status = run_control::uint_to_status( t_request_reply->payload()["server"]["status-value"]().as_uint() );
-                std::this_thread::sleep_for( std::chrono::milliseconds( t_action.f_sleep_duration_ms ) );
+                if( run_control_expired() )
+                {
+                    throw error() << "Unable to get access to the DAQ control";
+                }
+                // wakes up on the status transition rather than polling
+                use_run_control()->wait_for_status( [this, a_generation]( run_control::status a_status ){
+                            return a_status != run_control::status::running || is_canceled() || a_generation != f_queue_generation.load();
+                        } );
+                if( is_canceled() || a_generation != f_queue_generation.load() )
+                {
+                    LINFO( plog, "wait-for action was aborted" );
+                    return;
+                }
+                t_request_reply = f_request_receiver->submit_request_message( a_action.f_request_ptr );
             }
         }
-        else
-        {
-            std::this_thread::sleep_for( std::chrono::milliseconds( t_action.f_sleep_duration_ms ) );
-        }
+
         if ( t_request_reply->get_return_code() >= 100 )
         {
             LWARN( plog, "batch action received an error-level return code; exiting" );
@@ -270,8 +573,26 @@ namespace sandfly
 
         action_info t_action_info;
         t_action_info.f_sleep_duration_ms = a_action.get_value( "sleep-for", 500 );
+        t_action_info.f_delay_ms = a_action.get_value( "delay", 0 );
+        t_action_info.f_priority = a_action.get_value( "priority", 0 );
         t_action_info.f_is_custom_action = false;
 
+        t_action_info.f_id = a_action.get_value( "id", "" );
+        t_action_info.f_after_previous = ! a_action.has( "after" );
+        if ( ! t_action_info.f_after_previous )
+        {
+            if ( ! a_action["after"].is_array() )
+            {
+                LERROR( plog, "after must be a param_array" );
+                throw error() << "batch action dependencies (after) must be an array";
+            }
+            const scarab::param_array& t_after = a_action["after"].as_array();
+            for( scarab::param_array::const_iterator t_after_it = t_after.begin(); t_after_it != t_after.end(); ++t_after_it )
+            {
+                t_action_info.f_after.push_back( (*t_after_it)().as_string() );
+            }
+        }
+
         dripline::op_t t_msg_op;
         try
         {
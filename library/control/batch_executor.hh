@@ -12,13 +12,22 @@
 
 // scarab includes
 #include "cancelable.hh"
-#include "concurrent_queue.hh"
 #include "param.hh"
 
 // dripline
 #include "message.hh"
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <exception>
+#include <future>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace sandfly
 {
@@ -26,13 +35,13 @@ namespace sandfly
      @class batch_executor
      @author B. H. LaRoque
 
-     @brief A class sequentially execute a list of actions, equivalent to a sequence of dripline requests
+     @brief A class to execute a list of actions, equivalent to a sequence of dripline requests
 
      @details
 
     batch_executor is a control component used to submit a pre-defined sequence of requests upon startup and in a non-interactive way.
     This allows submission of any request which would normally be sent via a dripline request.
-    It can also supports (currently one) custom command (type = wait-for), which will poll the provided routing key and wait for the return payload to not indicate a daq_status of running.
+    It can also supports (currently one) custom command (type = wait-for), which waits for the daq status to not be running; it is woken by the run_control status transition rather than by polling.
 
     The actions taken are defined in the top-level param_node of the config file named "batch-actions", which must be of type array.
     Each element of the array is expected to be another param_node and have the following keys:
@@ -40,7 +49,25 @@ namespace sandfly
     - key (str): routing key for the desired action
     - specifier (str): specifier for the desired action (if applicable)
     - payload (param_node): request message payload content for the action
-    - sleep-for (int) [optional]: time in milliseconds for which the thread will sleep after receiving a reply on the specified request. Note i) that each request blocks until a reply is generated, but triggered actions may or may not be ongoing; ii) the "wait-for" action type sleeps this much time after *each* poll.
+    - sleep-for (int) [optional]: time in milliseconds for which the thread will sleep after receiving a reply on the specified request. Note i) that each request blocks until a reply is generated, but triggered actions may or may not be ongoing; ii) for the "wait-for" action type, the sleep starts when the wait is over.
+    - delay (int) [optional]: time in milliseconds after the action is queued before it may be executed
+    - priority (int) [optional]: among the actions that are ready to run, actions with a higher priority are executed first; actions with equal priority are executed in the order they were queued (default is 0)
+    - id (str) [optional]: name by which later actions can refer to this action
+    - after (array of str) [optional]: ids of the actions that must be complete before this action is executed;
+      an empty array means the action does not wait for any other action.
+      If "after" is not given, the action waits for the previously queued action, so by default actions are executed sequentially.
+      The ids must belong to actions that were queued earlier, so the dependencies cannot form a cycle.
+
+    Actions whose dependencies are complete are started concurrently, up to "batch-max-concurrent" (top-level config; default is 8) at a time.
+    The request_receiver still handles mutating requests (set and cmd) one at a time, so those actions are serialized when they are handled;
+    what overlaps is their waiting in the lane with get requests, "wait-for" actions, and post-action sleeps.
+    Independence therefore doesn't make configuring nodes in different streams faster, but it keeps a slow or waiting action from holding back the others.
+
+    Queued actions are held by a scheduler: the executing thread blocks until the next action is due, so an idle executor does not use the CPU.
+    Sleeping after an action is implemented by holding back the actions that depend on it, and can be interrupted;
+    actions that don't depend on it are executed in the meantime.
+    When the queue is replaced (replace_queue), the action in progress is aborted as soon as it is waiting (e.g. a "wait-for" action or a post-action sleep);
+    a request that has already been submitted runs to completion.
 
     */
 
@@ -53,6 +80,11 @@ namespace sandfly
         bool f_is_custom_action;
         dripline::request_ptr_t f_request_ptr;
         unsigned f_sleep_duration_ms;
+        unsigned f_delay_ms;
+        int f_priority;
+        std::string f_id;
+        std::vector< std::string > f_after;
+        bool f_after_previous; // true if "after" was not specified: the action depends on the previously queued action
     };
 
     // local content
@@ -73,18 +105,75 @@ namespace sandfly
             void replace_queue( const scarab::param_node& an_action );
             void replace_queue( const scarab::param_array& actions_array );
             void replace_queue( const std::string& a_batch_command_name );
+            /// Empties the queue and aborts the action in progress
+            void abort_current_action();
+
+            /// Number of actions waiting to be executed (including those waiting for their dependencies)
+            unsigned queue_size() const;
+
+            /// Maximum number of actions executed at the same time
+            mv_accessible( unsigned, max_concurrent_actions );
 
             dripline::reply_ptr_t do_batch_cmd_request( const std::string& a_command, const dripline::request_ptr_t a_request );
             dripline::reply_ptr_t do_replace_actions_request( const std::string& a_command, const dripline::request_ptr_t a_request );
 
             void execute( std::condition_variable& a_run_control_ready_cv, std::mutex& a_run_control_ready_mutex, bool a_run_forever = false );
 
-        private:
+        protected:
+            virtual void do_cancellation( int a_code );
+
+            typedef std::chrono::steady_clock::time_point time_point_t;
+
+            struct scheduled_action
+            {
+                action_info f_action;
+                time_point_t f_not_before;
+                unsigned long f_sequence;
+                std::set< unsigned long > f_waiting_for; // sequence numbers of the unfinished dependencies
+            };
+            // orders the queue so that the top is the action with the highest priority, and the earliest queued among those
+            struct scheduled_action_compare
+            {
+                bool operator()( const scheduled_action& a_lhs, const scheduled_action& a_rhs ) const;
+            };
+            typedef std::priority_queue< scheduled_action, std::vector< scheduled_action >, scheduled_action_compare > action_queue_t;
+            typedef std::multimap< time_point_t, scheduled_action > delayed_actions_t;
+
             std::shared_ptr<request_receiver> f_request_receiver;
-            scarab::concurrent_queue< action_info > f_action_queue;
+            action_queue_t f_action_queue; // actions whose dependencies are complete and that are due
+            delayed_actions_t f_delayed_actions; // actions whose dependencies are complete, by the time at which they're due
+            std::map< unsigned long, scheduled_action > f_blocked_actions; // actions waiting for their dependencies
+            std::set< unsigned long > f_unfinished_actions; // queued, blocked, and running actions of the current generation
+            std::map< std::string, unsigned long > f_action_ids;
+            unsigned long f_next_sequence;
+            std::atomic< unsigned > f_queue_generation; // incremented when the queue is replaced; an in-progress action from an older generation is aborted
+            time_point_t f_hold_until; // end of the latest post-action sleep
+            std::map< unsigned long, std::future< void > > f_running_actions;
+            std::vector< unsigned long > f_finished_actions; // running actions that are done, but have not been cleaned up
+            std::exception_ptr f_action_error;
+            mutable std::mutex f_queue_mutex;
+            std::condition_variable f_queue_condition;
             scarab::param_node f_condition_actions;
 
-            void do_an_action();
+            void queue_actions( const std::vector< action_info >& a_actions );
+
+            /// Blocks until an action is due and can be started; returns false if canceled,
+            /// or if there is nothing left to do and a_wait_for_more is false.
+            /// Rethrows an exception thrown by a running action.
+            bool wait_for_action( scheduled_action& a_action, unsigned& a_generation, bool a_wait_for_more );
+
+            // requires f_queue_mutex to be locked; puts an action whose dependencies are complete in the ready queue or with the delayed actions
+            void schedule_action( const scheduled_action& a_action, const time_point_t& a_now );
+
+            void start_action( const scheduled_action& a_action, unsigned a_generation );
+            void run_action( scheduled_action a_action, unsigned a_generation );
+            // requires f_queue_mutex to be locked; dependents are held back until a_release_time without blocking the ready queue
+            void release_dependents( unsigned long a_sequence, const time_point_t& a_release_time );
+            /// Waits for the running actions to finish
+            void finish_running_actions();
+
+            /// Submits the action's request (or runs the custom action) and waits for it to finish; called from the action's thread
+            virtual void do_an_action( const action_info& a_action, unsigned a_generation );
 
             action_info parse_action( const scarab::param_node& a_action );
 
@@ -14,6 +14,7 @@
 #include "signal_handler.hh"
 #include "stream_manager.hh"
 #include "batch_executor.hh"
+#include "metrics_exporter.hh"
 
 #include "authentication.hh"
 #include "logger.hh"
@@ -39,6 +40,7 @@ namespace sandfly
             f_run_control(),
             f_stream_manager(),
             f_message_relayer(),
+            f_metrics_exporter(),
             f_component_mutex(),
             f_status( k_initialized )
     {
@@ -110,10 +112,22 @@ namespace sandfly
             // request receiver
             LDEBUG( plog, "Creating request receiver" );
             f_request_receiver.reset( new request_receiver( a_config, a_auth ) );
+            // cached replies are out of date when the DAQ status or the streams change
+            std::shared_ptr< request_receiver > t_receiver( f_request_receiver );
+            f_run_control->add_status_callback( [t_receiver]( run_control::status, run_control::status ){ t_receiver->invalidate_reply_cache(); } );
+            f_stream_manager->add_change_callback( [t_receiver](){ t_receiver->invalidate_reply_cache(); } );
             // batch executor
             LDEBUG( plog, "Creating batch executor" );
             f_batch_executor.reset( new batch_executor( a_config, f_request_receiver ) );
 
+            // metrics exporter
+            if( a_config.has( "metrics" ) && a_config["metrics"].as_node().get_value( "enable", false ) )
+            {
+                LDEBUG( plog, "Creating metrics exporter" );
+                f_metrics_exporter.reset( new metrics_exporter( a_config["metrics"].as_node() ) );
+                add_metrics_hooks();
+            }
+
         }
         catch( std::exception& e )
         {
@@ -134,6 +148,8 @@ namespace sandfly
         f_request_receiver->register_get_handler( "node-config", std::bind( &stream_manager::handle_dump_config_node_request, f_stream_manager, _1 ) );
         f_request_receiver->register_get_handler( "stream-list", std::bind( &stream_manager::handle_get_stream_list_request, f_stream_manager, _1 ) );
         f_request_receiver->register_get_handler( "node-list", std::bind( &stream_manager::handle_get_stream_node_list_request, f_stream_manager, _1 ) );
+        f_request_receiver->register_get_handler( "placement-plan", std::bind( &stream_manager::handle_get_placement_plan_request, f_stream_manager, _1 ) );
+        f_request_receiver->register_get_handler( "request-stats", std::bind( &request_receiver::handle_get_request_stats_request, f_request_receiver, _1 ) );
 
         // add set request handlers
         f_request_receiver->register_set_handler( "node-config", std::bind( &stream_manager::handle_configure_node_request, f_stream_manager, _1 ) );
@@ -148,6 +164,12 @@ namespace sandfly
 
         // start threads
         LPROG( plog, "Starting threads" );
+        std::thread t_metrics_thread;
+        if( f_metrics_exporter )
+        {
+            LDEBUG( plog, "Starting metrics-exporter thread" );
+            t_metrics_thread = std::thread( &metrics_exporter::execute, f_metrics_exporter.get() );
+        }
         std::exception_ptr t_dc_ex_ptr;
         LDEBUG( plog, "Starting run-control thread" );
         std::thread t_run_control_thread( &run_control::execute, f_run_control.get(), std::ref(t_run_control_ready_cv), std::ref(t_run_control_ready_mutex) );
@@ -189,6 +211,13 @@ namespace sandfly
         if( t_msg_relay_thread.joinable() ) t_msg_relay_thread.join();
         LDEBUG( plog, "Message relay thread has ended" );
 
+        if( t_metrics_thread.joinable() )
+        {
+            f_metrics_exporter->cancel( f_return );
+            t_metrics_thread.join();
+        }
+        LDEBUG( plog, "Metrics exporter thread has ended" );
+
         set_status( k_done );
 
         LPROG( plog, "Threads stopped" );
@@ -205,10 +234,45 @@ namespace sandfly
         f_request_receiver->cancel( a_code );
         f_run_control->cancel( a_code );
         f_message_relayer->cancel( a_code );
+        if( f_metrics_exporter ) f_metrics_exporter->cancel( a_code );
         //f_node_manager->cancel();
         return;
     }
 
+    void conductor::add_metrics_hooks()
+    {
+        // hooks are called from the exporter's thread when it scrapes
+        std::weak_ptr< run_control > t_run_control( f_run_control );
+        gauge& t_status_gauge = metrics_registry::global().get_gauge( "run_control.status" );
+        f_metrics_exporter->add_pre_scrape_hook( [t_run_control, &t_status_gauge](){
+                    std::shared_ptr< run_control > t_rc = t_run_control.lock();
+                    if( t_rc ) t_status_gauge.set( run_control::status_to_uint( t_rc->get_status() ) );
+                } );
+
+        std::weak_ptr< batch_executor > t_batch_executor( f_batch_executor );
+        gauge& t_queue_gauge = metrics_registry::global().get_gauge( "batch_executor.queue_depth" );
+        f_metrics_exporter->add_pre_scrape_hook( [t_batch_executor, &t_queue_gauge](){
+                    std::shared_ptr< batch_executor > t_be = t_batch_executor.lock();
+                    if( t_be ) t_queue_gauge.set( t_be->queue_size() );
+                } );
+
+        f_metrics_exporter->add_pre_scrape_hook( [t_run_control](){
+                    std::shared_ptr< run_control > t_rc = t_run_control.lock();
+                    if( ! t_rc ) return;
+                    t_rc->collect_node_statistics( []( const std::string& a_stream_name, const std::string& a_node_name, const node_statistics& a_stats ){
+                                metric_labels_t t_labels{ {"stream", a_stream_name}, {"node", a_node_name} };
+                                metrics_registry& t_registry = metrics_registry::global();
+                                if( a_stats.f_records >= 0 ) t_registry.get_gauge( "node_records", t_labels ).set( a_stats.f_records );
+                                if( a_stats.f_bytes >= 0 ) t_registry.get_gauge( "node_bytes", t_labels ).set( a_stats.f_bytes );
+                                if( a_stats.f_drops >= 0 ) t_registry.get_gauge( "node_drops", t_labels ).set( a_stats.f_drops );
+                                // fractions are exported in parts per million, since gauges are integers
+                                if( a_stats.f_buffer_occupancy >= 0. ) t_registry.get_gauge( "node_buffer_occupancy_ppm", t_labels ).set( int64_t(a_stats.f_buffer_occupancy * 1.e6) );
+                                if( a_stats.f_busy_time_s >= 0. ) t_registry.get_gauge( "node_busy_time_us", t_labels ).set( int64_t(a_stats.f_busy_time_s * 1.e6) );
+                            } );
+                } );
+        return;
+    }
+
     void conductor::quit_server()
     {
         LINFO( plog, "Shutting down the server" );
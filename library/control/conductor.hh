@@ -29,6 +29,7 @@ namespace sandfly
 {
     class batch_executor;
     class message_relayer;
+    class metrics_exporter;
     class run_control;
     class request_receiver;
     class stream_manager;
@@ -53,6 +54,8 @@ namespace sandfly
      In execute(), conductor creates new instances of run_control, stream_manager and request_receiver.
      It also adds set, get and cmd request handlers by registering handlers with the request_receiver.
      Then it calls run_control.execute and request_receiver.execute in 2 separate threads.
+     If enabled in the "metrics" section of the config, a metrics_exporter is run in its own thread; the conductor
+     registers the hooks that sample the run_control status, the batch queue depth, and the node statistics.
      conductor.execute() only returns when all threads are joined.
 
      */
@@ -95,6 +98,9 @@ namespace sandfly
             std::shared_ptr< run_control > f_run_control;
             std::shared_ptr< stream_manager > f_stream_manager;
             std::shared_ptr< message_relayer > f_message_relayer;
+            std::shared_ptr< metrics_exporter > f_metrics_exporter;
+
+            void add_metrics_hooks();
 
             std::mutex f_component_mutex;
 
@@ -0,0 +1,122 @@
+/*
+ * connection_graph.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "connection_graph.hh"
+
+#include "sandfly_error.hh"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+
+namespace sandfly
+{
+
+    namespace
+    {
+        // splits [node].[port] at the first '.', as midge does
+        void split_port( const std::string& a_connection, const std::string& a_end, std::string& a_node, std::string& a_port )
+        {
+            std::string::size_type t_dot = a_end.find( '.' );
+            if( t_dot == std::string::npos || t_dot == 0 || t_dot == a_end.size() - 1 )
+            {
+                throw error() << "Invalid connection <" << a_connection << ">: <" << a_end << "> should be [node].[port]";
+            }
+            a_node = a_end.substr( 0, t_dot );
+            a_port = a_end.substr( t_dot + 1 );
+            return;
+        }
+    }
+
+    stream_connection stream_connection::parse( const std::string& a_connection )
+    {
+        std::string::size_type t_colon = a_connection.find( ':' );
+        if( t_colon == std::string::npos || a_connection.find( ':', t_colon + 1 ) != std::string::npos )
+        {
+            throw error() << "Invalid connection <" << a_connection << ">: should be [node].[output]:[node].[input]";
+        }
+
+        stream_connection t_connection;
+        split_port( a_connection, a_connection.substr( 0, t_colon ), t_connection.f_source_node, t_connection.f_source_port );
+        split_port( a_connection, a_connection.substr( t_colon + 1 ), t_connection.f_sink_node, t_connection.f_sink_port );
+        t_connection.f_join_string = a_connection;
+        return t_connection;
+    }
+
+
+    connection_graph::connection_graph() :
+            f_edges()
+    {}
+
+    connection_graph::~connection_graph()
+    {}
+
+    void connection_graph::add( const std::string& a_connection )
+    {
+        f_edges.push_back( stream_connection::parse( a_connection ) );
+        return;
+    }
+
+    void connection_graph::validate( const std::set< std::string >& a_nodes ) const
+    {
+        std::map< std::string, std::vector< std::string > > t_downstream;
+        std::set< std::pair< std::string, std::string > > t_inputs;
+        for( edges_t::const_iterator t_edge_it = f_edges.begin(); t_edge_it != f_edges.end(); ++t_edge_it )
+        {
+            if( a_nodes.count( t_edge_it->f_source_node ) == 0 )
+            {
+                throw error() << "Connection <" << t_edge_it->f_source_node << "." << t_edge_it->f_source_port << ":" << t_edge_it->f_sink_node << "." << t_edge_it->f_sink_port
+                        << "> refers to an unknown node: <" << t_edge_it->f_source_node << ">";
+            }
+            if( a_nodes.count( t_edge_it->f_sink_node ) == 0 )
+            {
+                throw error() << "Connection <" << t_edge_it->f_source_node << "." << t_edge_it->f_source_port << ":" << t_edge_it->f_sink_node << "." << t_edge_it->f_sink_port
+                        << "> refers to an unknown node: <" << t_edge_it->f_sink_node << ">";
+            }
+            if( ! t_inputs.insert( std::make_pair( t_edge_it->f_sink_node, t_edge_it->f_sink_port ) ).second )
+            {
+                throw error() << "Input <" << t_edge_it->f_sink_node << "." << t_edge_it->f_sink_port << "> has more than one connection";
+            }
+            t_downstream[ t_edge_it->f_source_node ].push_back( t_edge_it->f_sink_node );
+        }
+
+        // depth-first search for a cycle; nodes on the current path are "open", and nodes whose descendants have all been checked are "done"
+        enum class mark { open, done };
+        std::map< std::string, mark > t_marks;
+        std::vector< std::string > t_path;
+        std::function< void( const std::string& ) > t_visit = [&]( const std::string& a_node ) {
+            std::map< std::string, mark >::const_iterator t_mark_it = t_marks.find( a_node );
+            if( t_mark_it != t_marks.end() )
+            {
+                if( t_mark_it->second == mark::done ) return;
+
+                std::string t_cycle;
+                std::vector< std::string >::const_iterator t_path_it = std::find( t_path.begin(), t_path.end(), a_node );
+                for( ; t_path_it != t_path.end(); ++t_path_it ) t_cycle += *t_path_it + " -> ";
+                throw error() << "Connections form a cycle: " << t_cycle << a_node;
+            }
+
+            t_marks[ a_node ] = mark::open;
+            t_path.push_back( a_node );
+            std::map< std::string, std::vector< std::string > >::const_iterator t_down_it = t_downstream.find( a_node );
+            if( t_down_it != t_downstream.end() )
+            {
+                for( std::vector< std::string >::const_iterator t_next_it = t_down_it->second.begin(); t_next_it != t_down_it->second.end(); ++t_next_it )
+                {
+                    t_visit( *t_next_it );
+                }
+            }
+            t_path.pop_back();
+            t_marks[ a_node ] = mark::done;
+        };
+        for( std::set< std::string >::const_iterator t_node_it = a_nodes.begin(); t_node_it != a_nodes.end(); ++t_node_it )
+        {
+            t_visit( *t_node_it );
+        }
+        return;
+    }
+
+} /* namespace sandfly */
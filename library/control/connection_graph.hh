@@ -0,0 +1,86 @@
+/*
+ * connection_graph.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_CONNECTION_GRAPH_HH_
+#define SANDFLY_CONNECTION_GRAPH_HH_
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace sandfly
+{
+
+    /*!
+     @struct stream_connection
+
+     @brief One connection of a stream: an output port of a source node to an input port of a sink node
+
+     @details
+     Node names are the names within the stream (as in the preset).
+     f_join_string is the connection in midge's format, with the nodes' full names; stream_manager fills it in when the stream is added.
+     */
+    struct stream_connection
+    {
+        std::string f_source_node;
+        std::string f_source_port;
+        std::string f_sink_node;
+        std::string f_sink_port;
+
+        std::string f_join_string;
+
+        /// Parses a connection of the form [source node].[output]:[sink node].[input]
+        /// Throws sandfly::error if the connection is malformed
+        static stream_connection parse( const std::string& a_connection );
+    };
+
+    /*!
+     @class connection_graph
+
+     @brief The connections of a stream, parsed and validated once
+
+     @details
+     validate() checks that:
+     - every connection refers to nodes that are in the stream;
+     - no input port has more than one connection;
+     - the connections don't form a cycle.
+     It throws sandfly::error describing the first problem found.
+     */
+    class connection_graph
+    {
+        public:
+            typedef std::vector< stream_connection > edges_t;
+
+        public:
+            connection_graph();
+            virtual ~connection_graph();
+
+            /// Parses and adds a connection; throws sandfly::error if it's malformed
+            void add( const std::string& a_connection );
+
+            void validate( const std::set< std::string >& a_nodes ) const;
+
+            const edges_t& edges() const;
+            edges_t& edges();
+
+        private:
+            edges_t f_edges;
+    };
+
+
+    inline const connection_graph::edges_t& connection_graph::edges() const
+    {
+        return f_edges;
+    }
+
+    inline connection_graph::edges_t& connection_graph::edges()
+    {
+        return f_edges;
+    }
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_CONNECTION_GRAPH_HH_ */
@@ -0,0 +1,248 @@
+/*
+ * cpu_topology.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "cpu_topology.hh"
+
+#include "thread_placement.hh"
+
+#include "logger.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include <sched.h>
+
+namespace sandfly
+{
+    LOGGER( plog, "cpu_topology" );
+
+    namespace
+    {
+        // reads the first line of a file; returns false if it can't be read
+        bool read_line( const std::string& a_path, std::string& a_line )
+        {
+            std::ifstream t_file( a_path );
+            if( ! t_file ) return false;
+            std::getline( t_file, a_line );
+            return true;
+        }
+
+        // reads a CPU list from a file; an empty file is an empty list
+        bool read_cpu_list( const std::string& a_path, std::vector< unsigned >& a_cpus )
+        {
+            std::string t_line;
+            if( ! read_line( a_path, t_line ) ) return false;
+            a_cpus.clear();
+            if( t_line.find_first_not_of( " \t" ) == std::string::npos ) return true;
+            try
+            {
+                a_cpus = parse_cpu_list( t_line );
+                return true;
+            }
+            catch( std::exception& e )
+            {
+                LWARN( plog, "Unable to read the CPU list in <" << a_path << ">: " << e.what() );
+                return false;
+            }
+        }
+
+        template< typename x_type >
+        bool read_number( const std::string& a_path, x_type& a_value )
+        {
+            std::string t_line;
+            if( ! read_line( a_path, t_line ) ) return false;
+            std::stringstream t_stream( t_line );
+            return bool(t_stream >> a_value);
+        }
+
+        // the process's cgroup from /proc/self/cgroup ("[hierarchy]:[controllers]:[path]"):
+        // the cgroup v2 path (hierarchy 0, no controllers) and the path in the v1 hierarchy with the cpu controller
+        void read_cgroup_paths( std::string& a_v2_path, std::string& a_v1_cpu_path )
+        {
+            std::ifstream t_file( "/proc/self/cgroup" );
+            std::string t_line;
+            while( std::getline( t_file, t_line ) )
+            {
+                std::string::size_type t_first = t_line.find( ':' );
+                std::string::size_type t_second = t_first == std::string::npos ? std::string::npos : t_line.find( ':', t_first + 1 );
+                if( t_second == std::string::npos ) continue;
+                std::string t_controllers( t_line.substr( t_first + 1, t_second - t_first - 1 ) );
+                std::string t_path( t_line.substr( t_second + 1 ) );
+                if( t_line.compare( 0, t_first, "0" ) == 0 && t_controllers.empty() )
+                {
+                    a_v2_path = t_path;
+                    continue;
+                }
+                std::stringstream t_stream( t_controllers );
+                std::string t_controller;
+                while( std::getline( t_stream, t_controller, ',' ) )
+                {
+                    if( t_controller == "cpu" ) a_v1_cpu_path = t_path;
+                }
+            }
+            return;
+        }
+
+        // a cgroup path and its ancestors, innermost first, ending with the root of the hierarchy ("")
+        std::vector< std::string > cgroup_ancestry( std::string a_path )
+        {
+            std::vector< std::string > t_paths;
+            while( ! a_path.empty() && a_path != "/" )
+            {
+                t_paths.push_back( a_path );
+                a_path.erase( a_path.find_last_of( '/' ) );
+            }
+            t_paths.push_back( "" );
+            return t_paths;
+        }
+
+        // the limit that applies to the process is the smallest one of its cgroup and the cgroup's ancestors;
+        // if the process's cgroup isn't visible under a_root (e.g. in a container without a cgroup namespace), only the root's limit is found
+        double read_cpu_quota( const std::string& a_root )
+        {
+            std::string t_v2_path, t_v1_path;
+            read_cgroup_paths( t_v2_path, t_v1_path );
+
+            double t_quota = 0.;
+            bool t_found = false;
+
+            // cgroup v2: "[quota] [period]", where the quota can be "max"
+            std::vector< std::string > t_v2_paths( cgroup_ancestry( t_v2_path ) );
+            for( std::vector< std::string >::const_iterator t_path_it = t_v2_paths.begin(); t_path_it != t_v2_paths.end(); ++t_path_it )
+            {
+                std::string t_line;
+                if( ! read_line( a_root + "/fs/cgroup" + *t_path_it + "/cpu.max", t_line ) ) continue;
+                t_found = true;
+                std::stringstream t_stream( t_line );
+                std::string t_limit;
+                double t_period = 0.;
+                if( t_stream >> t_limit >> t_period && t_limit != "max" && t_period > 0. )
+                {
+                    double t_cgroup_quota = std::stod( t_limit ) / t_period;
+                    t_quota = t_quota > 0. ? std::min( t_quota, t_cgroup_quota ) : t_cgroup_quota;
+                }
+            }
+            if( t_found ) return t_quota;
+
+            // cgroup v1: a negative quota means there's no limit
+            const char* t_dirs[] = { "/fs/cgroup/cpu", "/fs/cgroup/cpu,cpuacct" };
+            std::vector< std::string > t_v1_paths( cgroup_ancestry( t_v1_path ) );
+            for( const char* t_dir : t_dirs )
+            {
+                for( std::vector< std::string >::const_iterator t_path_it = t_v1_paths.begin(); t_path_it != t_v1_paths.end(); ++t_path_it )
+                {
+                    long t_cgroup_quota = 0;
+                    long t_period = 0;
+                    if( ! read_number( a_root + t_dir + *t_path_it + "/cpu.cfs_quota_us", t_cgroup_quota ) || ! read_number( a_root + t_dir + *t_path_it + "/cpu.cfs_period_us", t_period ) ) continue;
+                    t_found = true;
+                    if( t_cgroup_quota > 0 && t_period > 0 )
+                    {
+                        double t_ratio = double(t_cgroup_quota) / double(t_period);
+                        t_quota = t_quota > 0. ? std::min( t_quota, t_ratio ) : t_ratio;
+                    }
+                }
+                // the two directories are usually the same hierarchy
+                if( t_found ) return t_quota;
+            }
+            return 0.;
+        }
+    }
+
+    cpu_topology cpu_topology::read( const std::string& a_sysfs_root )
+    {
+        const std::string t_cpu_dir( a_sysfs_root + "/devices/system/cpu" );
+        const std::string t_node_dir( a_sysfs_root + "/devices/system/node" );
+
+        std::vector< unsigned > t_online;
+        if( ! read_cpu_list( t_cpu_dir + "/online", t_online ) || t_online.empty() )
+        {
+            LWARN( plog, "Unable to read the online CPUs; assuming that CPUs 0 to " << std::thread::hardware_concurrency() - 1 << " are online" );
+            t_online.clear();
+            for( unsigned t_cpu = 0; t_cpu < std::max( 1U, std::thread::hardware_concurrency() ); ++t_cpu ) t_online.push_back( t_cpu );
+        }
+
+        // the cgroup's cpuset (and anything else that restricts the process) shows up in the affinity mask
+        cpu_set_t t_allowed;
+        CPU_ZERO( &t_allowed );
+        bool t_have_allowed = sched_getaffinity( 0, sizeof(t_allowed), &t_allowed ) == 0;
+
+        std::vector< unsigned > t_isolated;
+        read_cpu_list( t_cpu_dir + "/isolated", t_isolated );
+
+        std::map< unsigned, unsigned > t_cpu_numa_nodes;
+        std::vector< unsigned > t_numa_nodes;
+        if( read_cpu_list( t_node_dir + "/online", t_numa_nodes ) )
+        {
+            for( std::vector< unsigned >::const_iterator t_node_it = t_numa_nodes.begin(); t_node_it != t_numa_nodes.end(); ++t_node_it )
+            {
+                std::vector< unsigned > t_node_cpus;
+                if( ! read_cpu_list( t_node_dir + "/node" + std::to_string( *t_node_it ) + "/cpulist", t_node_cpus ) ) continue;
+                for( std::vector< unsigned >::const_iterator t_cpu_it = t_node_cpus.begin(); t_cpu_it != t_node_cpus.end(); ++t_cpu_it )
+                {
+                    t_cpu_numa_nodes[ *t_cpu_it ] = *t_node_it;
+                }
+            }
+        }
+
+        cpu_topology t_topology;
+        t_topology.f_n_numa_nodes = std::max< unsigned >( 1, t_numa_nodes.size() );
+        t_topology.f_cpu_quota = read_cpu_quota( a_sysfs_root );
+
+        for( std::vector< unsigned >::const_iterator t_cpu_it = t_online.begin(); t_cpu_it != t_online.end(); ++t_cpu_it )
+        {
+            if( t_have_allowed && ( *t_cpu_it >= CPU_SETSIZE || ! CPU_ISSET( *t_cpu_it, &t_allowed ) ) ) continue;
+
+            cpu_info t_cpu;
+            t_cpu.f_id = *t_cpu_it;
+            const std::string t_dir( t_cpu_dir + "/cpu" + std::to_string( t_cpu.f_id ) );
+
+            int t_package = 0;
+            if( read_number( t_dir + "/topology/physical_package_id", t_package ) && t_package > 0 ) t_cpu.f_package = unsigned(t_package);
+
+            std::map< unsigned, unsigned >::const_iterator t_numa_it = t_cpu_numa_nodes.find( t_cpu.f_id );
+            if( t_numa_it != t_cpu_numa_nodes.end() ) t_cpu.f_numa_node = t_numa_it->second;
+
+            for( unsigned t_index = 0; ; ++t_index )
+            {
+                const std::string t_cache_dir( t_dir + "/cache/index" + std::to_string( t_index ) );
+                unsigned t_level = 0;
+                if( ! read_number( t_cache_dir + "/level", t_level ) ) break;
+                if( t_level != 3 ) continue;
+
+                std::vector< unsigned > t_shared;
+                if( read_cpu_list( t_cache_dir + "/shared_cpu_list", t_shared ) && ! t_shared.empty() ) t_cpu.f_l3_group = int(t_shared.front());
+                break;
+            }
+
+            t_cpu.f_isolated = std::binary_search( t_isolated.begin(), t_isolated.end(), t_cpu.f_id );
+
+            t_topology.f_cpus.push_back( t_cpu );
+        }
+
+        LDEBUG( plog, "Found " << t_topology.f_cpus.size() << " usable CPU(s) on " << t_topology.f_n_numa_nodes << " NUMA node(s); cgroup CPU quota: " << t_topology.f_cpu_quota );
+        return t_topology;
+    }
+
+    void cpu_topology::to_param( scarab::param_node& a_node ) const
+    {
+        std::vector< unsigned > t_cpus;
+        std::vector< unsigned > t_isolated;
+        for( std::vector< cpu_info >::const_iterator t_cpu_it = f_cpus.begin(); t_cpu_it != f_cpus.end(); ++t_cpu_it )
+        {
+            t_cpus.push_back( t_cpu_it->f_id );
+            if( t_cpu_it->f_isolated ) t_isolated.push_back( t_cpu_it->f_id );
+        }
+        a_node.add( "cpu-set", format_cpu_list( t_cpus ) );
+        a_node.add( "isolated-cpu-set", format_cpu_list( t_isolated ) );
+        a_node.add( "n-numa-nodes", f_n_numa_nodes );
+        a_node.add( "cpu-quota", f_cpu_quota );
+        return;
+    }
+
+} /* namespace sandfly */
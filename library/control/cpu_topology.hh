@@ -0,0 +1,59 @@
+/*
+ * cpu_topology.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_CPU_TOPOLOGY_HH_
+#define SANDFLY_CPU_TOPOLOGY_HH_
+
+#include "param.hh"
+
+#include <string>
+#include <vector>
+
+namespace sandfly
+{
+
+    /*!
+     @struct cpu_info
+
+     @brief Where one CPU sits in the machine
+     */
+    struct cpu_info
+    {
+        unsigned f_id = 0;
+        unsigned f_package = 0; // physical socket
+        unsigned f_numa_node = 0;
+        int f_l3_group = -1; // lowest CPU that shares this CPU's L3 cache; negative if there's no L3 information
+        bool f_isolated = false; // excluded from the scheduler's load balancing (isolcpus)
+    };
+
+    /*!
+     @struct cpu_topology
+
+     @brief The CPUs this process may use, with their packages, NUMA nodes, and L3 caches
+
+     @details
+     read() uses:
+     - /sys/devices/system/cpu: online and isolated CPUs, each CPU's physical package, and the CPUs sharing its L3 cache;
+     - /sys/devices/system/node: the CPUs of each NUMA node;
+     - the process's CPU affinity, which reflects the cgroup's cpuset;
+     - the CPU quota of the process's cgroup (found in /proc/self/cgroup) and its ancestors: cpu.max for cgroup v2, or cpu.cfs_quota_us and cpu.cfs_period_us for v1.
+     Missing information falls back to a single package and NUMA node, without L3 groups, isolated CPUs, or quota.
+     */
+    struct cpu_topology
+    {
+        std::vector< cpu_info > f_cpus; // sorted by ID
+        unsigned f_n_numa_nodes = 1;
+        double f_cpu_quota = 0.; // CPUs' worth of time allowed by the cgroup; 0 if there's no limit
+
+        /// a_sysfs_root is normally "/sys"; it can be changed to read a saved copy of the topology
+        static cpu_topology read( const std::string& a_sysfs_root = "/sys" );
+
+        void to_param( scarab::param_node& a_node ) const;
+    };
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_CPU_TOPOLOGY_HH_ */
@@ -0,0 +1,250 @@
+/*
+ * dead_time_tracker.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "dead_time_tracker.hh"
+
+#include <algorithm>
+#include <vector>
+
+using scarab::param_node;
+using scarab::param_value;
+
+namespace sandfly
+{
+
+    dead_time_tracker::sample_window::sample_window( unsigned a_max_samples ) :
+            f_samples(),
+            f_max_samples( a_max_samples == 0 ? 1 : a_max_samples )
+    {}
+
+    void dead_time_tracker::sample_window::add( double a_value )
+    {
+        f_samples.push_back( a_value );
+        if( f_samples.size() > f_max_samples ) f_samples.pop_front();
+        return;
+    }
+
+    void dead_time_tracker::sample_window::fill( param_node& a_node ) const
+    {
+        // all of the statistics are over the samples in the window
+        a_node.add( "count", param_value( (unsigned long)f_samples.size() ) );
+        if( f_samples.empty() ) return;
+
+        std::vector< double > t_sorted( f_samples.begin(), f_samples.end() );
+        std::sort( t_sorted.begin(), t_sorted.end() );
+        double t_sum = 0.;
+        for( std::vector< double >::const_iterator t_it = t_sorted.begin(); t_it != t_sorted.end(); ++t_it )
+        {
+            t_sum += *t_it;
+        }
+        a_node.add( "mean", param_value( t_sum / double(t_sorted.size()) ) );
+        a_node.add( "p50", param_value( t_sorted[ nearest_rank( 50, t_sorted.size() ) ] ) );
+        a_node.add( "p90", param_value( t_sorted[ nearest_rank( 90, t_sorted.size() ) ] ) );
+        a_node.add( "p99", param_value( t_sorted[ nearest_rank( 99, t_sorted.size() ) ] ) );
+        a_node.add( "max", param_value( t_sorted.back() ) );
+        return;
+    }
+
+    size_t dead_time_tracker::sample_window::nearest_rank( unsigned a_percentile, size_t a_n_samples )
+    {
+        // the rank is ceil( p/100 * n ), counting from 1
+        size_t t_rank = ( size_t(a_percentile) * a_n_samples + 99 ) / 100;
+        return t_rank == 0 ? 0 : t_rank - 1;
+    }
+
+    dead_time_tracker::dead_time_tracker( unsigned a_max_samples ) :
+            f_start_time( std::chrono::steady_clock::now() ),
+            f_activating_time(),
+            f_is_activating( false ),
+            f_deactivating_time(),
+            f_is_deactivating( false ),
+            f_resume_time(),
+            f_is_running( false ),
+            f_dead_start_time(),
+            f_interrupt_time(),
+            f_is_interrupted( false ),
+            f_run_interrupted_time( 0 ),
+            f_is_activated( false ),
+            f_total_live_time( 0 ),
+            f_n_runs( 0 ),
+            f_last_run_live_ms( 0. ),
+            f_last_run_dead_ms( 0. ),
+            f_last_run_interrupted_ms( 0. ),
+            f_run_live( a_max_samples ),
+            f_run_dead( a_max_samples ),
+            f_run_interruption( a_max_samples ),
+            f_activation_latency( a_max_samples ),
+            f_deactivation_latency( a_max_samples ),
+            f_mutex()
+    {}
+
+    double dead_time_tracker::to_ms( const std::chrono::steady_clock::duration& a_duration )
+    {
+        return std::chrono::duration_cast< std::chrono::duration< double, std::milli > >( a_duration ).count();
+    }
+
+    void dead_time_tracker::activating()
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        f_activating_time = std::chrono::steady_clock::now();
+        f_is_activating = true;
+        return;
+    }
+
+    void dead_time_tracker::activated()
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        time_point_t t_now = std::chrono::steady_clock::now();
+        if( f_is_activating ) f_activation_latency.add( to_ms( t_now - f_activating_time ) );
+        f_is_activating = false;
+        f_is_activated = true;
+        f_dead_start_time = t_now;
+        return;
+    }
+
+    void dead_time_tracker::deactivating()
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        f_deactivating_time = std::chrono::steady_clock::now();
+        f_is_deactivating = true;
+        return;
+    }
+
+    void dead_time_tracker::run_resumed()
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        time_point_t t_now = std::chrono::steady_clock::now();
+        f_last_run_dead_ms = f_is_activated ? to_ms( t_now - f_dead_start_time ) : 0.;
+        f_run_dead.add( f_last_run_dead_ms );
+        f_resume_time = t_now;
+        f_is_running = true;
+        f_is_interrupted = false;
+        f_run_interrupted_time = std::chrono::steady_clock::duration( 0 );
+        return;
+    }
+
+    void dead_time_tracker::run_paused()
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        if( ! f_is_running ) return;
+        time_point_t t_now = std::chrono::steady_clock::now();
+        end_run( t_now );
+        f_dead_start_time = t_now;
+        return;
+    }
+
+    void dead_time_tracker::run_interrupted()
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        if( ! f_is_running || f_is_interrupted ) return;
+        f_interrupt_time = std::chrono::steady_clock::now();
+        f_is_interrupted = true;
+        return;
+    }
+
+    void dead_time_tracker::run_continued()
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        if( ! f_is_running || ! f_is_interrupted ) return;
+        std::chrono::steady_clock::duration t_interruption = std::chrono::steady_clock::now() - f_interrupt_time;
+        f_run_interrupted_time += t_interruption;
+        f_run_interruption.add( to_ms( t_interruption ) );
+        f_is_interrupted = false;
+        return;
+    }
+
+    void dead_time_tracker::end_run( const time_point_t& a_now )
+    {
+        if( f_is_interrupted )
+        {
+            // the run ended during an interruption; the interruption ends with it
+            f_run_interrupted_time += a_now - f_interrupt_time;
+            f_run_interruption.add( to_ms( a_now - f_interrupt_time ) );
+            f_is_interrupted = false;
+        }
+        std::chrono::steady_clock::duration t_live = a_now - f_resume_time - f_run_interrupted_time;
+        f_total_live_time += t_live;
+        f_last_run_live_ms = to_ms( t_live );
+        f_last_run_interrupted_ms = to_ms( f_run_interrupted_time );
+        f_run_live.add( f_last_run_live_ms );
+        ++f_n_runs;
+        f_is_running = false;
+        return;
+    }
+
+    void dead_time_tracker::midge_exited()
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        time_point_t t_now = std::chrono::steady_clock::now();
+        if( f_is_running )
+        {
+            // midge exited during a run (e.g. because of an error); the run ends here
+            end_run( t_now );
+        }
+        if( f_is_deactivating ) f_deactivation_latency.add( to_ms( t_now - f_deactivating_time ) );
+        f_is_deactivating = false;
+        f_is_activating = false;
+        f_is_activated = false;
+        return;
+    }
+
+    void dead_time_tracker::fill_status( param_node& a_node ) const
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        time_point_t t_now = std::chrono::steady_clock::now();
+
+        std::chrono::steady_clock::duration t_live = f_total_live_time;
+        if( f_is_running )
+        {
+            t_live += t_now - f_resume_time - f_run_interrupted_time;
+            if( f_is_interrupted ) t_live -= t_now - f_interrupt_time;
+        }
+        double t_elapsed_s = to_ms( t_now - f_start_time ) * 1.e-3;
+        double t_live_s = to_ms( t_live ) * 1.e-3;
+
+        param_node t_startup_node;
+        t_startup_node.add( "elapsed-s", param_value( t_elapsed_s ) );
+        t_startup_node.add( "live-s", param_value( t_live_s ) );
+        t_startup_node.add( "dead-s", param_value( t_elapsed_s - t_live_s ) );
+        t_startup_node.add( "live-fraction", param_value( t_elapsed_s > 0. ? t_live_s / t_elapsed_s : 0. ) );
+        t_startup_node.add( "n-runs", param_value( f_n_runs ) );
+        a_node.add( "since-startup", t_startup_node );
+
+        if( f_n_runs > 0 )
+        {
+            param_node t_last_run_node;
+            t_last_run_node.add( "live-ms", param_value( f_last_run_live_ms ) );
+            t_last_run_node.add( "dead-ms", param_value( f_last_run_dead_ms ) );
+            t_last_run_node.add( "interrupted-ms", param_value( f_last_run_interrupted_ms ) );
+            double t_total_ms = f_last_run_live_ms + f_last_run_dead_ms + f_last_run_interrupted_ms;
+            t_last_run_node.add( "live-fraction", param_value( t_total_ms > 0. ? f_last_run_live_ms / t_total_ms : 0. ) );
+            a_node.add( "last-run", t_last_run_node );
+        }
+
+        param_node t_run_live_node;
+        f_run_live.fill( t_run_live_node );
+        a_node.add( "run-live-ms", t_run_live_node );
+
+        param_node t_run_dead_node;
+        f_run_dead.fill( t_run_dead_node );
+        a_node.add( "run-dead-ms", t_run_dead_node );
+
+        param_node t_run_interruption_node;
+        f_run_interruption.fill( t_run_interruption_node );
+        a_node.add( "run-interruption-ms", t_run_interruption_node );
+
+        param_node t_activation_node;
+        f_activation_latency.fill( t_activation_node );
+        a_node.add( "activation-latency-ms", t_activation_node );
+
+        param_node t_deactivation_node;
+        f_deactivation_latency.fill( t_deactivation_node );
+        a_node.add( "deactivation-latency-ms", t_deactivation_node );
+
+        return;
+    }
+
+} /* namespace sandfly */
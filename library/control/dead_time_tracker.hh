@@ -0,0 +1,119 @@
+/*
+ * dead_time_tracker.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_DEAD_TIME_TRACKER_HH_
+#define SANDFLY_DEAD_TIME_TRACKER_HH_
+
+#include "param.hh"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+namespace sandfly
+{
+
+    /*!
+     @class dead_time_tracker
+
+     @brief Accounts for the time sandfly spends taking data (live time) and not taking data (dead time).
+
+     @details
+     run_control reports the state transitions (activating, activated, deactivating), the resume and pause instructions
+     sent to midge, and midge exiting.  Live time is the time between a resume and the following pause; everything else is dead time.
+
+     Recorded for each run:
+     - live time: resume to pause, less any interruptions
+     - dead time: time before the run's resume since the previous pause (or since the DAQ was activated, for the first run after activation)
+     - interrupted time: total time midge was paused within the run (e.g. while a config transaction was applied)
+
+     Each interruption is also recorded on its own.  An interruption doesn't end the run or count as one.
+
+     Recorded for each activation:
+     - activation latency: activating to activated
+     - deactivation latency: deactivating to midge exiting
+
+     The most recent max_samples values of each quantity are kept, and are summarized (count, mean, nearest-rank percentiles, and max) in fill_status().
+     Totals are kept since startup.
+     All times are measured with the steady clock.
+     */
+    class dead_time_tracker
+    {
+        public:
+            dead_time_tracker( unsigned a_max_samples = 1000 );
+            virtual ~dead_time_tracker() = default;
+
+            void activating();
+            void activated();
+            void deactivating();
+            void run_resumed();
+            void run_paused();
+            /// Midge was paused within a run, which continues afterwards
+            void run_interrupted();
+            void run_continued();
+            void midge_exited();
+
+            /// Adds the live-time report to a_node
+            void fill_status( scarab::param_node& a_node ) const;
+
+        private:
+            typedef std::chrono::steady_clock::time_point time_point_t;
+
+            // values are in ms
+            class sample_window
+            {
+                public:
+                    sample_window( unsigned a_max_samples );
+                    void add( double a_value );
+                    /// Adds count, mean, percentiles, and max, all over the samples in the window
+                    void fill( scarab::param_node& a_node ) const;
+
+                    /// Index in the sorted samples of the nearest-rank a_percentile
+                    static size_t nearest_rank( unsigned a_percentile, size_t a_n_samples );
+
+                private:
+                    std::deque< double > f_samples;
+                    unsigned f_max_samples;
+            };
+
+            static double to_ms( const std::chrono::steady_clock::duration& a_duration );
+
+            // ends the current run at a_now; requires f_mutex to be locked and f_is_running to be true
+            void end_run( const time_point_t& a_now );
+
+            time_point_t f_start_time;
+
+            time_point_t f_activating_time;
+            bool f_is_activating;
+            time_point_t f_deactivating_time;
+            bool f_is_deactivating;
+
+            time_point_t f_resume_time;
+            bool f_is_running;
+            time_point_t f_dead_start_time; // start of the dead period before the next run
+            time_point_t f_interrupt_time;
+            bool f_is_interrupted;
+            std::chrono::steady_clock::duration f_run_interrupted_time; // total of the current run's interruptions
+            bool f_is_activated;
+
+            std::chrono::steady_clock::duration f_total_live_time;
+            unsigned long f_n_runs;
+            double f_last_run_live_ms;
+            double f_last_run_dead_ms;
+            double f_last_run_interrupted_ms;
+
+            sample_window f_run_live;
+            sample_window f_run_dead;
+            sample_window f_run_interruption;
+            sample_window f_activation_latency;
+            sample_window f_deactivation_latency;
+
+            mutable std::mutex f_mutex;
+    };
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_DEAD_TIME_TRACKER_HH_ */
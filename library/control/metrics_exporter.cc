@@ -0,0 +1,312 @@
+/*
+ * metrics_exporter.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "metrics_exporter.hh"
+
+#include "sandfly_error.hh"
+
+#include "logger.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sandfly
+{
+    LOGGER( plog, "metrics_exporter" );
+
+    metrics_exporter::metrics_exporter( const scarab::param_node& a_config ) :
+            scarab::cancelable(),
+            f_mode( a_config.get_value( "mode", "http" ) ),
+            f_address( a_config.get_value( "address", "127.0.0.1" ) ),
+            f_port( a_config.get_value( "port", 9464U ) ),
+            f_textfile( a_config.get_value( "textfile", "" ) ),
+            f_interval_ms( a_config.get_value( "interval-ms", 5000U ) ),
+            f_hooks(),
+            f_hook_mutex()
+    {
+        if( f_mode != "http" && f_mode != "textfile" )
+        {
+            throw error() << "Unknown metrics exporter mode: <" << f_mode << ">; options are \"http\" and \"textfile\"";
+        }
+        if( f_mode == "textfile" && f_textfile.empty() )
+        {
+            throw error() << "The metrics exporter's textfile mode requires a \"textfile\" path";
+        }
+        if( f_interval_ms == 0 ) f_interval_ms = 1;
+    }
+
+    metrics_exporter::~metrics_exporter()
+    {
+    }
+
+    void metrics_exporter::add_pre_scrape_hook( const hook_t& a_hook )
+    {
+        std::unique_lock< std::mutex > t_lock( f_hook_mutex );
+        f_hooks.push_back( a_hook );
+        return;
+    }
+
+    void metrics_exporter::execute()
+    {
+        LINFO( plog, "Starting the metrics exporter in " << f_mode << " mode" );
+        try
+        {
+            if( f_mode == "http" ) run_http();
+            else run_textfile();
+        }
+        catch( std::exception& e )
+        {
+            // the exporter is not essential, so errors don't stop sandfly
+            LERROR( plog, "The metrics exporter has stopped because of an error: " << e.what() );
+        }
+        LINFO( plog, "Metrics exporter has stopped" );
+        return;
+    }
+
+    void metrics_exporter::do_cancellation( int )
+    {
+        // the loops check for cancellation at least every 500 ms
+        return;
+    }
+
+    std::string metrics_exporter::scrape()
+    {
+        {
+            std::unique_lock< std::mutex > t_lock( f_hook_mutex );
+            for( std::vector< hook_t >::const_iterator t_it = f_hooks.begin(); t_it != f_hooks.end(); ++t_it )
+            {
+                try
+                {
+                    (*t_it)();
+                }
+                catch( std::exception& e )
+                {
+                    LWARN( plog, "Pre-scrape hook failed: " << e.what() );
+                }
+            }
+        }
+        return render( metrics_registry::global() );
+    }
+
+    namespace
+    {
+        // characters that are not allowed in Prometheus names are replaced with '_'
+        std::string sanitize_name( const std::string& a_name )
+        {
+            std::string t_name;
+            for( std::string::const_iterator t_it = a_name.begin(); t_it != a_name.end(); ++t_it )
+            {
+                bool t_allowed = (*t_it >= 'a' && *t_it <= 'z') || (*t_it >= 'A' && *t_it <= 'Z') || (*t_it >= '0' && *t_it <= '9') || *t_it == '_' || *t_it == ':';
+                t_name.push_back( t_allowed ? *t_it : '_' );
+            }
+            return t_name;
+        }
+
+        std::string metric_name( const std::string& a_name )
+        {
+            return "sandfly_" + sanitize_name( a_name );
+        }
+
+        std::string label_set( const metric_labels_t& a_labels, const std::string& a_extra = std::string() )
+        {
+            if( a_labels.empty() && a_extra.empty() ) return std::string();
+            std::string t_set( "{" );
+            for( metric_labels_t::const_iterator t_it = a_labels.begin(); t_it != a_labels.end(); ++t_it )
+            {
+                if( t_it != a_labels.begin() ) t_set += ",";
+                t_set += sanitize_name( t_it->first ) + "=\"";
+                // label values escape backslashes, quotes, and newlines
+                for( std::string::const_iterator t_char_it = t_it->second.begin(); t_char_it != t_it->second.end(); ++t_char_it )
+                {
+                    if( *t_char_it == '\\' ) t_set += "\\\\";
+                    else if( *t_char_it == '"' ) t_set += "\\\"";
+                    else if( *t_char_it == '\n' ) t_set += "\\n";
+                    else t_set.push_back( *t_char_it );
+                }
+                t_set += "\"";
+            }
+            if( ! a_extra.empty() ) t_set += ( a_labels.empty() ? "" : "," ) + a_extra;
+            return t_set + "}";
+        }
+
+        void write_type( std::ostream& a_stream, std::string& a_last_base, const std::string& a_base, const char* a_type )
+        {
+            if( a_base == a_last_base ) return;
+            a_stream << "# TYPE " << a_base << " " << a_type << "\n";
+            a_last_base = a_base;
+            return;
+        }
+    }
+
+    std::string metrics_exporter::render( const metrics_registry& a_registry )
+    {
+        std::ostringstream t_stream;
+        std::string t_last_base;
+
+        a_registry.for_each_counter( [&t_stream, &t_last_base]( const std::string& a_name, const metric_labels_t& a_labels, uint64_t a_value ){
+            std::string t_base = metric_name( a_name ) + "_total";
+            write_type( t_stream, t_last_base, t_base, "counter" );
+            t_stream << t_base << label_set( a_labels ) << " " << a_value << "\n";
+        } );
+
+        a_registry.for_each_gauge( [&t_stream, &t_last_base]( const std::string& a_name, const metric_labels_t& a_labels, int64_t a_value ){
+            std::string t_base = metric_name( a_name );
+            write_type( t_stream, t_last_base, t_base, "gauge" );
+            t_stream << t_base << label_set( a_labels ) << " " << a_value << "\n";
+        } );
+
+        a_registry.for_each_histogram( [&t_stream, &t_last_base]( const std::string& a_name, const metric_labels_t& a_labels, const histogram_snapshot& a_snapshot ){
+            std::string t_base = metric_name( a_name );
+            write_type( t_stream, t_last_base, t_base, "histogram" );
+
+            // buckets up to the highest one in use, then +Inf
+            unsigned t_max_bucket = histogram_snapshot::s_n_buckets - 1;
+            while( t_max_bucket > 0 && a_snapshot.f_buckets[ t_max_bucket ] == 0 ) --t_max_bucket;
+            uint64_t t_cumulative = 0;
+            for( unsigned i_bucket = 0; i_bucket <= t_max_bucket && i_bucket < histogram_snapshot::s_n_buckets - 1; ++i_bucket )
+            {
+                t_cumulative += a_snapshot.f_buckets[ i_bucket ];
+                // bucket i holds values below its upper bound, so its "le" is the upper bound minus one
+                std::ostringstream t_le;
+                t_le << "le=\"" << histogram_snapshot::bucket_upper_bound( i_bucket ) - 1 << "\"";
+                t_stream << t_base << "_bucket" << label_set( a_labels, t_le.str() ) << " " << t_cumulative << "\n";
+            }
+            t_stream << t_base << "_bucket" << label_set( a_labels, "le=\"+Inf\"" ) << " " << a_snapshot.f_count << "\n";
+            t_stream << t_base << "_sum" << label_set( a_labels ) << " " << a_snapshot.f_sum << "\n";
+            t_stream << t_base << "_count" << label_set( a_labels ) << " " << a_snapshot.f_count << "\n";
+        } );
+
+        return t_stream.str();
+    }
+
+    void metrics_exporter::run_http()
+    {
+        int t_listen_fd = ::socket( AF_INET, SOCK_STREAM, 0 );
+        if( t_listen_fd < 0 )
+        {
+            throw error() << "Unable to create the metrics socket: " << strerror( errno );
+        }
+
+        int t_reuse = 1;
+        ::setsockopt( t_listen_fd, SOL_SOCKET, SO_REUSEADDR, &t_reuse, sizeof(t_reuse) );
+
+        sockaddr_in t_addr;
+        std::memset( &t_addr, 0, sizeof(t_addr) );
+        t_addr.sin_family = AF_INET;
+        t_addr.sin_port = htons( uint16_t(f_port) );
+        if( ::inet_pton( AF_INET, f_address.c_str(), &t_addr.sin_addr ) != 1 )
+        {
+            ::close( t_listen_fd );
+            throw error() << "Invalid metrics address: <" << f_address << ">";
+        }
+        if( ::bind( t_listen_fd, reinterpret_cast< sockaddr* >( &t_addr ), sizeof(t_addr) ) != 0 || ::listen( t_listen_fd, 8 ) != 0 )
+        {
+            std::string t_error( strerror( errno ) );
+            ::close( t_listen_fd );
+            throw error() << "Unable to listen on " << f_address << ":" << f_port << ": " << t_error;
+        }
+
+        LINFO( plog, "Serving metrics at http://" << f_address << ":" << f_port << "/metrics" );
+
+        while( ! is_canceled() )
+        {
+            pollfd t_poll_fd;
+            t_poll_fd.fd = t_listen_fd;
+            t_poll_fd.events = POLLIN;
+            t_poll_fd.revents = 0;
+            if( ::poll( &t_poll_fd, 1, 500 ) <= 0 ) continue;
+
+            int t_conn_fd = ::accept( t_listen_fd, nullptr, nullptr );
+            if( t_conn_fd < 0 ) continue;
+
+            // one request per connection; scrapes are small, so the request line is all we need
+            timeval t_timeout;
+            t_timeout.tv_sec = 2;
+            t_timeout.tv_usec = 0;
+            ::setsockopt( t_conn_fd, SOL_SOCKET, SO_RCVTIMEO, &t_timeout, sizeof(t_timeout) );
+
+            char t_buffer[ 4096 ];
+            ssize_t t_n_read = ::recv( t_conn_fd, t_buffer, sizeof(t_buffer) - 1, 0 );
+            std::string t_request( t_buffer, t_n_read > 0 ? t_n_read : 0 );
+
+            std::string t_status, t_body;
+            if( t_request.compare( 0, 13, "GET /metrics " ) == 0 || t_request.compare( 0, 14, "GET /metrics?" ) == 0 )
+            {
+                t_status = "200 OK";
+                t_body = scrape();
+            }
+            else
+            {
+                t_status = "404 Not Found";
+                t_body = "Metrics are at /metrics\n";
+            }
+
+            std::ostringstream t_response;
+            t_response << "HTTP/1.0 " << t_status << "\r\n"
+                       << "Content-Type: text/plain; version=0.0.4\r\n"
+                       << "Content-Length: " << t_body.size() << "\r\n"
+                       << "Connection: close\r\n\r\n"
+                       << t_body;
+            std::string t_response_str( t_response.str() );
+            std::string::size_type t_sent = 0;
+            while( t_sent < t_response_str.size() )
+            {
+                ssize_t t_n_sent = ::send( t_conn_fd, t_response_str.data() + t_sent, t_response_str.size() - t_sent, MSG_NOSIGNAL );
+                if( t_n_sent <= 0 ) break;
+                t_sent += t_n_sent;
+            }
+            ::close( t_conn_fd );
+        }
+
+        ::close( t_listen_fd );
+        return;
+    }
+
+    void metrics_exporter::run_textfile()
+    {
+        LINFO( plog, "Writing metrics to <" << f_textfile << "> every " << f_interval_ms << " ms" );
+
+        std::string t_temp_file = f_textfile + ".tmp";
+        std::chrono::steady_clock::time_point t_next_write = std::chrono::steady_clock::now();
+        while( ! is_canceled() )
+        {
+            if( std::chrono::steady_clock::now() < t_next_write )
+            {
+                std::this_thread::sleep_for( std::min( std::chrono::steady_clock::duration( std::chrono::milliseconds( 500 ) ), t_next_write - std::chrono::steady_clock::now() ) );
+                continue;
+            }
+            t_next_write += std::chrono::milliseconds( f_interval_ms );
+
+            {
+                std::ofstream t_file( t_temp_file.c_str(), std::ios::trunc );
+                if( ! t_file )
+                {
+                    LWARN( plog, "Unable to open the metrics file <" << t_temp_file << ">" );
+                    continue;
+                }
+                t_file << scrape();
+            }
+            if( std::rename( t_temp_file.c_str(), f_textfile.c_str() ) != 0 )
+            {
+                LWARN( plog, "Unable to move the metrics file into place: " << strerror( errno ) );
+            }
+        }
+        return;
+    }
+
+} /* namespace sandfly */
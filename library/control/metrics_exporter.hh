@@ -0,0 +1,87 @@
+/*
+ * metrics_exporter.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_METRICS_EXPORTER_HH_
+#define SANDFLY_METRICS_EXPORTER_HH_
+
+#include "metrics.hh"
+
+#include "cancelable.hh"
+#include "member_variables.hh"
+#include "param.hh"
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sandfly
+{
+
+    /*!
+     @class metrics_exporter
+
+     @brief Publishes the metrics in metrics_registry::global() in the Prometheus text format.
+
+     @details
+     The exporter does not use dripline, so it can be scraped even if the broker or the request path is busy or down.
+
+     Two modes are available:
+     - "http": a minimal HTTP listener that answers GET /metrics; it binds to localhost by default
+     - "textfile": the metrics are written to a file every interval-ms, for node_exporter's textfile collector;
+       the file is written to a temporary file and renamed, so readers never see a partial file
+
+     Before each scrape (or file write), the pre-scrape hooks are called; components use them to update gauges
+     for quantities that are sampled rather than recorded (e.g. the run_control status or the batch queue depth).
+
+     Metric names are prefixed with "sandfly_", and characters that are not allowed in Prometheus names are replaced with '_'.
+     A metric's labels are exported as its Prometheus label set, e.g. node_records{node="rec",stream="s0"}.
+     Counters are exported with a "_total" suffix; histograms are exported with cumulative power-of-two buckets.
+
+     Settings are in the "metrics" section of the global config:
+     - "enable" (bool): whether or not the exporter is started (default: false)
+     - "mode" (string): "http" or "textfile" (default: http)
+     - "address" (string): address the HTTP listener binds to (default: 127.0.0.1)
+     - "port" (integer): port of the HTTP listener (default: 9464)
+     - "textfile" (string): path of the metrics file
+     - "interval-ms" (integer): time between writes of the metrics file (default: 5000)
+     */
+    class metrics_exporter : public scarab::cancelable
+    {
+        public:
+            metrics_exporter( const scarab::param_node& a_config );
+            virtual ~metrics_exporter();
+
+            typedef std::function< void() > hook_t;
+            void add_pre_scrape_hook( const hook_t& a_hook );
+
+            /// Runs the exporter until canceled
+            void execute();
+
+            /// Renders the registry in the Prometheus text format
+            static std::string render( const metrics_registry& a_registry );
+
+            mv_referrable_const( std::string, mode );
+            mv_referrable_const( std::string, address );
+            mv_accessible_noset( unsigned, port );
+            mv_referrable_const( std::string, textfile );
+            mv_accessible_noset( unsigned, interval_ms );
+
+        private:
+            virtual void do_cancellation( int a_code );
+
+            std::string scrape();
+
+            void run_http();
+            void run_textfile();
+
+            std::vector< hook_t > f_hooks;
+            std::mutex f_hook_mutex;
+    };
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_METRICS_EXPORTER_HH_ */
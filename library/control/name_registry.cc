@@ -0,0 +1,178 @@
+/*
+ * name_registry.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "name_registry.hh"
+
+#include "sandfly_error.hh"
+
+#include <mutex>
+
+namespace sandfly
+{
+
+    name_registry::name_registry() :
+            f_streams(),
+            f_nodes(),
+            f_stream_ids(),
+            f_full_node_ids(),
+            f_mutex()
+    {}
+
+    name_registry::~name_registry()
+    {}
+
+    stream_id_t name_registry::intern_stream( const std::string& a_stream_name )
+    {
+        std::unique_lock< std::shared_mutex > t_lock( f_mutex );
+        std::unordered_map< std::string, stream_id_t >::const_iterator t_it = f_stream_ids.find( a_stream_name );
+        if( t_it != f_stream_ids.end() ) return t_it->second;
+
+        stream_id_t t_id = f_streams.size();
+        f_streams.push_back( stream_entry() );
+        f_streams.back().f_name = a_stream_name;
+        f_stream_ids[ a_stream_name ] = t_id;
+        return t_id;
+    }
+
+    node_id_t name_registry::intern_node( stream_id_t a_stream_id, const std::string& a_node_name )
+    {
+        std::unique_lock< std::shared_mutex > t_lock( f_mutex );
+        if( a_stream_id >= f_streams.size() )
+        {
+            throw error() << "Invalid stream ID: " << a_stream_id;
+        }
+        stream_entry& t_stream = f_streams[ a_stream_id ];
+        std::unordered_map< std::string, node_id_t >::const_iterator t_it = t_stream.f_nodes.find( a_node_name );
+        if( t_it != t_stream.f_nodes.end() )
+        {
+            // the full name may have been released, and possibly taken by another node in the meantime
+            const std::string& t_full_name = f_nodes[ t_it->second ].f_full_name;
+            std::pair< std::unordered_map< std::string, node_id_t >::iterator, bool > t_claim = f_full_node_ids.insert( std::make_pair( t_full_name, t_it->second ) );
+            if( ! t_claim.second && t_claim.first->second != t_it->second )
+            {
+                throw error() << "Node <" << a_node_name << "> of stream <" << t_stream.f_name << "> has the same full name as an existing node: <" << t_full_name << ">";
+            }
+            return t_it->second;
+        }
+
+        node_entry t_node;
+        t_node.f_stream = a_stream_id;
+        t_node.f_name = a_node_name;
+        t_node.f_full_name = make_full_node_name( t_stream.f_name, a_node_name );
+        if( f_full_node_ids.count( t_node.f_full_name ) != 0 )
+        {
+            throw error() << "Node <" << a_node_name << "> of stream <" << t_stream.f_name << "> has the same full name as an existing node: <" << t_node.f_full_name << ">";
+        }
+
+        node_id_t t_id = f_nodes.size();
+        f_full_node_ids[ t_node.f_full_name ] = t_id;
+        t_stream.f_nodes[ a_node_name ] = t_id;
+        f_nodes.push_back( t_node );
+        return t_id;
+    }
+
+    void name_registry::release_stream( stream_id_t a_stream_id )
+    {
+        std::unique_lock< std::shared_mutex > t_lock( f_mutex );
+        if( a_stream_id >= f_streams.size() )
+        {
+            throw error() << "Invalid stream ID: " << a_stream_id;
+        }
+        const stream_entry& t_stream = f_streams[ a_stream_id ];
+        for( std::unordered_map< std::string, node_id_t >::const_iterator t_node_it = t_stream.f_nodes.begin(); t_node_it != t_stream.f_nodes.end(); ++t_node_it )
+        {
+            std::unordered_map< std::string, node_id_t >::iterator t_full_it = f_full_node_ids.find( f_nodes[ t_node_it->second ].f_full_name );
+            if( t_full_it != f_full_node_ids.end() && t_full_it->second == t_node_it->second ) f_full_node_ids.erase( t_full_it );
+        }
+        return;
+    }
+
+    stream_id_t name_registry::find_stream( const std::string& a_stream_name ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        std::unordered_map< std::string, stream_id_t >::const_iterator t_it = f_stream_ids.find( a_stream_name );
+        return t_it == f_stream_ids.end() ? s_invalid_id : t_it->second;
+    }
+
+    node_id_t name_registry::find_node( stream_id_t a_stream_id, const std::string& a_node_name ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        if( a_stream_id >= f_streams.size() ) return s_invalid_id;
+        const stream_entry& t_stream = f_streams[ a_stream_id ];
+        std::unordered_map< std::string, node_id_t >::const_iterator t_it = t_stream.f_nodes.find( a_node_name );
+        return t_it == t_stream.f_nodes.end() ? s_invalid_id : t_it->second;
+    }
+
+    node_id_t name_registry::find_node( const std::string& a_stream_name, const std::string& a_node_name ) const
+    {
+        return find_node( find_stream( a_stream_name ), a_node_name );
+    }
+
+    node_id_t name_registry::find_node( const std::string& a_full_name ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        std::unordered_map< std::string, node_id_t >::const_iterator t_it = f_full_node_ids.find( a_full_name );
+        return t_it == f_full_node_ids.end() ? s_invalid_id : t_it->second;
+    }
+
+    const std::string& name_registry::stream_name( stream_id_t a_stream_id ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        if( a_stream_id >= f_streams.size() )
+        {
+            throw error() << "Invalid stream ID: " << a_stream_id;
+        }
+        return f_streams[ a_stream_id ].f_name;
+    }
+
+    const std::string& name_registry::node_name( node_id_t a_node_id ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        if( a_node_id >= f_nodes.size() )
+        {
+            throw error() << "Invalid node ID: " << a_node_id;
+        }
+        return f_nodes[ a_node_id ].f_name;
+    }
+
+    const std::string& name_registry::full_node_name( node_id_t a_node_id ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        if( a_node_id >= f_nodes.size() )
+        {
+            throw error() << "Invalid node ID: " << a_node_id;
+        }
+        return f_nodes[ a_node_id ].f_full_name;
+    }
+
+    stream_id_t name_registry::node_stream( node_id_t a_node_id ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        if( a_node_id >= f_nodes.size() )
+        {
+            throw error() << "Invalid node ID: " << a_node_id;
+        }
+        return f_nodes[ a_node_id ].f_stream;
+    }
+
+    unsigned name_registry::n_streams() const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        return f_streams.size();
+    }
+
+    unsigned name_registry::n_nodes() const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        return f_nodes.size();
+    }
+
+    std::string name_registry::make_full_node_name( const std::string& a_stream_name, const std::string& a_node_name )
+    {
+        return a_stream_name + "_" + a_node_name;
+    }
+
+} /* namespace sandfly */
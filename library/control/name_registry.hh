@@ -0,0 +1,98 @@
+/*
+ * name_registry.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_NAME_REGISTRY_HH_
+#define SANDFLY_NAME_REGISTRY_HH_
+
+#include <deque>
+#include <limits>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sandfly
+{
+    typedef unsigned stream_id_t;
+    typedef unsigned node_id_t;
+
+    /*!
+     @class name_registry
+
+     @brief Interns stream and node names as dense integer IDs
+
+     @details
+     stream_manager interns the names when a stream is added; after that, nodes are referred to by ID,
+     and the string lookups are only needed at the edges (requests and logging).
+
+     IDs start at 0 and are never reused for a different name, so they can index contiguous tables (see active_node_bindings).
+     When a stream is removed, release_stream() frees the full names of its nodes for other streams' nodes; its IDs and names stay valid.
+     A stream that's removed and added again gets its old IDs back.
+
+     A node's full name ([stream]_[node]) is made once, when the node is interned; it's the name used in midge.
+
+     All functions are thread-safe; interning takes an exclusive lock and lookups take a shared lock.
+     References to names stay valid for the lifetime of the registry.
+     */
+    class name_registry
+    {
+        public:
+            static constexpr unsigned s_invalid_id = std::numeric_limits< unsigned >::max();
+
+        public:
+            name_registry();
+            virtual ~name_registry();
+
+            stream_id_t intern_stream( const std::string& a_stream_name );
+            /// Throws sandfly::error if another node has the same full name
+            node_id_t intern_node( stream_id_t a_stream_id, const std::string& a_node_name );
+            /// Frees the full names of the stream's nodes; interning the nodes again claims them back
+            void release_stream( stream_id_t a_stream_id );
+
+            /// The find functions return s_invalid_id if the name has not been interned
+            stream_id_t find_stream( const std::string& a_stream_name ) const;
+            node_id_t find_node( stream_id_t a_stream_id, const std::string& a_node_name ) const;
+            node_id_t find_node( const std::string& a_stream_name, const std::string& a_node_name ) const;
+            /// Finds a node by its full name ([stream]_[node])
+            node_id_t find_node( const std::string& a_full_name ) const;
+
+            /// The name functions throw sandfly::error if the ID is not valid
+            const std::string& stream_name( stream_id_t a_stream_id ) const;
+            const std::string& node_name( node_id_t a_node_id ) const;
+            const std::string& full_node_name( node_id_t a_node_id ) const;
+            stream_id_t node_stream( node_id_t a_node_id ) const;
+
+            unsigned n_streams() const;
+            unsigned n_nodes() const;
+
+            /// The full name ([stream]_[node]) a node gets when it's interned
+            static std::string make_full_node_name( const std::string& a_stream_name, const std::string& a_node_name );
+
+        private:
+            struct stream_entry
+            {
+                std::string f_name;
+                std::unordered_map< std::string, node_id_t > f_nodes;
+            };
+            struct node_entry
+            {
+                stream_id_t f_stream;
+                std::string f_name;
+                std::string f_full_name;
+            };
+
+            // deques, so that references to the names aren't invalidated when more are interned
+            std::deque< stream_entry > f_streams;
+            std::deque< node_entry > f_nodes;
+            std::unordered_map< std::string, stream_id_t > f_stream_ids;
+            std::unordered_map< std::string, node_id_t > f_full_node_ids;
+
+            mutable std::shared_mutex f_mutex;
+    };
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_NAME_REGISTRY_HH_ */
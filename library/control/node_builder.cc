@@ -9,6 +9,21 @@
 
 namespace sandfly
 {
+    //*******************
+    // node_statistics
+    //*******************
+
+    void node_statistics::to_param( scarab::param_node& a_node ) const
+    {
+        if( f_records >= 0 ) a_node.add( "records", scarab::param_value( f_records ) );
+        if( f_bytes >= 0 ) a_node.add( "bytes", scarab::param_value( f_bytes ) );
+        if( f_drops >= 0 ) a_node.add( "drops", scarab::param_value( f_drops ) );
+        if( f_buffer_occupancy >= 0. ) a_node.add( "buffer-occupancy", scarab::param_value( f_buffer_occupancy ) );
+        if( f_busy_time_s >= 0. ) a_node.add( "busy-time-s", scarab::param_value( f_busy_time_s ) );
+        if( ! f_extra.empty() ) a_node.merge( f_extra );
+        return;
+    }
+
     //****************
     // node_binding
     //****************
@@ -24,6 +39,23 @@ namespace sandfly
         return *this;
     }
 
+    const node_config_schema* node_binding::config_schema() const
+    {
+        return nullptr;
+    }
+
+    void node_binding::validate_config( const scarab::param_node& a_config ) const
+    {
+        const node_config_schema* t_schema = config_schema();
+        if( t_schema != nullptr ) t_schema->validate( a_config );
+        return;
+    }
+
+    void node_binding::apply_typed_config( midge::node*, const typed_node_config& ) const
+    {
+        throw error() << "The node binding does not apply typed configs";
+    }
+
 
     //****************
     // node_builder
@@ -33,7 +65,9 @@ namespace sandfly
             node_binding(),
             f_binding( a_binding ),
             f_config(),
-            f_name()
+            f_typed_config(),
+            f_name(),
+            f_node_id( name_registry::s_invalid_id )
     {
     }
 
@@ -47,6 +81,7 @@ namespace sandfly
         delete f_binding;
         f_binding = a_rhs.f_binding->clone();
         f_config = a_rhs.f_config;
+        f_typed_config = a_rhs.f_typed_config;
         f_name = a_rhs.f_name;
         this->node_binding::operator=( a_rhs );
         return *this;
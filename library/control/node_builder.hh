@@ -8,11 +8,15 @@
 #ifndef SANDFLY_NODE_BUILDER_HH_
 #define SANDFLY_NODE_BUILDER_HH_
 
+#include "name_registry.hh"
+#include "node_config_schema.hh"
 #include "sandfly_error.hh"
 
 #include "member_variables.hh"
 #include "param.hh"
 
+#include <cstdint>
+
 namespace midge
 {
     class node;
@@ -20,6 +24,32 @@ namespace midge
 
 namespace sandfly
 {
+    //*******************
+    // node_statistics
+    //*******************
+
+    /*!
+     @struct node_statistics
+
+     @brief Runtime statistics reported by a node through its binding
+
+     @details
+     Nodes fill in whichever quantities they track; the others are left at their default values and are not reported.
+     Quantities that don't fit the standard fields can be added to f_extra.
+     */
+    struct node_statistics
+    {
+        int64_t f_records = -1; // records (or other units of data) processed
+        int64_t f_bytes = -1; // bytes processed
+        int64_t f_drops = -1; // records dropped
+        double f_buffer_occupancy = -1.; // fraction of the output buffer in use, from 0 to 1
+        double f_busy_time_s = -1.; // time spent processing, in seconds
+        scarab::param_node f_extra;
+
+        /// Adds the quantities that were filled in to a_node
+        void to_param( scarab::param_node& a_node ) const;
+    };
+
     //****************
     // node_binding
     //****************
@@ -34,6 +64,12 @@ namespace sandfly
      Every midge node has a binding class that inherits from node_binding.
      An instance of these binding classes is created by the stream_manager who adds them to the midge object together with the node class.
      The binding classes allow to apply and dump node configurations and do run commands while the daq is activated.
+     Bindings can optionally report the node's runtime statistics (get_statistics()); run_control includes them in the daq-status reply.
+
+     Bindings can optionally define a config schema (see node_config_schema); it's made once per node type.
+     If there is one, configs are validated against it when they're given to the node_builder (i.e. at add_stream and configure_node)
+     and when they're applied to an active node, and the builder applies the converted values when it builds the node.
+     A binding with a schema applies the converted values directly (do_apply_typed_config(); _table_node_binding does this from its table).
      */
     class node_binding
     {
@@ -57,6 +93,18 @@ namespace sandfly
             /// Throws sandfly::error if the command fails, and returns false if the command is unrecognized
             virtual bool run_command( midge::node* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const = 0;
 
+            /// Gets the runtime statistics from the given node; this is called while the node is running, so it should only read values that are safe to read from another thread
+            /// Throws sandfly::error if the node is the wrong type, and returns false if the node does not report statistics
+            virtual bool get_statistics( const midge::node* a_node, node_statistics& a_stats ) const = 0;
+
+            /// Schema of the node type's configuration, or nullptr if the binding doesn't define one
+            virtual const node_config_schema* config_schema() const;
+            /// Throws sandfly::error if there is a schema and a_config (which can be partial) doesn't satisfy it
+            void validate_config( const scarab::param_node& a_config ) const;
+            /// Applies a config that was converted by the binding's schema
+            /// Throws sandfly::error if the node is of the wrong type, if applying the configuration fails, or if the binding doesn't apply typed configs
+            virtual void apply_typed_config( midge::node* a_node, const typed_node_config& a_config ) const;
+
     };
 
 
@@ -81,6 +129,11 @@ namespace sandfly
 
             virtual bool run_command( midge::node* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const;
 
+            virtual bool get_statistics( const midge::node* a_node, node_statistics& a_stats ) const;
+
+            virtual const node_config_schema* config_schema() const;
+            virtual void apply_typed_config( midge::node* a_node, const typed_node_config& a_config ) const;
+
         private:
             virtual void do_apply_config( x_node_type* a_node, const scarab::param_node& a_config ) const = 0;
             virtual void do_dump_config( const x_node_type* a_node, scarab::param_node& a_config ) const = 0;
@@ -88,6 +141,15 @@ namespace sandfly
             /// in derived classes, should throw a std::exception if the command fails, and return false if the command is unrecognized
             virtual bool do_run_command( x_node_type* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const;
 
+            /// optional; in derived classes, should fill in the statistics the node tracks and return true
+            virtual bool do_get_statistics( const x_node_type* a_node, node_statistics& a_stats ) const;
+
+            /// optional; in derived classes, should add the node type's fields to a_schema and return true
+            /// it's called once per node type, the first time the schema is needed
+            virtual bool do_define_config_schema( node_config_schema& a_schema ) const;
+            /// required if do_define_config_schema() is implemented (_table_node_binding provides both); the default throws sandfly::error
+            virtual void do_apply_typed_config( x_node_type* a_node, const typed_node_config& a_config ) const;
+
     };
 
 
@@ -103,6 +165,10 @@ namespace sandfly
      @details
      stream_manager creates a node_builder instance for every node in a stream and passes the node configuration to the node_builder.
      Fresh copies of a node class and a node binding class can then be made from these node_builder classes.
+
+     If the binding has a config schema, configure_builder() and replace_builder_config() validate and convert the merged config,
+     and throw sandfly::error (leaving the builder's config unchanged) if it's invalid; build() and apply_builder_config()
+     then apply the converted values.
      */
     class node_builder : public node_binding
     {
@@ -124,10 +190,16 @@ namespace sandfly
             void replace_builder_config( const scarab::param_node& a_config );
             void dump_builder_config( scarab::param_node& a_config );
 
+            /// Applies the builder's configuration to an existing node
+            void apply_builder_config( midge::node* a_node ) const;
+
         protected:
             scarab::param_node f_config;
+            typed_node_config f_typed_config; // empty if the binding has no schema
 
             mv_referrable( std::string, name );
+            /// ID of the node in the stream_manager's name_registry
+            mv_accessible( node_id_t, node_id );
 
         public:
             virtual void apply_config( midge::node* a_node, const scarab::param_node& a_config ) const;
@@ -135,6 +207,11 @@ namespace sandfly
 
             virtual bool run_command( midge::node* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const;
 
+            virtual bool get_statistics( const midge::node* a_node, node_statistics& a_stats ) const;
+
+            virtual const node_config_schema* config_schema() const;
+            virtual void apply_typed_config( midge::node* a_node, const typed_node_config& a_config ) const;
+
     };
 
 
@@ -204,6 +281,7 @@ namespace sandfly
         {
             throw error() << "Node type does not match builder type (apply_config(node*))";
         }
+        validate_config( a_config );
         try
         {
             do_apply_config( t_derived_node, a_config );
@@ -258,6 +336,73 @@ namespace sandfly
         return false;
     }
 
+    template< class x_node_type, class x_node_binding >
+    bool _node_binding< x_node_type, x_node_binding >::get_statistics( const midge::node* a_node, node_statistics& a_stats ) const
+    {
+        const x_node_type* t_derived_node = dynamic_cast< const x_node_type* >( a_node );
+        if( t_derived_node == nullptr )
+        {
+            throw error() << "Node type does not match builder type (get_statistics(node*, node_statistics&))";
+        }
+        try
+        {
+            return do_get_statistics( t_derived_node, a_stats );
+        }
+        catch( std::exception& e )
+        {
+            throw error() << e.what();
+        }
+    }
+
+    template< class x_node_type, class x_node_binding >
+    bool _node_binding< x_node_type, x_node_binding >::do_get_statistics( const x_node_type*, node_statistics& ) const
+    {
+        return false;
+    }
+
+    template< class x_node_type, class x_node_binding >
+    const node_config_schema* _node_binding< x_node_type, x_node_binding >::config_schema() const
+    {
+        // made once per node type; a binding without a schema leaves it null
+        static const std::unique_ptr< const node_config_schema > s_schema( [this](){
+                    std::unique_ptr< node_config_schema > t_schema( new node_config_schema() );
+                    if( ! do_define_config_schema( *t_schema ) ) t_schema.reset();
+                    return t_schema.release();
+                }() );
+        return s_schema.get();
+    }
+
+    template< class x_node_type, class x_node_binding >
+    bool _node_binding< x_node_type, x_node_binding >::do_define_config_schema( node_config_schema& ) const
+    {
+        return false;
+    }
+
+    template< class x_node_type, class x_node_binding >
+    void _node_binding< x_node_type, x_node_binding >::apply_typed_config( midge::node* a_node, const typed_node_config& a_config ) const
+    {
+        x_node_type* t_derived_node = dynamic_cast< x_node_type* >( a_node );
+        if( t_derived_node == nullptr )
+        {
+            throw error() << "Node type does not match builder type (apply_typed_config(node*))";
+        }
+        try
+        {
+            do_apply_typed_config( t_derived_node, a_config );
+        }
+        catch( std::exception& e )
+        {
+            throw error() << e.what();
+        }
+        return;
+    }
+
+    template< class x_node_type, class x_node_binding >
+    void _node_binding< x_node_type, x_node_binding >::do_apply_typed_config( x_node_type*, const typed_node_config& ) const
+    {
+        throw error() << "The node binding defines a config schema but does not apply typed configs";
+    }
+
 
     //****************
     // node_builder
@@ -270,17 +415,29 @@ namespace sandfly
 
     inline void node_builder::configure_builder( const scarab::param_node& a_config )
     {
-        f_config.merge( a_config );
+        scarab::param_node t_config( f_config );
+        t_config.merge( a_config );
+        replace_builder_config( t_config );
         return;
     }
 
     inline void node_builder::replace_builder_config( const scarab::param_node& a_config )
     {
+        const node_config_schema* t_schema = f_binding->config_schema();
+        // convert first, so that an invalid config leaves the builder unchanged
+        if( t_schema != nullptr ) f_typed_config = t_schema->convert( a_config );
         f_config.clear();
         f_config.merge( a_config );
         return;
     }
 
+    inline void node_builder::apply_builder_config( midge::node* a_node ) const
+    {
+        if( f_binding->config_schema() != nullptr ) f_binding->apply_typed_config( a_node, f_typed_config );
+        else f_binding->apply_config( a_node, f_config );
+        return;
+    }
+
     inline void node_builder::dump_builder_config( scarab::param_node& a_config )
     {
         a_config.clear();
@@ -305,6 +462,22 @@ namespace sandfly
         return f_binding->run_command( a_node, a_cmd, a_args );
     }
 
+    inline bool node_builder::get_statistics( const midge::node* a_node, node_statistics& a_stats ) const
+    {
+        return f_binding->get_statistics( a_node, a_stats );
+    }
+
+    inline const node_config_schema* node_builder::config_schema() const
+    {
+        return f_binding->config_schema();
+    }
+
+    inline void node_builder::apply_typed_config( midge::node* a_node, const typed_node_config& a_config ) const
+    {
+        f_binding->apply_typed_config( a_node, a_config );
+        return;
+    }
+
 
     //*****************
     // _node_builder
@@ -350,7 +523,19 @@ namespace sandfly
         dump_config( t_node, f_config );
         f_config.merge( t_temp_config );
 
-        apply_config( t_node, f_config );
+        if( config_schema() != nullptr )
+        {
+            // the config was validated and converted when it was given to the builder;
+            // f_config also gets the converted values (including the schema's defaults), so that it matches what was applied
+            scarab::param_node t_typed_config;
+            f_typed_config.to_param( t_typed_config );
+            f_config.merge( t_typed_config );
+            apply_typed_config( t_node, f_typed_config );
+        }
+        else
+        {
+            apply_config( t_node, f_config );
+        }
         t_node->set_name( f_name );
 
         return t_node;
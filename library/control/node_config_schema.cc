@@ -0,0 +1,362 @@
+/*
+ * node_config_schema.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "node_config_schema.hh"
+
+#include <limits>
+#include <sstream>
+
+namespace sandfly
+{
+
+    std::string config_type_to_string( config_type a_type )
+    {
+        switch( a_type )
+        {
+            case config_type::boolean: return "boolean";
+            case config_type::integer: return "integer";
+            case config_type::unsigned_integer: return "unsigned integer";
+            case config_type::real: return "real";
+            case config_type::string: return "string";
+            case config_type::node: return "node";
+            case config_type::array: return "array";
+            default: return "unknown";
+        }
+    }
+
+    //********************
+    // config_key_index
+    //********************
+
+    config_key_index::config_key_index() :
+            f_seed( 0 ),
+            f_mask( 0 ),
+            f_slots( 1, -1 ),
+            f_keys()
+    {}
+
+    void config_key_index::build( const std::vector< std::string >& a_keys )
+    {
+        // start with a table at least twice the number of keys; seeds are tried on each size before it's doubled
+        uint64_t t_size = 1;
+        while( t_size < 2 * a_keys.size() ) t_size <<= 1;
+
+        static const uint64_t s_seeds_per_size = 64;
+        while( true )
+        {
+            for( uint64_t t_seed = 1; t_seed <= s_seeds_per_size; ++t_seed )
+            {
+                std::vector< int > t_slots( t_size, -1 );
+                bool t_collision = false;
+                for( unsigned i_key = 0; i_key < a_keys.size() && ! t_collision; ++i_key )
+                {
+                    int& t_slot = t_slots[ hash( a_keys[ i_key ], t_seed ) & (t_size - 1) ];
+                    if( t_slot >= 0 ) t_collision = true;
+                    else t_slot = int(i_key);
+                }
+                if( t_collision ) continue;
+
+                f_seed = t_seed;
+                f_mask = t_size - 1;
+                f_slots.swap( t_slots );
+                f_keys = a_keys;
+                return;
+            }
+            t_size <<= 1;
+        }
+    }
+
+    int config_key_index::find( const std::string& a_key ) const
+    {
+        int t_position = f_slots[ hash( a_key, f_seed ) & f_mask ];
+        if( t_position < 0 || f_keys[ t_position ] != a_key ) return -1;
+        return t_position;
+    }
+
+    uint64_t config_key_index::hash( const std::string& a_key, uint64_t a_seed )
+    {
+        // FNV-1a, with the seed mixed into the offset basis
+        uint64_t t_hash = 14695981039346656037ULL ^ (a_seed * 0x9e3779b97f4a7c15ULL);
+        for( std::string::const_iterator t_it = a_key.begin(); t_it != a_key.end(); ++t_it )
+        {
+            t_hash ^= uint64_t( static_cast< unsigned char >( *t_it ) );
+            t_hash *= 1099511628211ULL;
+        }
+        return t_hash;
+    }
+
+    //**********************
+    // node_config_schema
+    //**********************
+
+    node_config_schema::node_config_schema() :
+            f_fields(),
+            f_index(),
+            f_ignored_keys()
+    {
+        f_ignored_keys.insert( "device" );
+    }
+
+    node_config_schema::~node_config_schema()
+    {}
+
+    node_config_schema& node_config_schema::add( const std::string& a_key, config_type a_type )
+    {
+        if( find( a_key ) >= 0 )
+        {
+            throw error() << "Config schema already has a field called <" << a_key << ">";
+        }
+        field t_field;
+        t_field.f_key = a_key;
+        t_field.f_type = a_type;
+        f_fields.push_back( t_field );
+
+        std::vector< std::string > t_keys;
+        for( std::vector< field >::const_iterator t_it = f_fields.begin(); t_it != f_fields.end(); ++t_it )
+        {
+            t_keys.push_back( t_it->f_key );
+        }
+        f_index.build( t_keys );
+        return *this;
+    }
+
+    node_config_schema& node_config_schema::range( double a_min, double a_max )
+    {
+        return min( a_min ).max( a_max );
+    }
+
+    node_config_schema& node_config_schema::min( double a_min )
+    {
+        last_field().f_has_min = true;
+        last_field().f_min = a_min;
+        return *this;
+    }
+
+    node_config_schema& node_config_schema::max( double a_max )
+    {
+        last_field().f_has_max = true;
+        last_field().f_max = a_max;
+        return *this;
+    }
+
+    node_config_schema& node_config_schema::default_value( const scarab::param& a_default )
+    {
+        std::string t_problem;
+        config_value t_default = convert_value( last_field(), a_default, t_problem );
+        if( ! t_problem.empty() )
+        {
+            throw error() << "Invalid default for config field <" << last_field().f_key << ">: " << t_problem;
+        }
+        last_field().f_default = t_default;
+        return *this;
+    }
+
+    node_config_schema& node_config_schema::default_value( const scarab::param_value& a_default )
+    {
+        return default_value( static_cast< const scarab::param& >( a_default ) );
+    }
+
+    node_config_schema& node_config_schema::required()
+    {
+        last_field().f_required = true;
+        return *this;
+    }
+
+    void node_config_schema::ignore_key( const std::string& a_key )
+    {
+        f_ignored_keys.insert( a_key );
+        return;
+    }
+
+    int node_config_schema::find( const std::string& a_key ) const
+    {
+        return f_index.find( a_key );
+    }
+
+    unsigned node_config_schema::index_of( const std::string& a_key ) const
+    {
+        int t_index = find( a_key );
+        if( t_index < 0 )
+        {
+            throw error() << "Config schema has no field called <" << a_key << ">";
+        }
+        return unsigned(t_index);
+    }
+
+    void node_config_schema::validate( const scarab::param_node& a_config ) const
+    {
+        std::vector< std::string > t_problems;
+        check( a_config, t_problems, nullptr );
+        throw_problems( t_problems );
+        return;
+    }
+
+    typed_node_config node_config_schema::convert( const scarab::param_node& a_config ) const
+    {
+        std::vector< std::string > t_problems;
+        std::vector< config_value > t_values( f_fields.size() );
+        check( a_config, t_problems, &t_values );
+
+        for( unsigned i_field = 0; i_field < f_fields.size(); ++i_field )
+        {
+            if( ! std::holds_alternative< std::monostate >( t_values[ i_field ] ) ) continue;
+            if( f_fields[ i_field ].f_required )
+            {
+                t_problems.push_back( "<" + f_fields[ i_field ].f_key + "> is required" );
+                continue;
+            }
+            t_values[ i_field ] = f_fields[ i_field ].f_default;
+        }
+
+        throw_problems( t_problems );
+
+        return typed_node_config( this, std::move( t_values ) );
+    }
+
+    void node_config_schema::throw_problems( const std::vector< std::string >& a_problems )
+    {
+        if( a_problems.empty() ) return;
+
+        error t_error;
+        t_error << "Invalid config:";
+        for( std::vector< std::string >::const_iterator t_it = a_problems.begin(); t_it != a_problems.end(); ++t_it )
+        {
+            t_error << " " << *t_it << ";";
+        }
+        throw t_error;
+    }
+
+    node_config_schema::field& node_config_schema::last_field()
+    {
+        if( f_fields.empty() )
+        {
+            throw error() << "Config schema has no fields yet";
+        }
+        return f_fields.back();
+    }
+
+    void node_config_schema::check( const scarab::param_node& a_config, std::vector< std::string >& a_problems, std::vector< config_value >* a_values ) const
+    {
+        for( scarab::param_node::const_iterator t_it = a_config.begin(); t_it != a_config.end(); ++t_it )
+        {
+            int t_index = find( t_it.name() );
+            if( t_index < 0 )
+            {
+                if( f_ignored_keys.count( t_it.name() ) == 0 ) a_problems.push_back( "unknown parameter <" + t_it.name() + ">" );
+                continue;
+            }
+
+            std::string t_problem;
+            config_value t_value = convert_value( f_fields[ t_index ], *t_it, t_problem );
+            if( ! t_problem.empty() )
+            {
+                a_problems.push_back( "<" + t_it.name() + ">: " + t_problem );
+                continue;
+            }
+            if( a_values != nullptr ) (*a_values)[ t_index ] = t_value;
+        }
+        return;
+    }
+
+    config_value node_config_schema::convert_value( const field& a_field, const scarab::param& a_value, std::string& a_problem )
+    {
+        if( a_field.f_type == config_type::node )
+        {
+            if( ! a_value.is_node() ) a_problem = "expected a node";
+            else return config_value( std::shared_ptr< const scarab::param >( a_value.clone() ) );
+            return config_value();
+        }
+        if( a_field.f_type == config_type::array )
+        {
+            if( ! a_value.is_array() ) a_problem = "expected an array";
+            else return config_value( std::shared_ptr< const scarab::param >( a_value.clone() ) );
+            return config_value();
+        }
+        if( ! a_value.is_value() )
+        {
+            a_problem = "expected a " + config_type_to_string( a_field.f_type ) + " value";
+            return config_value();
+        }
+
+        const scarab::param_value& t_value = a_value.as_value();
+        bool t_is_number = t_value.is_int() || t_value.is_uint() || t_value.is_double();
+        double t_number = t_is_number ? t_value.as_double() : 0.;
+
+        config_value t_converted;
+        switch( a_field.f_type )
+        {
+            case config_type::boolean:
+                if( t_value.is_bool() ) t_converted = t_value.as_bool();
+                break;
+            case config_type::integer:
+                if( t_value.is_int() ) t_converted = int64_t( t_value.as< int64_t >() );
+                else if( t_value.is_uint() && t_value.as< uint64_t >() <= uint64_t( std::numeric_limits< int64_t >::max() ) ) t_converted = int64_t( t_value.as< uint64_t >() );
+                break;
+            case config_type::unsigned_integer:
+                if( t_value.is_uint() ) t_converted = uint64_t( t_value.as< uint64_t >() );
+                else if( t_value.is_int() && t_value.as< int64_t >() >= 0 ) t_converted = uint64_t( t_value.as< int64_t >() );
+                break;
+            case config_type::real:
+                if( t_is_number ) t_converted = t_number;
+                break;
+            case config_type::string:
+                if( t_value.is_string() ) t_converted = t_value.as_string();
+                break;
+            default:
+                break;
+        }
+
+        if( std::holds_alternative< std::monostate >( t_converted ) )
+        {
+            a_problem = "expected a " + config_type_to_string( a_field.f_type ) + " value, got <" + t_value.to_string() + ">";
+            return config_value();
+        }
+
+        if( t_is_number && ((a_field.f_has_min && t_number < a_field.f_min) || (a_field.f_has_max && t_number > a_field.f_max)) )
+        {
+            std::stringstream t_range;
+            t_range << "value " << t_value.to_string() << " is outside of the range [" << (a_field.f_has_min ? a_field.f_min : -std::numeric_limits< double >::infinity())
+                    << ", " << (a_field.f_has_max ? a_field.f_max : std::numeric_limits< double >::infinity()) << "]";
+            a_problem = t_range.str();
+            return config_value();
+        }
+
+        return t_converted;
+    }
+
+    //*********************
+    // typed_node_config
+    //*********************
+
+    typed_node_config::typed_node_config() :
+            f_schema( nullptr ),
+            f_values()
+    {}
+
+    typed_node_config::typed_node_config( const node_config_schema* a_schema, std::vector< config_value >&& a_values ) :
+            f_schema( a_schema ),
+            f_values( std::move( a_values ) )
+    {}
+
+    void typed_node_config::to_param( scarab::param_node& a_config ) const
+    {
+        if( f_schema == nullptr ) return;
+
+        for( unsigned i_field = 0; i_field < f_values.size(); ++i_field )
+        {
+            const std::string& t_key = f_schema->fields()[ i_field ].f_key;
+            const config_value& t_value = f_values[ i_field ];
+            if( const bool* t_bool = std::get_if< bool >( &t_value ) ) a_config.replace( t_key, scarab::param_value( *t_bool ) );
+            else if( const int64_t* t_int = std::get_if< int64_t >( &t_value ) ) a_config.replace( t_key, scarab::param_value( *t_int ) );
+            else if( const uint64_t* t_uint = std::get_if< uint64_t >( &t_value ) ) a_config.replace( t_key, scarab::param_value( *t_uint ) );
+            else if( const double* t_double = std::get_if< double >( &t_value ) ) a_config.replace( t_key, scarab::param_value( *t_double ) );
+            else if( const std::string* t_string = std::get_if< std::string >( &t_value ) ) a_config.replace( t_key, scarab::param_value( *t_string ) );
+            else if( const std::shared_ptr< const scarab::param >* t_param = std::get_if< std::shared_ptr< const scarab::param > >( &t_value ) ) a_config.replace( t_key, **t_param );
+        }
+        return;
+    }
+
+} /* namespace sandfly */
@@ -0,0 +1,224 @@
+/*
+ * node_config_schema.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_NODE_CONFIG_SCHEMA_HH_
+#define SANDFLY_NODE_CONFIG_SCHEMA_HH_
+
+#include "sandfly_error.hh"
+
+#include "param.hh"
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace sandfly
+{
+    enum class config_type
+    {
+        boolean,
+        integer,
+        unsigned_integer,
+        real,
+        string,
+        node,
+        array
+    };
+    std::string config_type_to_string( config_type a_type );
+
+    /// A converted config value; std::monostate means the value is not set
+    typedef std::variant< std::monostate, bool, int64_t, uint64_t, double, std::string, std::shared_ptr< const scarab::param > > config_value;
+
+    class typed_node_config;
+
+    /*!
+     @class config_key_index
+
+     @brief Perfect hash from a fixed set of keys to their positions
+
+     @details
+     build() searches for a hash seed (and, if needed, a larger table) for which no two keys share a slot,
+     so find() is one hash of the key and one string comparison, and it doesn't allocate.
+     */
+    class config_key_index
+    {
+        public:
+            config_key_index();
+
+            /// The keys must be unique
+            void build( const std::vector< std::string >& a_keys );
+
+            /// Returns the position of the key in the vector given to build(), or -1 if it's not one of the keys
+            int find( const std::string& a_key ) const;
+
+        private:
+            static uint64_t hash( const std::string& a_key, uint64_t a_seed );
+
+            uint64_t f_seed;
+            uint64_t f_mask;
+            std::vector< int > f_slots; // position of the key in each slot, or -1
+            std::vector< std::string > f_keys;
+    };
+
+    /*!
+     @class node_config_schema
+
+     @brief Describes the configuration parameters of a node type: keys, types, ranges, and defaults
+
+     @details
+     A node binding defines its schema once per node type (see _node_binding::do_define_config_schema()), e.g.:
+
+         a_schema.add( "rate", config_type::real ).range( 0., 1.e9 ).default_value( 100. );
+         a_schema.add( "n-channels", config_type::unsigned_integer ).required();
+
+     The fields are numbered in the order they're added; the number is the field's index in a typed_node_config.
+
+     validate() checks a partial config (e.g. an active-config request): every key must be a field (or an ignored key),
+     and every value must have the field's type and be within its range.
+     convert() additionally requires the required fields, fills in the defaults, and returns the typed values.
+     Both throw sandfly::error listing all of the problems found.
+
+     Type conversions: integer fields accept signed and unsigned values that fit; unsigned fields accept non-negative integers;
+     real fields accept any number; node and array fields keep a copy of the param.
+
+     The "device" key is ignored by default, since stream_manager adds the stream-wide device config to every node's config.
+
+     Keys are looked up with a perfect hash (config_key_index) that's rebuilt whenever a field is added.
+     */
+    class node_config_schema
+    {
+        public:
+            struct field
+            {
+                std::string f_key;
+                config_type f_type;
+                bool f_has_min = false;
+                double f_min = 0.;
+                bool f_has_max = false;
+                double f_max = 0.;
+                bool f_required = false;
+                config_value f_default; // std::monostate if there's no default
+            };
+
+        public:
+            node_config_schema();
+            virtual ~node_config_schema();
+
+            /// Adds a field; range(), default_value(), and required() apply to the field added last
+            node_config_schema& add( const std::string& a_key, config_type a_type );
+            /// Inclusive range for numeric fields
+            node_config_schema& range( double a_min, double a_max );
+            node_config_schema& min( double a_min );
+            node_config_schema& max( double a_max );
+            /// Throws sandfly::error if the default doesn't fit the field
+            node_config_schema& default_value( const scarab::param& a_default );
+            node_config_schema& default_value( const scarab::param_value& a_default );
+            node_config_schema& required();
+
+            /// Keys that are allowed in configs but are not fields
+            void ignore_key( const std::string& a_key );
+
+            const std::vector< field >& fields() const;
+            /// Returns the index of the field, or -1 if there's no such field
+            int find( const std::string& a_key ) const;
+            /// Throws sandfly::error if there's no such field
+            unsigned index_of( const std::string& a_key ) const;
+
+            void validate( const scarab::param_node& a_config ) const;
+            typed_node_config convert( const scarab::param_node& a_config ) const;
+
+        private:
+            field& last_field();
+
+            // converts a value to a field's type; returns std::monostate and sets a_problem if that's not possible
+            static config_value convert_value( const field& a_field, const scarab::param& a_value, std::string& a_problem );
+
+            // checks every key in a_config; converted values are put in a_values if it's not null
+            void check( const scarab::param_node& a_config, std::vector< std::string >& a_problems, std::vector< config_value >* a_values ) const;
+
+            // throws sandfly::error listing the problems, if there are any
+            static void throw_problems( const std::vector< std::string >& a_problems );
+
+            std::vector< field > f_fields;
+            config_key_index f_index;
+            std::set< std::string > f_ignored_keys;
+    };
+
+    /*!
+     @class typed_node_config
+
+     @brief Config values converted by a node_config_schema, indexed by field
+     */
+    class typed_node_config
+    {
+        public:
+            typed_node_config();
+            typed_node_config( const node_config_schema* a_schema, std::vector< config_value >&& a_values );
+
+            const node_config_schema* schema() const;
+            bool empty() const;
+
+            bool has( unsigned a_index ) const;
+            /// Throws sandfly::error if the value is not set or is not of type T
+            template< typename T >
+            const T& get( unsigned a_index ) const;
+            const config_value& value( unsigned a_index ) const;
+
+            /// Adds the values that are set to a_config
+            void to_param( scarab::param_node& a_config ) const;
+
+        private:
+            const node_config_schema* f_schema;
+            std::vector< config_value > f_values;
+    };
+
+
+    inline const std::vector< node_config_schema::field >& node_config_schema::fields() const
+    {
+        return f_fields;
+    }
+
+    inline const node_config_schema* typed_node_config::schema() const
+    {
+        return f_schema;
+    }
+
+    inline bool typed_node_config::empty() const
+    {
+        return f_schema == nullptr;
+    }
+
+    inline bool typed_node_config::has( unsigned a_index ) const
+    {
+        return a_index < f_values.size() && ! std::holds_alternative< std::monostate >( f_values[ a_index ] );
+    }
+
+    inline const config_value& typed_node_config::value( unsigned a_index ) const
+    {
+        return f_values.at( a_index );
+    }
+
+    template< typename T >
+    const T& typed_node_config::get( unsigned a_index ) const
+    {
+        if( ! has( a_index ) )
+        {
+            throw error() << "Config value " << a_index << " is not set";
+        }
+        const T* t_value = std::get_if< T >( &f_values[ a_index ] );
+        if( t_value == nullptr )
+        {
+            throw error() << "Config value <" << f_schema->fields()[ a_index ].f_key << "> was requested with the wrong type; it is " << config_type_to_string( f_schema->fields()[ a_index ].f_type );
+        }
+        return *t_value;
+    }
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_NODE_CONFIG_SCHEMA_HH_ */
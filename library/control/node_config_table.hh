@@ -0,0 +1,383 @@
+/*
+ * node_config_table.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_NODE_CONFIG_TABLE_HH_
+#define SANDFLY_NODE_CONFIG_TABLE_HH_
+
+#include "node_builder.hh"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <type_traits>
+
+namespace sandfly
+{
+
+    //***********************
+    // config_field_traits
+    //***********************
+
+    /// Maps a node member's type to its config_type, and converts it to and from config values
+    /// Supported types are bool, integers, floating-point numbers, std::string, scarab::param_node, and scarab::param_array
+    template< typename x_value, typename x_enable = void >
+    struct config_field_traits;
+
+    template<>
+    struct config_field_traits< bool >
+    {
+        static constexpr config_type s_type = config_type::boolean;
+        static bool from_param( const scarab::param& a_param ) { return a_param.as_value().as_bool(); }
+        static bool from_value( const config_value& a_value ) { return std::get< bool >( a_value ); }
+        static void to_param( bool a_value, const std::string& a_key, scarab::param_node& a_config ) { a_config.replace( a_key, scarab::param_value( a_value ) ); }
+    };
+
+    template< typename x_value >
+    struct config_field_traits< x_value, typename std::enable_if< std::is_integral< x_value >::value && std::is_signed< x_value >::value >::type >
+    {
+        static constexpr config_type s_type = config_type::integer;
+        static x_value from_param( const scarab::param& a_param ) { return x_value( a_param.as_value().as< int64_t >() ); }
+        static x_value from_value( const config_value& a_value ) { return x_value( std::get< int64_t >( a_value ) ); }
+        static void to_param( x_value a_value, const std::string& a_key, scarab::param_node& a_config ) { a_config.replace( a_key, scarab::param_value( int64_t(a_value) ) ); }
+    };
+
+    template< typename x_value >
+    struct config_field_traits< x_value, typename std::enable_if< std::is_integral< x_value >::value && std::is_unsigned< x_value >::value && ! std::is_same< x_value, bool >::value >::type >
+    {
+        static constexpr config_type s_type = config_type::unsigned_integer;
+        static x_value from_param( const scarab::param& a_param ) { return x_value( a_param.as_value().as< uint64_t >() ); }
+        static x_value from_value( const config_value& a_value ) { return x_value( std::get< uint64_t >( a_value ) ); }
+        static void to_param( x_value a_value, const std::string& a_key, scarab::param_node& a_config ) { a_config.replace( a_key, scarab::param_value( uint64_t(a_value) ) ); }
+    };
+
+    template< typename x_value >
+    struct config_field_traits< x_value, typename std::enable_if< std::is_floating_point< x_value >::value >::type >
+    {
+        static constexpr config_type s_type = config_type::real;
+        static x_value from_param( const scarab::param& a_param ) { return x_value( a_param.as_value().as_double() ); }
+        static x_value from_value( const config_value& a_value ) { return x_value( std::get< double >( a_value ) ); }
+        static void to_param( x_value a_value, const std::string& a_key, scarab::param_node& a_config ) { a_config.replace( a_key, scarab::param_value( double(a_value) ) ); }
+    };
+
+    template<>
+    struct config_field_traits< std::string >
+    {
+        static constexpr config_type s_type = config_type::string;
+        static std::string from_param( const scarab::param& a_param ) { return a_param.as_value().as_string(); }
+        static const std::string& from_value( const config_value& a_value ) { return std::get< std::string >( a_value ); }
+        static void to_param( const std::string& a_value, const std::string& a_key, scarab::param_node& a_config ) { a_config.replace( a_key, scarab::param_value( a_value ) ); }
+    };
+
+    template<>
+    struct config_field_traits< scarab::param_node >
+    {
+        static constexpr config_type s_type = config_type::node;
+        static const scarab::param_node& from_param( const scarab::param& a_param ) { return a_param.as_node(); }
+        static const scarab::param_node& from_value( const config_value& a_value ) { return std::get< std::shared_ptr< const scarab::param > >( a_value )->as_node(); }
+        static void to_param( const scarab::param_node& a_value, const std::string& a_key, scarab::param_node& a_config ) { a_config.replace( a_key, a_value ); }
+    };
+
+    template<>
+    struct config_field_traits< scarab::param_array >
+    {
+        static constexpr config_type s_type = config_type::array;
+        static const scarab::param_array& from_param( const scarab::param& a_param ) { return a_param.as_array(); }
+        static const scarab::param_array& from_value( const config_value& a_value ) { return std::get< std::shared_ptr< const scarab::param > >( a_value )->as_array(); }
+        static void to_param( const scarab::param_array& a_value, const std::string& a_key, scarab::param_node& a_config ) { a_config.replace( a_key, a_value ); }
+    };
+
+
+    //**********************
+    // config_field_table
+    //**********************
+
+    /*!
+     @class config_field_table
+
+     @brief Declarative map from config keys to a node type's setters and getters
+
+     @details
+     A binding that derives from _table_node_binding fills in the table once per node type, e.g.:
+
+         static void define_config_table( config_field_table< my_node >& a_table )
+         {
+             a_table.field( "rate", &my_node::set_rate, &my_node::get_rate ).range( 0., 1.e9 );
+             a_table.field( "length", &my_node::set_length, &my_node::get_length ).default_value( 10U );
+             NODE_CONFIG_FIELD( a_table, "n-channels", n_channels ).required();
+             a_table.field< std::string >( "file", []( my_node& a_node, const std::string& a_file ){ a_node.open( a_file ); },
+                                                   []( const my_node& a_node ){ return a_node.filename(); } );
+         }
+
+     The field's config_type is taken from the getter's return type (see config_field_traits), and the table's node_config_schema
+     is built from the fields; range(), min(), max(), default_value(), and required() apply to the field added last.
+     The schema's perfect hash gives the position of a key in the table, so applying a config is one hash and one call per key.
+     */
+    template< class x_node_type >
+    class config_field_table
+    {
+        public:
+            typedef x_node_type node_type;
+
+            typedef std::function< void( x_node_type&, const scarab::param& ) > param_setter_t;
+            typedef std::function< void( x_node_type&, const config_value& ) > value_setter_t;
+            typedef std::function< void( const x_node_type&, const std::string&, scarab::param_node& ) > getter_t;
+
+            struct entry
+            {
+                param_setter_t f_set_param;
+                value_setter_t f_set_value;
+                getter_t f_get;
+            };
+
+        public:
+            config_field_table();
+
+            /// Adds a field accessed with member functions, e.g. the ones made by mv_accessible
+            template< typename x_setter_arg, typename x_getter_ret >
+            config_field_table& field( const std::string& a_key, void (x_node_type::*a_setter)( x_setter_arg ), x_getter_ret (x_node_type::*a_getter)() const );
+
+            /// Adds a field accessed with callables: a_setter( x_node_type&, const x_value& ) and x_value a_getter( const x_node_type& )
+            template< typename x_value, typename x_setter, typename x_getter >
+            config_field_table& field( const std::string& a_key, x_setter a_setter, x_getter a_getter );
+
+            /// Inclusive range of the field added last
+            /// Integer fields narrower than 64 bits are always limited to the range of their type; a wider range is narrowed to it
+            config_field_table& range( double a_min, double a_max );
+            config_field_table& min( double a_min );
+            config_field_table& max( double a_max );
+            template< typename x_value >
+            config_field_table& default_value( const x_value& a_default );
+            config_field_table& required();
+
+            const node_config_schema& schema() const;
+            const std::vector< entry >& entries() const;
+
+        private:
+            node_config_schema f_schema;
+            std::vector< entry > f_entries; // in the same order as the schema's fields
+
+            // limits of the type of the field added last
+            double f_field_min;
+            double f_field_max;
+    };
+
+#define NODE_CONFIG_FIELD( a_table, a_key, a_member ) \
+    (a_table).field( a_key, &std::decay< decltype( a_table ) >::type::node_type::set_##a_member, &std::decay< decltype( a_table ) >::type::node_type::get_##a_member )
+
+
+    //***********************
+    // _table_node_binding
+    //***********************
+
+    /*!
+     @class _table_node_binding
+
+     @brief Node binding whose config functions are generated from a config_field_table
+
+     @details
+     The binding class must provide:
+
+         static void define_config_table( config_field_table< x_node_type >& a_table );
+
+     It's called once per node type, the first time the table is needed.
+     do_apply_config() and do_dump_config() are generated from the table, and the table's schema is the binding's config schema,
+     so configs are validated before they're applied (see node_binding) and builders apply the converted values field by field.
+     Keys that are not in the table (e.g. "device") are skipped when a config is applied.
+
+     Derived bindings can still override do_run_command() and do_get_statistics().
+     */
+    template< class x_node_type, class x_binding_type >
+    class _table_node_binding : public _node_binding< x_node_type, x_binding_type >
+    {
+        public:
+            typedef config_field_table< x_node_type > table_type;
+
+            _table_node_binding();
+            virtual ~_table_node_binding();
+
+            static const table_type& config_table();
+
+            virtual const node_config_schema* config_schema() const;
+
+        private:
+            virtual void do_apply_config( x_node_type* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const x_node_type* a_node, scarab::param_node& a_config ) const;
+            virtual void do_apply_typed_config( x_node_type* a_node, const typed_node_config& a_config ) const;
+    };
+
+
+    //*******************
+    //*******************
+    // Implementations
+    //*******************
+    //*******************
+
+
+    //**********************
+    // config_field_table
+    //**********************
+
+    template< class x_node_type >
+    config_field_table< x_node_type >::config_field_table() :
+            f_schema(),
+            f_entries(),
+            f_field_min( -std::numeric_limits< double >::infinity() ),
+            f_field_max( std::numeric_limits< double >::infinity() )
+    {}
+
+    template< class x_node_type >
+    template< typename x_setter_arg, typename x_getter_ret >
+    config_field_table< x_node_type >& config_field_table< x_node_type >::field( const std::string& a_key, void (x_node_type::*a_setter)( x_setter_arg ), x_getter_ret (x_node_type::*a_getter)() const )
+    {
+        typedef typename std::decay< x_getter_ret >::type value_type;
+        return field< value_type >( a_key,
+                [a_setter]( x_node_type& a_node, const value_type& a_value ){ (a_node.*a_setter)( a_value ); },
+                [a_getter]( const x_node_type& a_node ){ return (a_node.*a_getter)(); } );
+    }
+
+    template< class x_node_type >
+    template< typename x_value, typename x_setter, typename x_getter >
+    config_field_table< x_node_type >& config_field_table< x_node_type >::field( const std::string& a_key, x_setter a_setter, x_getter a_getter )
+    {
+        typedef config_field_traits< x_value > traits;
+        f_schema.add( a_key, traits::s_type );
+
+        // narrower integers would be silently truncated by from_param() and from_value(), so values outside of the type's limits are rejected
+        f_field_min = -std::numeric_limits< double >::infinity();
+        f_field_max = std::numeric_limits< double >::infinity();
+        if constexpr( std::is_integral< x_value >::value && ! std::is_same< x_value, bool >::value && sizeof( x_value ) < sizeof( int64_t ) )
+        {
+            f_field_min = double( std::numeric_limits< x_value >::min() );
+            f_field_max = double( std::numeric_limits< x_value >::max() );
+            f_schema.range( f_field_min, f_field_max );
+        }
+
+        entry t_entry;
+        t_entry.f_set_param = [a_setter]( x_node_type& a_node, const scarab::param& a_param ){ a_setter( a_node, traits::from_param( a_param ) ); };
+        t_entry.f_set_value = [a_setter]( x_node_type& a_node, const config_value& a_value ){ a_setter( a_node, traits::from_value( a_value ) ); };
+        t_entry.f_get = [a_getter]( const x_node_type& a_node, const std::string& a_key, scarab::param_node& a_config ){ traits::to_param( a_getter( a_node ), a_key, a_config ); };
+        f_entries.push_back( t_entry );
+        return *this;
+    }
+
+    template< class x_node_type >
+    config_field_table< x_node_type >& config_field_table< x_node_type >::range( double a_min, double a_max )
+    {
+        return min( a_min ).max( a_max );
+    }
+
+    template< class x_node_type >
+    config_field_table< x_node_type >& config_field_table< x_node_type >::min( double a_min )
+    {
+        f_schema.min( std::max( a_min, f_field_min ) );
+        return *this;
+    }
+
+    template< class x_node_type >
+    config_field_table< x_node_type >& config_field_table< x_node_type >::max( double a_max )
+    {
+        f_schema.max( std::min( a_max, f_field_max ) );
+        return *this;
+    }
+
+    template< class x_node_type >
+    template< typename x_value >
+    config_field_table< x_node_type >& config_field_table< x_node_type >::default_value( const x_value& a_default )
+    {
+        f_schema.default_value( scarab::param_value( a_default ) );
+        return *this;
+    }
+
+    template< class x_node_type >
+    config_field_table< x_node_type >& config_field_table< x_node_type >::required()
+    {
+        f_schema.required();
+        return *this;
+    }
+
+    template< class x_node_type >
+    inline const node_config_schema& config_field_table< x_node_type >::schema() const
+    {
+        return f_schema;
+    }
+
+    template< class x_node_type >
+    inline const std::vector< typename config_field_table< x_node_type >::entry >& config_field_table< x_node_type >::entries() const
+    {
+        return f_entries;
+    }
+
+
+    //***********************
+    // _table_node_binding
+    //***********************
+
+    template< class x_node_type, class x_binding_type >
+    _table_node_binding< x_node_type, x_binding_type >::_table_node_binding() :
+            _node_binding< x_node_type, x_binding_type >()
+    {}
+
+    template< class x_node_type, class x_binding_type >
+    _table_node_binding< x_node_type, x_binding_type >::~_table_node_binding()
+    {}
+
+    template< class x_node_type, class x_binding_type >
+    const config_field_table< x_node_type >& _table_node_binding< x_node_type, x_binding_type >::config_table()
+    {
+        static const table_type s_table = [](){
+                    table_type t_table;
+                    x_binding_type::define_config_table( t_table );
+                    return t_table;
+                }();
+        return s_table;
+    }
+
+    template< class x_node_type, class x_binding_type >
+    const node_config_schema* _table_node_binding< x_node_type, x_binding_type >::config_schema() const
+    {
+        return &config_table().schema();
+    }
+
+    template< class x_node_type, class x_binding_type >
+    void _table_node_binding< x_node_type, x_binding_type >::do_apply_config( x_node_type* a_node, const scarab::param_node& a_config ) const
+    {
+        const table_type& t_table = config_table();
+        for( scarab::param_node::const_iterator t_it = a_config.begin(); t_it != a_config.end(); ++t_it )
+        {
+            int t_index = t_table.schema().find( t_it.name() );
+            if( t_index < 0 ) continue;
+            t_table.entries()[ t_index ].f_set_param( *a_node, *t_it );
+        }
+        return;
+    }
+
+    template< class x_node_type, class x_binding_type >
+    void _table_node_binding< x_node_type, x_binding_type >::do_dump_config( const x_node_type* a_node, scarab::param_node& a_config ) const
+    {
+        const table_type& t_table = config_table();
+        for( unsigned i_field = 0; i_field < t_table.entries().size(); ++i_field )
+        {
+            t_table.entries()[ i_field ].f_get( *a_node, t_table.schema().fields()[ i_field ].f_key, a_config );
+        }
+        return;
+    }
+
+    template< class x_node_type, class x_binding_type >
+    void _table_node_binding< x_node_type, x_binding_type >::do_apply_typed_config( x_node_type* a_node, const typed_node_config& a_config ) const
+    {
+        // the values are indexed like the table, so there's no key lookup at all
+        const table_type& t_table = config_table();
+        for( unsigned i_field = 0; i_field < t_table.entries().size(); ++i_field )
+        {
+            if( ! a_config.has( i_field ) ) continue;
+            t_table.entries()[ i_field ].f_set_value( *a_node, a_config.value( i_field ) );
+        }
+        return;
+    }
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_NODE_CONFIG_TABLE_HH_ */
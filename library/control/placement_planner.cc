@@ -0,0 +1,171 @@
+/*
+ * placement_planner.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "placement_planner.hh"
+
+#include "sandfly_error.hh"
+
+#include "logger.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <tuple>
+
+namespace sandfly
+{
+    LOGGER( plog, "placement_planner" );
+
+    namespace
+    {
+        struct domain
+        {
+            unsigned f_numa_node = 0;
+            unsigned f_package = 0;
+            std::vector< unsigned > f_cpus; // not isolated
+            std::vector< unsigned > f_isolated_cpus; // not yet given to a source node
+            unsigned f_n_nodes = 0; // nodes sharing f_cpus
+
+            std::vector< unsigned > shared_cpus() const
+            {
+                // a domain made only of isolated CPUs is shared by its streams' nodes
+                return f_cpus.empty() ? f_isolated_cpus : f_cpus;
+            }
+
+            double load_with( unsigned a_n_nodes ) const
+            {
+                return double(f_n_nodes + a_n_nodes) / double(std::max< size_t >( 1, shared_cpus().size() ));
+            }
+
+            std::string describe() const
+            {
+                std::stringstream t_desc;
+                t_desc << "package " << f_package << ", NUMA node " << f_numa_node << ", CPUs " << format_cpu_list( shared_cpus() );
+                return t_desc.str();
+            }
+        };
+
+        bool domain_order( const cpu_info& a_first, const cpu_info& a_second )
+        {
+            return std::make_tuple( a_first.f_numa_node, a_first.f_package, a_first.f_l3_group, a_first.f_id )
+                    < std::make_tuple( a_second.f_numa_node, a_second.f_package, a_second.f_l3_group, a_second.f_id );
+        }
+    }
+
+    void placement_plan::to_param( scarab::param_node& a_node ) const
+    {
+        scarab::param_node t_streams;
+        for( std::map< std::string, std::string >::const_iterator t_stream_it = f_stream_domains.begin(); t_stream_it != f_stream_domains.end(); ++t_stream_it )
+        {
+            scarab::param_node t_stream;
+            t_stream.add( "domain", t_stream_it->second );
+            t_stream.add( "nodes", scarab::param_node() );
+            t_streams.add( t_stream_it->first, t_stream );
+        }
+        for( nodes_t::const_iterator t_node_it = f_nodes.begin(); t_node_it != f_nodes.end(); ++t_node_it )
+        {
+            scarab::param_node t_node;
+            t_node_it->second.f_placement.to_param( t_node );
+            t_node.add( "source", t_node_it->second.f_source );
+            t_node.add( "isolated", t_node_it->second.f_isolated );
+            if( t_streams.has( t_node_it->second.f_stream ) ) t_streams[ t_node_it->second.f_stream ]["nodes"].as_node().add( t_node_it->first, t_node );
+        }
+        a_node.add( "streams", t_streams );
+        return;
+    }
+
+
+    placement_planner::placement_planner( const cpu_topology& a_topology ) :
+            f_topology( a_topology )
+    {}
+
+    placement_planner::~placement_planner()
+    {}
+
+    placement_plan placement_planner::plan( const std::vector< placement_request >& a_requests ) const
+    {
+        std::vector< cpu_info > t_cpus( f_topology.f_cpus );
+        if( t_cpus.empty() )
+        {
+            throw error() << "There are no usable CPUs to place the streams on";
+        }
+        std::sort( t_cpus.begin(), t_cpus.end(), domain_order );
+
+        // CPUs beyond the cgroup's quota would only be throttled, so keep the first ones, which fills whole domains first
+        if( f_topology.f_cpu_quota > 0. )
+        {
+            size_t t_n_usable = std::max< size_t >( 1, size_t(std::ceil( f_topology.f_cpu_quota )) );
+            if( t_n_usable < t_cpus.size() )
+            {
+                LINFO( plog, "The cgroup CPU quota allows " << f_topology.f_cpu_quota << " CPU(s); placing streams on " << t_n_usable << " of " << t_cpus.size() << " CPUs" );
+                t_cpus.resize( t_n_usable );
+            }
+        }
+
+        std::vector< domain > t_domains;
+        for( std::vector< cpu_info >::const_iterator t_cpu_it = t_cpus.begin(); t_cpu_it != t_cpus.end(); ++t_cpu_it )
+        {
+            if( t_cpu_it == t_cpus.begin() || std::make_tuple( t_cpu_it->f_numa_node, t_cpu_it->f_package, t_cpu_it->f_l3_group )
+                    != std::make_tuple( (t_cpu_it - 1)->f_numa_node, (t_cpu_it - 1)->f_package, (t_cpu_it - 1)->f_l3_group ) )
+            {
+                t_domains.push_back( domain() );
+                t_domains.back().f_numa_node = t_cpu_it->f_numa_node;
+                t_domains.back().f_package = t_cpu_it->f_package;
+            }
+            if( t_cpu_it->f_isolated ) t_domains.back().f_isolated_cpus.push_back( t_cpu_it->f_id );
+            else t_domains.back().f_cpus.push_back( t_cpu_it->f_id );
+        }
+
+        const bool t_use_numa = f_topology.f_n_numa_nodes > 1;
+
+        placement_plan t_plan;
+        for( std::vector< placement_request >::const_iterator t_request_it = a_requests.begin(); t_request_it != a_requests.end(); ++t_request_it )
+        {
+            std::vector< domain >::iterator t_domain = t_domains.begin();
+            for( std::vector< domain >::iterator t_domain_it = t_domains.begin(); t_domain_it != t_domains.end(); ++t_domain_it )
+            {
+                if( t_domain_it->load_with( t_request_it->f_nodes.size() ) < t_domain->load_with( t_request_it->f_nodes.size() ) ) t_domain = t_domain_it;
+            }
+            t_plan.f_stream_domains[ t_request_it->f_stream ] = t_domain->describe();
+
+            std::vector< unsigned > t_shared_cpus = t_domain->shared_cpus();
+            for( std::vector< std::string >::const_iterator t_node_it = t_request_it->f_nodes.begin(); t_node_it != t_request_it->f_nodes.end(); ++t_node_it )
+            {
+                placement_plan::node_assignment& t_assignment = t_plan.f_nodes[ *t_node_it ];
+                t_assignment.f_stream = t_request_it->f_stream;
+                t_assignment.f_source = t_request_it->f_sources.count( *t_node_it ) != 0;
+                if( t_use_numa ) t_assignment.f_placement.f_numa_node = int(t_domain->f_numa_node);
+
+                if( t_assignment.f_source && ! t_domain->f_cpus.empty() )
+                {
+                    // an isolated CPU from the stream's domain, or failing that, from the same NUMA node
+                    std::vector< domain >::iterator t_isolated_domain = t_domain;
+                    if( t_isolated_domain->f_isolated_cpus.empty() )
+                    {
+                        for( t_isolated_domain = t_domains.begin(); t_isolated_domain != t_domains.end(); ++t_isolated_domain )
+                        {
+                            // domains without other CPUs share their isolated CPUs among their own streams' nodes
+                            if( t_isolated_domain->f_numa_node == t_domain->f_numa_node && ! t_isolated_domain->f_cpus.empty()
+                                    && ! t_isolated_domain->f_isolated_cpus.empty() ) break;
+                        }
+                    }
+                    if( t_isolated_domain != t_domains.end() && ! t_isolated_domain->f_isolated_cpus.empty() )
+                    {
+                        t_assignment.f_isolated = true;
+                        t_assignment.f_placement.f_cpus.assign( 1, t_isolated_domain->f_isolated_cpus.front() );
+                        t_isolated_domain->f_isolated_cpus.erase( t_isolated_domain->f_isolated_cpus.begin() );
+                        continue;
+                    }
+                }
+
+                t_assignment.f_placement.f_cpus = t_shared_cpus;
+                ++t_domain->f_n_nodes;
+            }
+        }
+        return t_plan;
+    }
+
+} /* namespace sandfly */
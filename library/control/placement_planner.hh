@@ -0,0 +1,88 @@
+/*
+ * placement_planner.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_PLACEMENT_PLANNER_HH_
+#define SANDFLY_PLACEMENT_PLANNER_HH_
+
+#include "cpu_topology.hh"
+#include "thread_placement.hh"
+
+#include "param.hh"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace sandfly
+{
+
+    /*!
+     @struct placement_request
+
+     @brief A stream to be placed: its nodes' full names, and which of them are sources (nodes without inputs)
+     */
+    struct placement_request
+    {
+        std::string f_stream;
+        std::vector< std::string > f_nodes;
+        std::set< std::string > f_sources;
+    };
+
+    /*!
+     @struct placement_plan
+
+     @brief The placement chosen for each node, by full node name
+     */
+    struct placement_plan
+    {
+        struct node_assignment
+        {
+            std::string f_stream;
+            bool f_source = false;
+            bool f_isolated = false; // the node has an isolated CPU to itself
+            thread_placement f_placement;
+        };
+        typedef std::map< std::string, node_assignment > nodes_t;
+
+        nodes_t f_nodes;
+        std::map< std::string, std::string > f_stream_domains; // description of the CPUs each stream was given
+
+        void to_param( scarab::param_node& a_node ) const;
+    };
+
+    /*!
+     @class placement_planner
+
+     @brief Assigns streams to CPUs so that each stream's connected nodes share an L3 cache and a NUMA node
+
+     @details
+     The usable CPUs are grouped into domains of CPUs on the same NUMA node, package, and L3 cache.
+     If the cgroup has a CPU quota, only as many CPUs as the quota allows are used, filling whole domains first.
+
+     Each stream goes to the domain that will be least loaded (nodes per non-isolated CPU) once the stream is added to it;
+     all of a stream's nodes share the domain's non-isolated CPUs.
+     Isolated CPUs are reserved for source nodes: each source node gets an isolated CPU to itself, from its stream's domain if possible,
+     otherwise from the same NUMA node.  Sources that don't get an isolated CPU share the domain's CPUs with the rest of the stream.
+
+     Nodes are given a preferred NUMA node only on machines with more than one.
+     */
+    class placement_planner
+    {
+        public:
+            placement_planner( const cpu_topology& a_topology );
+            virtual ~placement_planner();
+
+            /// Requests are placed in order; throws sandfly::error if there are no usable CPUs
+            placement_plan plan( const std::vector< placement_request >& a_requests ) const;
+
+        private:
+            cpu_topology f_topology;
+    };
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_PLACEMENT_PLANNER_HH_ */
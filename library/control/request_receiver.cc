@@ -10,6 +10,7 @@
 #include "logger.hh"
 #include "signal_handler.hh"
 
+#include <chrono>
 #include <cstddef>
 #include <signal.h>
 #include <sstream>
@@ -27,19 +28,93 @@ namespace sandfly
 
     LOGGER( plog, "request_receiver" );
 
+    namespace
+    {
+        typedef std::chrono::steady_clock::time_point time_point_t;
+
+        // timing of the request being handled on this thread; requests submitted from within a handler nest
+        struct request_timing
+        {
+            time_point_t f_received;
+            time_point_t f_handler_start;
+            time_point_t f_handler_end;
+            std::string f_handler;
+            request_timing* f_outer = nullptr;
+        };
+        thread_local request_timing* s_current_timing = nullptr;
+
+        struct current_timing_guard
+        {
+            current_timing_guard( request_timing& a_timing ) { a_timing.f_outer = s_current_timing; s_current_timing = &a_timing; }
+            ~current_timing_guard() { s_current_timing = s_current_timing->f_outer; }
+        };
+
+        // true while this thread is handling a mutating request
+        thread_local bool s_in_mutating_request = false;
+
+        struct mutating_request_guard
+        {
+            mutating_request_guard() { s_in_mutating_request = true; }
+            ~mutating_request_guard() { s_in_mutating_request = false; }
+        };
+
+        // handler name used for requests that don't reach a registered handler
+        const char* const s_unhandled = "(unhandled)";
+
+        uint64_t elapsed_ns( const time_point_t& a_start, const time_point_t& a_end )
+        {
+            return a_end > a_start ? std::chrono::duration_cast< std::chrono::nanoseconds >( a_end - a_start ).count() : 0;
+        }
+    }
+
+    request_receiver::request_latency::request_latency( const std::string& a_op, const std::string& a_handler ) :
+            f_queue( metrics_registry::global().histogram( "request_receiver.latency_ns", { {"op", a_op}, {"handler", a_handler}, {"phase", "queue"} } ) ),
+            f_handler( metrics_registry::global().histogram( "request_receiver.latency_ns", { {"op", a_op}, {"handler", a_handler}, {"phase", "handler"} } ) ),
+            f_reply( metrics_registry::global().histogram( "request_receiver.latency_ns", { {"op", a_op}, {"handler", a_handler}, {"phase", "reply"} } ) ),
+            f_total( metrics_registry::global().histogram( "request_receiver.latency_ns", { {"op", a_op}, {"handler", a_handler}, {"phase", "total"} } ) )
+    {}
+
     request_receiver::request_receiver( const param_node& a_config, const scarab::authentication& a_auth ) :
             hub( a_config, a_auth ),
             control_access(),
             f_set_conditions( a_config["set-conditions"].as_node() ),
+            f_n_request_workers( a_config.get_value( "request-workers", 2U ) ),
+            f_requests_metric( metrics_registry::global().counter( "request_receiver.requests" ) ),
+            f_request_errors_metric( metrics_registry::global().counter( "request_receiver.request_errors" ) ),
+            f_latencies(),
+            f_latency_mutex(),
+            f_read_only_handlers(),
+            f_read_only_queue(),
+            f_mutating_queue(),
+            f_dispatching( false ),
+            f_dispatch_threads(),
+            f_dispatch_mutex(),
+            f_dispatch_condition(),
+            f_mutating_mutex(),
+            f_reply_cache_ttls(),
+            f_reply_cache(),
+            f_reply_cache_generation( 0 ),
+            f_reply_cache_mutex(),
+            f_reply_cache_condition(),
+            f_reply_cache_hits_metric( metrics_registry::global().counter( "request_receiver.reply_cache_hits" ) ),
+            f_reply_cache_misses_metric( metrics_registry::global().counter( "request_receiver.reply_cache_misses" ) ),
             f_status( k_initialized )
     {
+        if( a_config.has( "reply-cache" ) )
+        {
+            const param_node& t_cache_config = a_config["reply-cache"].as_node();
+            for( param_node::const_iterator t_it = t_cache_config.begin(); t_it != t_cache_config.end(); ++t_it )
+            {
+                set_reply_cache_ttl( t_it.name(), (*t_it)().as_uint() );
+            }
+        }
     }
 
     request_receiver::~request_receiver()
     {
     }
 
-    void request_receiver::execute( std::condition_variable& a_run_control_ready_cv, std::mutex& a_run_control_ready_mutex )
+    void request_receiver::execute( std::condition_variable&, std::mutex& )
     {
         set_status( k_starting );
 
@@ -59,13 +134,14 @@ namespace sandfly
             return;
         }
 
-        while ( ! t_run_control_ptr->is_ready_at_startup() && ! cancelable::is_canceled() )
-        {
-            std::unique_lock< std::mutex > t_run_control_lock( a_run_control_ready_mutex );
-            a_run_control_ready_cv.wait_for( t_run_control_lock, std::chrono::seconds(1) );
-        }
+        // readiness depends on the run_control status; do_cancellation() wakes this up if we're canceled first
+        t_run_control_ptr->wait_for_status( [this, t_run_control_ptr]( run_control::status ){
+                    return t_run_control_ptr->is_ready_at_startup() || cancelable::is_canceled();
+                } );
 
         if ( f_make_connection && ! cancelable::is_canceled() ) {
+            start_dispatch_threads();
+
             LINFO( plog, "Waiting for incoming messages" );
 
             set_status( k_listening );
@@ -84,6 +160,8 @@ namespace sandfly
 
         LINFO( plog, "No longer waiting for messages" );
 
+        stop_dispatch_threads();
+
         if( ! stop() )
         {
             LERROR( plog, "An error occurred while stopping the request receiver" );
@@ -96,10 +174,359 @@ namespace sandfly
         return;
     }
 
+    dripline::reply_ptr_t request_receiver::on_request_message( const dripline::request_ptr_t a_request )
+    {
+        time_point_t t_received = std::chrono::steady_clock::now();
+
+        if( is_read_only( a_request ) )
+        {
+            // internal submissions are handled inline, since the caller is waiting for the reply
+            if( ! a_request->reply_to().empty() && f_n_request_workers != 0 )
+            {
+                std::unique_lock< std::mutex > t_lock( f_dispatch_mutex );
+                if( f_dispatching )
+                {
+                    f_read_only_queue.push_back( queued_request{ a_request, t_received, nullptr } );
+                    t_lock.unlock();
+                    f_dispatch_condition.notify_all();
+                    // the reply is sent by the hub when the request is dispatched
+                    return dripline::reply_ptr_t();
+                }
+            }
+            return dispatch_request( a_request, t_received );
+        }
+
+        // a request submitted by a mutating handler (e.g. a set-condition) is already serialized
+        if( s_in_mutating_request ) return dispatch_request( a_request, t_received );
+
+        {
+            std::unique_lock< std::mutex > t_lock( f_dispatch_mutex );
+            if( f_dispatching )
+            {
+                queued_request t_queued{ a_request, t_received, nullptr };
+                std::future< dripline::reply_ptr_t > t_reply;
+                if( a_request->reply_to().empty() )
+                {
+                    t_queued.f_reply = std::make_shared< std::promise< dripline::reply_ptr_t > >();
+                    t_reply = t_queued.f_reply->get_future();
+                }
+                f_mutating_queue.push_back( t_queued );
+                t_lock.unlock();
+                f_dispatch_condition.notify_all();
+                // the reply to a broker request is sent by the hub when the request is dispatched
+                if( ! t_reply.valid() ) return dripline::reply_ptr_t();
+                return t_reply.get();
+            }
+        }
+
+        return dispatch_mutating_request( a_request, t_received );
+    }
+
+    dripline::reply_ptr_t request_receiver::dispatch_mutating_request( const dripline::request_ptr_t a_request, const time_point_t& a_received )
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutating_mutex );
+        mutating_request_guard t_guard;
+        return dispatch_request( a_request, a_received );
+    }
+
+    dripline::reply_ptr_t request_receiver::dispatch_request( const dripline::request_ptr_t a_request, const time_point_t& a_received )
+    {
+        f_requests_metric.add();
+
+        request_timing t_timing;
+        t_timing.f_received = a_received;
+        dripline::reply_ptr_t t_reply;
+        {
+            current_timing_guard t_guard( t_timing );
+            t_reply = hub::on_request_message( a_request );
+        }
+        time_point_t t_done = std::chrono::steady_clock::now();
+
+        if( ! t_reply || t_reply->get_return_code() >= 100 ) f_request_errors_metric.add();
+
+        // sets and commands can change anything a get reports (e.g. an active node's config)
+        if( a_request->get_message_operation() != dripline::op_t::get ) invalidate_reply_cache();
+
+        if( t_timing.f_handler.empty() )
+        {
+            latency( dripline::to_string( a_request->get_message_operation() ), s_unhandled ).f_total.record( elapsed_ns( t_timing.f_received, t_done ) );
+        }
+        else
+        {
+            request_latency& t_latency = latency( dripline::to_string( a_request->get_message_operation() ), t_timing.f_handler );
+            t_latency.f_queue.record( elapsed_ns( t_timing.f_received, t_timing.f_handler_start ) );
+            t_latency.f_handler.record( elapsed_ns( t_timing.f_handler_start, t_timing.f_handler_end ) );
+            t_latency.f_reply.record( elapsed_ns( t_timing.f_handler_end, t_done ) );
+            t_latency.f_total.record( elapsed_ns( t_timing.f_received, t_done ) );
+        }
+
+        return t_reply;
+    }
+
+    bool request_receiver::is_read_only( const dripline::request_ptr_t a_request ) const
+    {
+        // the hub finds the handler with the first element of the specifier
+        return a_request->get_message_operation() == dripline::op_t::get &&
+                ! a_request->parsed_specifier().empty() &&
+                f_read_only_handlers.count( a_request->parsed_specifier().front() ) != 0;
+    }
+
+    void request_receiver::start_dispatch_threads()
+    {
+        if( f_n_request_workers == 0 ) LINFO( plog, "Read-only requests will be handled in the listening thread" );
+
+        std::unique_lock< std::mutex > t_lock( f_dispatch_mutex );
+        f_dispatching = true;
+        LDEBUG( plog, "Starting " << f_n_request_workers << " read-only request worker(s) and the mutating request lane" );
+        for( unsigned i_worker = 0; i_worker < f_n_request_workers; ++i_worker )
+        {
+            f_dispatch_threads.push_back( std::thread( &request_receiver::run_dispatch_lane, this, std::ref( f_read_only_queue ) ) );
+        }
+        f_dispatch_threads.push_back( std::thread( &request_receiver::run_dispatch_lane, this, std::ref( f_mutating_queue ) ) );
+        return;
+    }
+
+    void request_receiver::stop_dispatch_threads()
+    {
+        {
+            std::unique_lock< std::mutex > t_lock( f_dispatch_mutex );
+            if( ! f_dispatching ) return;
+            f_dispatching = false;
+            std::size_t t_n_dropped = f_read_only_queue.size() + f_mutating_queue.size();
+            if( t_n_dropped != 0 ) LWARN( plog, "Dropping " << t_n_dropped << " queued request(s)" );
+            for( std::deque< queued_request >::iterator t_it = f_mutating_queue.begin(); t_it != f_mutating_queue.end(); ++t_it )
+            {
+                if( t_it->f_reply ) t_it->f_reply->set_exception( std::make_exception_ptr( error() << "The request receiver stopped before the request was handled" ) );
+            }
+            f_read_only_queue.clear();
+            f_mutating_queue.clear();
+        }
+        f_dispatch_condition.notify_all();
+
+        LDEBUG( plog, "Waiting for the request dispatch threads to finish" );
+        for( std::vector< std::thread >::iterator t_thread_it = f_dispatch_threads.begin(); t_thread_it != f_dispatch_threads.end(); ++t_thread_it )
+        {
+            t_thread_it->join();
+        }
+        f_dispatch_threads.clear();
+        return;
+    }
+
+    void request_receiver::run_dispatch_lane( std::deque< queued_request >& a_queue )
+    {
+        while( true )
+        {
+            queued_request t_next;
+            {
+                std::unique_lock< std::mutex > t_lock( f_dispatch_mutex );
+                f_dispatch_condition.wait( t_lock, [this, &a_queue](){ return ! f_dispatching || ! a_queue.empty(); } );
+                if( ! f_dispatching ) return;
+                t_next = a_queue.front();
+                a_queue.pop_front();
+            }
+
+            try
+            {
+                dripline::reply_ptr_t t_reply = &a_queue == &f_mutating_queue ?
+                        dispatch_mutating_request( t_next.f_request, t_next.f_received ) :
+                        dispatch_request( t_next.f_request, t_next.f_received );
+                if( t_next.f_reply ) t_next.f_reply->set_value( t_reply );
+            }
+            catch( std::exception& e )
+            {
+                LERROR( plog, "Exception caught while handling a request: " << e.what() );
+                if( t_next.f_reply ) t_next.f_reply->set_exception( std::current_exception() );
+            }
+        }
+    }
+
+    void request_receiver::register_get_handler( const std::string& a_key, const dripline::handler_func_t& a_func, bool a_read_only )
+    {
+        if( a_read_only ) f_read_only_handlers.insert( a_key );
+        else f_read_only_handlers.erase( a_key );
+
+        std::map< std::string, unsigned >::const_iterator t_ttl_it = f_reply_cache_ttls.find( a_key );
+        if( t_ttl_it != f_reply_cache_ttls.end() && t_ttl_it->second != 0 )
+        {
+            LDEBUG( plog, "Replies to get requests for <" << a_key << "> will be cached for " << t_ttl_it->second << " ms" );
+            hub::register_get_handler( a_key, timed_handler( dripline::op_t::get, a_key, cached_handler( a_key, t_ttl_it->second, a_func ) ) );
+        }
+        else
+        {
+            hub::register_get_handler( a_key, timed_handler( dripline::op_t::get, a_key, a_func ) );
+        }
+        return;
+    }
+
+    void request_receiver::register_set_handler( const std::string& a_key, const dripline::handler_func_t& a_func )
+    {
+        hub::register_set_handler( a_key, timed_handler( dripline::op_t::set, a_key, a_func ) );
+        return;
+    }
+
+    void request_receiver::register_cmd_handler( const std::string& a_key, const dripline::handler_func_t& a_func )
+    {
+        hub::register_cmd_handler( a_key, timed_handler( dripline::op_t::cmd, a_key, a_func ) );
+        return;
+    }
+
+    dripline::handler_func_t request_receiver::timed_handler( dripline::op_t a_op, const std::string& a_key, const dripline::handler_func_t& a_func )
+    {
+        // create the histograms now, so that they're reported even before the first request
+        latency( dripline::to_string( a_op ), a_key );
+
+        return [a_key, a_func]( const dripline::request_ptr_t a_request ) {
+            request_timing* t_timing = s_current_timing;
+            if( t_timing == nullptr ) return a_func( a_request );
+
+            t_timing->f_handler = a_key;
+            t_timing->f_handler_start = std::chrono::steady_clock::now();
+            try
+            {
+                dripline::reply_ptr_t t_reply = a_func( a_request );
+                t_timing->f_handler_end = std::chrono::steady_clock::now();
+                return t_reply;
+            }
+            catch( ... )
+            {
+                t_timing->f_handler_end = std::chrono::steady_clock::now();
+                throw;
+            }
+        };
+    }
+
+    void request_receiver::set_reply_cache_ttl( const std::string& a_key, unsigned a_ttl_ms )
+    {
+        f_reply_cache_ttls[ a_key ] = a_ttl_ms;
+        return;
+    }
+
+    void request_receiver::invalidate_reply_cache()
+    {
+        std::unique_lock< std::mutex > t_lock( f_reply_cache_mutex );
+        ++f_reply_cache_generation;
+        for( std::map< std::string, cached_reply >::iterator t_it = f_reply_cache.begin(); t_it != f_reply_cache.end(); )
+        {
+            // entries in flight are needed by their waiters; the generation change keeps their reply from being cached
+            if( t_it->second.f_in_flight )
+            {
+                t_it->second.f_payload.reset();
+                ++t_it;
+            }
+            else t_it = f_reply_cache.erase( t_it );
+        }
+        return;
+    }
+
+    dripline::handler_func_t request_receiver::cached_handler( const std::string& a_key, unsigned a_ttl_ms, const dripline::handler_func_t& a_func )
+    {
+        return [this, a_key, a_ttl_ms, a_func]( const dripline::request_ptr_t a_request ) {
+            std::string t_cache_key( a_request->routing_key() + " " + a_key + " " + a_request->specifier() );
+
+            std::unique_lock< std::mutex > t_lock( f_reply_cache_mutex );
+            while( true )
+            {
+                std::map< std::string, cached_reply >::iterator t_it = f_reply_cache.find( t_cache_key );
+                if( t_it == f_reply_cache.end() ) break;
+                if( t_it->second.f_payload && std::chrono::steady_clock::now() < t_it->second.f_expiration )
+                {
+                    f_reply_cache_hits_metric.add();
+                    return a_request->reply( t_it->second.f_return_code, t_it->second.f_return_message, t_it->second.f_payload->clone() );
+                }
+                if( ! t_it->second.f_in_flight ) break;
+                // an identical request is being handled; wait for its reply
+                f_reply_cache_condition.wait( t_lock );
+            }
+
+            f_reply_cache_misses_metric.add();
+            f_reply_cache[ t_cache_key ].f_in_flight = true;
+            uint64_t t_generation = f_reply_cache_generation;
+            t_lock.unlock();
+
+            dripline::reply_ptr_t t_reply;
+            try
+            {
+                t_reply = a_func( a_request );
+            }
+            catch( ... )
+            {
+                t_lock.lock();
+                f_reply_cache.erase( t_cache_key );
+                t_lock.unlock();
+                f_reply_cache_condition.notify_all();
+                throw;
+            }
+
+            t_lock.lock();
+            if( t_reply && t_reply->get_return_code() == 0 && t_generation == f_reply_cache_generation )
+            {
+                cached_reply& t_cached = f_reply_cache[ t_cache_key ];
+                t_cached.f_expiration = std::chrono::steady_clock::now() + std::chrono::milliseconds( a_ttl_ms );
+                t_cached.f_return_code = t_reply->get_return_code();
+                t_cached.f_return_message = t_reply->return_message();
+                t_cached.f_payload = t_reply->payload().clone();
+                t_cached.f_in_flight = false;
+            }
+            else
+            {
+                f_reply_cache.erase( t_cache_key );
+            }
+            t_lock.unlock();
+            f_reply_cache_condition.notify_all();
+
+            return t_reply;
+        };
+    }
+
+    request_receiver::request_latency& request_receiver::latency( const std::string& a_op, const std::string& a_handler )
+    {
+        std::unique_lock< std::mutex > t_lock( f_latency_mutex );
+        std::unique_ptr< request_latency >& t_latency = f_latencies[ latency_key_t( a_op, a_handler ) ];
+        if( ! t_latency ) t_latency.reset( new request_latency( a_op, a_handler ) );
+        return *t_latency;
+    }
+
+    dripline::reply_ptr_t request_receiver::handle_get_request_stats_request( const dripline::request_ptr_t a_request )
+    {
+        param_ptr_t t_payload_ptr( new param_node() );
+        param_node& t_payload = t_payload_ptr->as_node();
+        t_payload.add( "requests", scarab::param_value( f_requests_metric.value() ) );
+        t_payload.add( "request-errors", scarab::param_value( f_request_errors_metric.value() ) );
+        t_payload.add( "reply-cache-hits", scarab::param_value( f_reply_cache_hits_metric.value() ) );
+        t_payload.add( "reply-cache-misses", scarab::param_value( f_reply_cache_misses_metric.value() ) );
+
+        // latencies in ms, keyed by "[op] [handler]"
+        param_node t_handlers;
+        {
+            std::unique_lock< std::mutex > t_lock( f_latency_mutex );
+            for( latencies_t::const_iterator t_it = f_latencies.begin(); t_it != f_latencies.end(); ++t_it )
+            {
+                param_node t_handler_stats;
+                param_node t_total, t_queue, t_handler, t_reply;
+                t_it->second->f_total.snapshot().fill( t_total, 1.e6 );
+                t_handler_stats.add( "total-ms", t_total );
+                if( t_it->first.second != s_unhandled )
+                {
+                    t_it->second->f_queue.snapshot().fill( t_queue, 1.e6 );
+                    t_it->second->f_handler.snapshot().fill( t_handler, 1.e6 );
+                    t_it->second->f_reply.snapshot().fill( t_reply, 1.e6 );
+                    t_handler_stats.add( "queue-ms", t_queue );
+                    t_handler_stats.add( "handler-ms", t_handler );
+                    t_handler_stats.add( "reply-ms", t_reply );
+                }
+                t_handlers.add( t_it->first.first + " " + t_it->first.second, t_handler_stats );
+            }
+        }
+        t_payload.add( "handlers", t_handlers );
+
+        return a_request->reply( dripline::dl_success(), "Request statistics are in the payload", std::move(t_payload_ptr) );
+    }
+
     void request_receiver::do_cancellation( int )
     {
         LDEBUG( plog, "Canceling request receiver" );
         if( get_status() != k_error ) set_status( k_canceled );
+        if( ! run_control_expired() ) use_run_control()->notify_status_waiters();
         return;
     }
 
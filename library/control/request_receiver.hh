@@ -2,6 +2,7 @@
 #define SANDFLY_REQUEST_RECEIVER_HH_
 
 #include "control_access.hh"
+#include "metrics.hh"
 
 // dripline
 #include "hub.hh"
@@ -11,9 +12,19 @@
 #include "cancelable.hh"
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace scarab
 {
@@ -35,6 +46,38 @@ namespace sandfly
      request_receiver holds maps for set, get, cmd and run requests.
      When a request is received the handle_function registered with this request gets called.
      The registration of requests and functions is done in dripline::hub.
+
+     Concurrent dispatch: handlers are classified as read-only or mutating when they're registered.
+     Get handlers are read-only unless registered otherwise; set, cmd, and run handlers are mutating.
+     Requests received from the broker are handed off by the listening thread:
+     - requests for read-only handlers are handled by a pool of "request-workers" threads (default: 2),
+       so that e.g. daq-status stays responsive while a long command is in progress;
+     - all other requests are handled, one at a time and in the order received, by a single mutating lane.
+     Requests submitted internally (which have no reply-to, e.g. from the batch_executor or a set-condition) go through the same lanes:
+     a mutating request is queued in the mutating lane and the submitting thread waits for its reply, while a read-only request is
+     handled in the submitting thread.  Requests submitted from within a mutating handler are handled right away, since they're
+     already serialized.  Mutating requests that arrive while the lane isn't running (before listening starts or after it stops)
+     are handled in the calling thread, still one at a time.
+     Setting "request-workers" to 0 disables the read-only workers, and read-only requests are handled in the listening thread.
+     Requests that are still queued when the receiver is canceled are dropped; internal submitters get an error.
+
+     Reply cache: successful replies from selected get handlers can be reused for a short time.
+     The cache is opt-in; the "reply-cache" config node maps get-handler names to a TTL in ms (e.g. daq-status: 200).
+     Replies are keyed by op, routing key, and specifier; while one request for a key is being handled,
+     identical requests wait for its reply rather than calling the handler again.
+     invalidate_reply_cache() discards everything; it's called after every request that isn't a get,
+     and the conductor calls it on run_control status changes and stream_manager changes.
+     Cache hits are still timed and counted, but the handler phase is only the cache lookup.
+
+     Request latency: handlers registered through request_receiver are wrapped so that each request is timed in phases:
+     - queue: from the request reaching the receiver until its handler starts
+     - handler: the handler itself, which includes building the reply payload
+     - reply: from the handler returning until the hub is done with the request (i.e. the reply has been sent)
+     - total: the whole time spent in the receiver
+     Histograms are kept per op and handler (e.g. "set active-config" and "get node-config" are separate), and are
+     recorded in metrics_registry::global() as request_receiver.latency_ns, with the labels op, handler, and phase.
+     Requests that don't reach a registered handler are recorded under the handler "(unhandled)", with only the total.
+     The "request-stats" get request returns the histograms in ms.
      */
     class request_receiver : public dripline::hub, public control_access
     {
@@ -45,9 +88,99 @@ namespace sandfly
             void execute( std::condition_variable& a_run_control_ready_cv, std::mutex& a_run_control_ready_mutex );
 
             mv_referrable_const( scarab::param_node, set_conditions );
+
+            /// Counts and times the requests (including those submitted internally) before passing them to the hub
+            virtual dripline::reply_ptr_t on_request_message( const dripline::request_ptr_t a_request );
+
+            /// Registers handlers with the hub, wrapped so that their latency is recorded
+            /// Get handlers are treated as read-only unless a_read_only is false
+            void register_get_handler( const std::string& a_key, const dripline::handler_func_t& a_func, bool a_read_only = true );
+            void register_set_handler( const std::string& a_key, const dripline::handler_func_t& a_func );
+            void register_cmd_handler( const std::string& a_key, const dripline::handler_func_t& a_func );
+
+            dripline::reply_ptr_t handle_get_request_stats_request( const dripline::request_ptr_t a_request );
+
+            /// Caches the replies of a get handler for a_ttl_ms (0 disables caching); must be called before the handler is registered
+            void set_reply_cache_ttl( const std::string& a_key, unsigned a_ttl_ms );
+            /// Discards all cached replies
+            void invalidate_reply_cache();
+
+            mv_accessible_noset( unsigned, n_request_workers );
+
         private:
             virtual void do_cancellation( int a_code );
 
+            dripline::handler_func_t timed_handler( dripline::op_t a_op, const std::string& a_key, const dripline::handler_func_t& a_func );
+
+            // recorded in metrics_registry::global()
+            sharded_counter& f_requests_metric;
+            sharded_counter& f_request_errors_metric;
+
+            struct request_latency
+            {
+                request_latency( const std::string& a_op, const std::string& a_handler );
+                log_histogram& f_queue;
+                log_histogram& f_handler;
+                log_histogram& f_reply;
+                log_histogram& f_total;
+            };
+            /// Get-or-create the histograms for an op and handler
+            request_latency& latency( const std::string& a_op, const std::string& a_handler );
+
+            typedef std::pair< std::string, std::string > latency_key_t; // op, handler
+            typedef std::map< latency_key_t, std::unique_ptr< request_latency > > latencies_t;
+            latencies_t f_latencies;
+            std::mutex f_latency_mutex;
+
+            typedef std::chrono::steady_clock::time_point time_point_t;
+
+            /// Counts, times, and handles a request in the calling thread
+            dripline::reply_ptr_t dispatch_request( const dripline::request_ptr_t a_request, const time_point_t& a_received );
+
+            bool is_read_only( const dripline::request_ptr_t a_request ) const;
+
+            void start_dispatch_threads();
+            void stop_dispatch_threads();
+
+            struct queued_request
+            {
+                dripline::request_ptr_t f_request;
+                time_point_t f_received;
+                std::shared_ptr< std::promise< dripline::reply_ptr_t > > f_reply; // set for internal submissions, which wait for the reply
+            };
+            /// Handles a mutating request in the calling thread, serialized with the mutating lane
+            dripline::reply_ptr_t dispatch_mutating_request( const dripline::request_ptr_t a_request, const time_point_t& a_received );
+            // handles the requests in a_queue until stop_dispatch_threads() is called
+            void run_dispatch_lane( std::deque< queued_request >& a_queue );
+
+            std::set< std::string > f_read_only_handlers; // filled in before execute(), so it's not guarded
+            std::deque< queued_request > f_read_only_queue;
+            std::deque< queued_request > f_mutating_queue;
+            bool f_dispatching; // true while the dispatch threads are running
+            std::vector< std::thread > f_dispatch_threads;
+            std::mutex f_dispatch_mutex; // guards the queues and f_dispatching
+            std::condition_variable f_dispatch_condition;
+            std::mutex f_mutating_mutex; // held while a mutating request is handled
+
+            dripline::handler_func_t cached_handler( const std::string& a_key, unsigned a_ttl_ms, const dripline::handler_func_t& a_func );
+
+            struct cached_reply
+            {
+                time_point_t f_expiration;
+                unsigned f_return_code = 0;
+                std::string f_return_message;
+                scarab::param_ptr_t f_payload; // null if there's no reply available (yet)
+                bool f_in_flight = false; // a request for this key is being handled
+            };
+            std::map< std::string, unsigned > f_reply_cache_ttls; // ms; filled in before the handlers are registered
+            std::map< std::string, cached_reply > f_reply_cache;
+            uint64_t f_reply_cache_generation; // incremented on invalidation, so that replies from before an invalidation aren't cached
+            std::mutex f_reply_cache_mutex;
+            std::condition_variable f_reply_cache_condition;
+
+            sharded_counter& f_reply_cache_hits_metric;
+            sharded_counter& f_reply_cache_misses_metric;
+
         public:
             enum status
             {
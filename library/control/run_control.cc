@@ -10,6 +10,7 @@
 #include "message_relayer.hh"
 #include "node_builder.hh"
 #include "request_receiver.hh"
+#include "thread_placement.hh"
 
 #include "diptera.hh"
 #include "midge_error.hh"
@@ -19,11 +20,14 @@
 
 #include "return_codes.hh"
 
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <condition_variable>
 #include <future>
 #include <signal.h>
 #include <thread>
+#include <time.h>
 
 using scarab::param_array;
 using scarab::param_node;
@@ -47,13 +51,30 @@ namespace sandfly
             f_daq_config(),
             f_midge_pkg(),
             f_node_bindings( nullptr ),
+            f_node_bindings_mutex(),
             f_run_stopper(),
             f_run_stop_mutex(),
             f_do_break_run( false ),
+            f_midge_is_resumed( false ),
             f_run_return(),
+            f_run_is_scheduled( false ),
+            f_run_times(),
+            f_run_sequence_times(),
+            f_run_times_mutex(),
+            f_dead_time(),
+            f_runs_metric( metrics_registry::global().counter( "run_control.runs" ) ),
+            f_run_duration_metric( metrics_registry::global().histogram( "run_control.run_duration_ns" ) ),
             f_msg_relay( a_msg_relay ),
             f_run_duration( 1000 ),
-            f_status( status::deactivated )
+            f_use_standby( false ),
+            f_precise_timing( false ),
+            f_default_run_clock( run_clock::realtime ),
+            f_status( status::deactivated ),
+            f_status_mutex(),
+            f_status_condition(),
+            f_status_callbacks(),
+            f_next_status_callback_id( 0 ),
+            f_status_callback_mutex()
     {
         // DAQ config is optional; defaults will work just fine
         if( a_config.has( "daq" ) )
@@ -62,6 +83,17 @@ namespace sandfly
         }
 
         set_run_duration( f_daq_config.get_value( "duration", get_run_duration() ) );
+        set_use_standby( f_daq_config.get_value( "use-standby", get_use_standby() ) );
+        set_precise_timing( f_daq_config.get_value( "precise-timing", get_precise_timing() ) );
+        set_default_run_clock( string_to_run_clock( f_daq_config.get_value( "run-clock", run_clock_to_string( get_default_run_clock() ) ) ) );
+        f_node_manager->set_n_build_threads( f_daq_config.get_value( "n-build-threads", f_node_manager->get_n_build_threads() ) );
+        f_node_manager->set_auto_placement( f_daq_config.get_value( "auto-placement", f_node_manager->get_auto_placement() ) );
+
+        add_status_callback( [this]( status a_old_status, status a_new_status ){
+                    if( a_new_status == status::activating ) f_dead_time.activating();
+                    else if( a_new_status == status::activated && a_old_status == status::activating ) f_dead_time.activated();
+                    else if( a_new_status == status::deactivating ) f_dead_time.deactivating();
+                } );
     }
 
     void run_control::initialize()
@@ -94,13 +126,9 @@ namespace sandfly
             LDEBUG( plog, "run_control execute loop; status is <" << interpret_status( t_status ) << ">" );
             if( ( t_status == status::deactivated ) && ! is_canceled() )
             {
-                while( t_status == status::deactivated )
-                {
-                    std::unique_lock< std::mutex > t_lock( f_daq_mutex );
-                    LDEBUG( plog, "DAQ control waiting for activation signal; status is " << interpret_status( t_status ) );
-                    f_activation_condition.wait_for( t_lock, std::chrono::seconds(1) );
-                    t_status = get_status();
-                }
+                LDEBUG( plog, "DAQ control waiting for activation signal; status is " << interpret_status( t_status ) );
+                // cancellation sets the status, so this wakes up for that too
+                wait_for_status( []( status a_status ){ return a_status != status::deactivated; } );
             }
             else if( t_status == status::activating )
             {
@@ -144,17 +172,22 @@ namespace sandfly
 
                 this->on_pre_midge_run();
 
+                // midge starts new node threads, which apply their placements and scheduling as they start
+                placement_registry::global().clear_applied();
+
                 // set midge's running callback
                 f_midge_pkg->set_running_callback(
                         [this, &a_ready_condition_variable, &a_ready_mutex]() {
                             set_status( status::activated );
-                            std::lock_guard<std::mutex> ready_lock(a_ready_mutex);
-                            a_ready_condition_variable.notify_all();
+                            {
+                                std::lock_guard<std::mutex> ready_lock(a_ready_mutex);
+                                a_ready_condition_variable.notify_all();
+                            }
                             return;
                         }
                 );
 
-                f_node_bindings = f_node_manager->get_node_bindings();
+                set_node_bindings( f_node_manager->get_node_bindings() );
 
                 std::exception_ptr t_e_ptr;
 
@@ -173,6 +206,7 @@ namespace sandfly
                 }
 
                 LDEBUG( plog, "Midge has finished running" );
+                f_dead_time.midge_exited();
 
                 this->on_post_midge_run();
 
@@ -213,8 +247,16 @@ namespace sandfly
                     stop_run();
                 }
 
+                // the bindings are deleted when midge is returned
+                set_node_bindings( nullptr );
                 f_node_manager->return_midge( std::move( f_midge_pkg ) );
-                f_node_bindings = nullptr;
+
+                // the standby is built only once the old midge object has been released, so their resources are never held at the same time
+                status t_after_run_status = get_status();
+                if( f_use_standby && ! is_canceled() && ( t_after_run_status == status::deactivating || t_after_run_status == status::do_restart ) )
+                {
+                    f_node_manager->prepare_standby();
+                }
 
                 if( get_status() == status::running )
                 {
@@ -263,7 +305,7 @@ namespace sandfly
             {
                 LINFO( plog, "Exiting DAQ control" );
                 this->on_done();
-                f_node_bindings = nullptr;
+                set_node_bindings( nullptr );
                 break;
             }
             else if( t_status == status::error )
@@ -271,7 +313,7 @@ namespace sandfly
                 LERROR( plog, "DAQ control is in an error state" );
                 f_msg_relay->send_error( "DAQ control is in an error state and will now exit" );
                 this->on_error();
-                f_node_bindings = nullptr;
+                set_node_bindings( nullptr );
                 scarab::signal_handler::cancel_all( RETURN_ERROR );
                 break;
             }
@@ -306,7 +348,11 @@ namespace sandfly
     void run_control::reactivate()
     {
         deactivate();
-        std::this_thread::sleep_for( std::chrono::seconds(1) );
+
+        // wait for the execution loop to finish with the current midge object before activating again
+        wait_for_status( []( status a_status ){ return a_status != status::deactivating; },
+                         std::chrono::steady_clock::now() + std::chrono::seconds(5) );
+
         activate();
         return;
     }
@@ -344,17 +390,38 @@ namespace sandfly
     }
 
     void run_control::start_run()
+    {
+        start_run( f_default_run_clock, 0 );
+        return;
+    }
+
+    void run_control::start_run( run_clock a_clock, int64_t a_start_ns )
+    {
+        run_step t_step;
+        t_step.f_duration = f_run_duration;
+        start_run_sequence( std::vector< run_step >( 1, t_step ), a_clock, a_start_ns );
+        return;
+    }
+
+    void run_control::start_run_sequence( const std::vector< run_step >& a_steps, run_clock a_clock, int64_t a_start_ns )
     {
         LDEBUG( plog, "Preparing for run" );
 
-        if( is_canceled() )
+        if( a_steps.empty() )
         {
-            throw error() << "run_control has been canceled";
+            throw run_error() << "No runs were requested";
+        }
+        for( std::vector< run_step >::const_iterator t_it = a_steps.begin(); a_steps.size() > 1 && t_it != a_steps.end(); ++t_it )
+        {
+            if( t_it->f_duration == 0 )
+            {
+                throw run_error() << "Runs in a sequence must have a non-zero duration";
+            }
         }
 
-        if( get_status() != status::activated )
+        if( is_canceled() )
         {
-            throw status_error() << "DAQ control must be in the activated state to start a run; activate the DAQ and try again";
+            throw error() << "run_control has been canceled";
         }
 
         if( ! f_midge_pkg.have_lock() )
@@ -362,83 +429,273 @@ namespace sandfly
             throw error() << "Do not have midge resource";
         }
 
+        const bool t_scheduled = a_start_ns > run_clock_now( a_clock );
+        {
+            // the status check and the claim of the run are one step, so that concurrent requests can't both start a run
+            std::unique_lock< std::mutex > t_run_stop_lock( f_run_stop_mutex );
+            std::unique_lock< std::mutex > t_status_lock( f_status_mutex );
+            if( f_status != status::activated )
+            {
+                throw status_error() << "DAQ control must be in the activated state to start a run; activate the DAQ and try again";
+            }
+            if( f_run_is_scheduled )
+            {
+                throw status_error() << "A run is already scheduled; stop it before starting a new run";
+            }
+
+            // a stop-run request from before this run doesn't apply to it
+            f_do_break_run = false;
+            f_run_is_scheduled = t_scheduled;
+            // a scheduled run stays activated until it starts
+            if( ! t_scheduled ) f_status.store( status::running );
+
+            std::unique_lock< std::mutex > t_times_lock( f_run_times_mutex );
+            f_run_times = run_times();
+            f_run_times.f_clock = a_clock;
+            f_run_times.f_scheduled_start = a_start_ns;
+            f_run_sequence_times.clear();
+        }
+        if( ! t_scheduled ) status_changed( status::activated, status::running );
+
         LDEBUG( plog, "Launching asynchronous do_run" );
-        f_run_return = std::async( std::launch::async, &run_control::do_run, this, f_run_duration );
+        f_run_return = std::async( std::launch::async, &run_control::do_run, this, a_steps, a_clock, a_start_ns );
         //TODO: use run return?
 
         return;
     }
 
-    void run_control::do_run( unsigned a_duration )
+    run_control::run_times run_control::get_run_times() const
+    {
+        std::unique_lock< std::mutex > t_times_lock( f_run_times_mutex );
+        return f_run_times;
+    }
+
+    std::vector< run_control::run_times > run_control::get_run_sequence_times() const
+    {
+        std::unique_lock< std::mutex > t_times_lock( f_run_times_mutex );
+        return f_run_sequence_times;
+    }
+
+    std::string run_control::run_clock_to_string( run_clock a_clock )
+    {
+        switch( a_clock )
+        {
+            case run_clock::realtime:
+                return std::string( "realtime" );
+                break;
+            case run_clock::tai:
+                return std::string( "tai" );
+                break;
+        }
+        return std::string( "unknown" );
+    }
+
+    run_control::run_clock run_control::string_to_run_clock( const std::string& a_name )
     {
-        // a_duration is in ms
+        if( a_name == "realtime" ) return run_clock::realtime;
+        if( a_name == "tai" ) return run_clock::tai;
+        throw error() << "Unknown run clock: <" << a_name << ">; options are \"realtime\" and \"tai\"";
+    }
 
-        LINFO( plog, "Run is commencing" );
-        f_msg_relay->send_notice( "Run is commencing" );
+    namespace
+    {
+        clockid_t to_clock_id( run_control::run_clock a_clock )
+        {
+            return a_clock == run_control::run_clock::tai ? CLOCK_TAI : CLOCK_REALTIME;
+        }
 
-        this->on_pre_run();
+        int64_t clock_now( clockid_t a_clock_id )
+        {
+            timespec t_now;
+            clock_gettime( a_clock_id, &t_now );
+            return int64_t(t_now.tv_sec) * 1000000000 + t_now.tv_nsec;
+        }
 
-        typedef std::chrono::steady_clock::duration duration_t;
-        typedef std::chrono::steady_clock::time_point time_point_t;
+        // time_t and long are used by timespec
+        timespec to_timespec( int64_t a_ns )
+        {
+            timespec t_time;
+            t_time.tv_sec = time_t( a_ns / 1000000000 );
+            t_time.tv_nsec = long( a_ns % 1000000000 );
+            return t_time;
+        }
 
-        duration_t t_run_duration = std::chrono::duration_cast< duration_t >( std::chrono::milliseconds(a_duration) ); // a_duration converted from ms to duration_t
-        duration_t t_sub_duration = std::chrono::duration_cast< duration_t >( std::chrono::milliseconds(500) ); // 500 ms sub-duration converted to duration_t
-        LINFO( plog, "Run duration will be " << a_duration << " ms;  sub-durations of 500 ms will be used" );
-        LDEBUG( plog, "In units of steady_clock::duration: run duration is " << t_run_duration.count() << " and sub_duration is " << t_sub_duration.count() );
+        double ns_to_seconds( int64_t a_ns )
+        {
+            return double( a_ns ) * 1.e-9;
+        }
+    }
 
-        std::unique_lock< std::mutex > t_run_stop_lock( f_run_stop_mutex );
-        f_do_break_run = false;
+    int64_t run_control::run_clock_now( run_clock a_clock )
+    {
+        return clock_now( to_clock_id( a_clock ) );
+    }
 
-        LDEBUG( plog, "Unpausing midge" );
-        set_status( status::running );
-        if( f_midge_pkg.have_lock() ) f_midge_pkg->instruct( midge::instruction::resume );
-        else
+    bool run_control::wait_for_run_time( std::unique_lock< std::mutex >& a_lock, int a_clock_id, int64_t a_target_ns, bool a_precise )
+    {
+        // the condition variable can wake up late by about a scheduler tick; clock_nanosleep() covers the last part of a precise wait
+        const int64_t t_precise_margin_ns = 2000000; // 2 ms
+        const int64_t t_sub_duration_ns = 500000000; // 500 ms
+        int64_t t_margin_ns = a_precise ? t_precise_margin_ns : 0;
+
+        // conditions that will break the loop:
+        //   - the target time minus the margin has been reached
+        //   - f_run_stopper was notified by e.g. stop_run()
+        //   - run_control has been canceled
+        // sub-durations are used so that time steps of the clock are picked up (the condition variable waits on the steady clock)
+        while( ! f_do_break_run && ! is_canceled() )
+        {
+            int64_t t_remaining_ns = a_target_ns - clock_now( a_clock_id ) - t_margin_ns;
+            if( t_remaining_ns <= 0 ) break;
+            f_run_stopper.wait_for( a_lock, std::chrono::nanoseconds( std::min( t_remaining_ns, t_sub_duration_ns ) ) );
+        }
+        if( f_do_break_run || is_canceled() ) return false;
+
+        if( a_precise )
         {
-            LERROR( plog, "Midge resource is not available" );
-            return;
+            timespec t_target = to_timespec( a_target_ns );
+            while( clock_nanosleep( a_clock_id, TIMER_ABSTIME, &t_target, nullptr ) == EINTR ) {}
         }
+        return true;
+    }
 
-        if( a_duration == 0 )
+    void run_control::do_run( std::vector< run_step > a_steps, run_clock a_clock, int64_t a_start_ns )
+    {
+        // durations are in ms
+
+        std::unique_lock< std::mutex > t_run_stop_lock( f_run_stop_mutex );
+
+        clockid_t t_clock_id = to_clock_id( a_clock );
+        if( f_run_is_scheduled )
         {
-            LDEBUG( plog, "Untimed run stopper in use" );
-            // conditions that will break the loop:
-            //   - last sub-duration was not stopped for a timeout (the other possibility is that f_run_stopper was notified by e.g. stop_run())
-            //   - run_control has been canceled
-            while( ! f_do_break_run && ! is_canceled() )
+            LINFO( plog, "Run is scheduled to start at " << ns_to_seconds( a_start_ns ) << " s (" << run_clock_to_string( a_clock ) << " clock)" );
+            // scheduled starts always use the precise wait
+            bool t_start = wait_for_run_time( t_run_stop_lock, t_clock_id, a_start_ns, true );
+            {
+                std::unique_lock< std::mutex > t_status_lock( f_status_mutex );
+                t_start = t_start && f_status == status::activated;
+                f_run_is_scheduled = false;
+                if( t_start ) f_status.store( status::running );
+            }
+            if( t_start ) status_changed( status::activated, status::running );
+            else
             {
-                f_run_stopper.wait_for( t_run_stop_lock, t_sub_duration );
+                LINFO( plog, "Scheduled run was canceled before it started" );
+                f_msg_relay->send_notice( "Scheduled run was canceled before it started" );
+                return;
             }
         }
-        else
+
+        if( a_steps.size() > 1 )
         {
-            LDEBUG( plog, "Timed run stopper in use; limit is " << a_duration << " ms" );
-            // all but the last sub-duration last for t_sub_duration ms
-            // conditions that will break the loop:
-            //   - all sub-durations have been completed
-            //   - last sub-duration was not stopped for a timeout (the other possibility is that f_run_stopper was notified by e.g. stop_run())
-            //   - run_control has been canceled
+            LINFO( plog, "Run sequence of " << a_steps.size() << " runs is commencing" );
+        }
 
-            time_point_t t_run_start = std::chrono::steady_clock::now();
-            time_point_t t_run_end = t_run_start + t_run_duration;
+        int64_t t_last_pause = 0; // monotonic clock
+        int64_t t_max_gap = 0;
+        for( std::vector< run_step >::const_iterator t_step_it = a_steps.begin(); t_step_it != a_steps.end(); ++t_step_it )
+        {
+            // the sequence ends early if stop_run() was called during the previous run
+            if( f_do_break_run || is_canceled() ) break;
 
-            while( std::chrono::steady_clock::now() < t_run_end && ! f_do_break_run && ! is_canceled() )
+            if( ! t_step_it->f_config.empty() )
             {
-                // we use wait_until so that we can break the run up with subdurations and not worry about whether a subduration was interrupted by a spurious wakeup
-                f_run_stopper.wait_until( t_run_stop_lock, std::min( std::chrono::steady_clock::now() + t_sub_duration, t_run_end ) );
+                try
+                {
+                    for( param_node::const_iterator t_stream_it = t_step_it->f_config.begin(); t_stream_it != t_step_it->f_config.end(); ++t_stream_it )
+                    {
+                        for( param_node::const_iterator t_node_it = t_stream_it->as_node().begin(); t_node_it != t_stream_it->as_node().end(); ++t_node_it )
+                        {
+                            apply_config( t_stream_it.name(), t_node_it.name(), t_node_it->as_node() );
+                        }
+                    }
+                }
+                catch( std::exception& e )
+                {
+                    LERROR( plog, "Unable to apply the config for the next run; ending the run sequence: " << e.what() );
+                    f_msg_relay->send_error( std::string("Run sequence was ended because a run's config could not be applied: ") + e.what() );
+                    break;
+                }
             }
 
-        }
+            LINFO( plog, "Run is commencing" );
+            f_msg_relay->send_notice( "Run is commencing" );
+
+            this->on_pre_run();
+
+            unsigned t_duration = t_step_it->f_duration;
+            LINFO( plog, "Run duration will be " << t_duration << " ms" << (f_precise_timing ? "; precise timing is in use" : "") );
+
+            LDEBUG( plog, "Unpausing midge" );
+            if( f_midge_pkg.have_lock() ) f_midge_pkg->instruct( midge::instruction::resume );
+            else
+            {
+                LERROR( plog, "Midge resource is not available" );
+                break;
+            }
+            f_dead_time.run_resumed();
+            f_midge_is_resumed = true;
+            // the run duration is measured on the monotonic clock so that it's not affected by time steps of the run clock
+            int64_t t_run_start = clock_now( CLOCK_MONOTONIC );
+            {
+                std::unique_lock< std::mutex > t_times_lock( f_run_times_mutex );
+                if( t_step_it != a_steps.begin() )
+                {
+                    run_times t_next_times;
+                    t_next_times.f_clock = a_clock;
+                    t_next_times.f_gap = t_run_start - t_last_pause;
+                    t_max_gap = std::max( t_max_gap, t_next_times.f_gap );
+                    f_run_times = t_next_times;
+                }
+                f_run_times.f_resume = clock_now( t_clock_id );
+            }
+            // the start-run handler waits for the resume time; the status doesn't change here, so its waiters have to be woken explicitly
+            notify_status_waiters();
+
+            if( t_duration == 0 )
+            {
+                LDEBUG( plog, "Untimed run stopper in use" );
+                while( ! f_do_break_run && ! is_canceled() )
+                {
+                    f_run_stopper.wait( t_run_stop_lock );
+                }
+            }
+            else
+            {
+                LDEBUG( plog, "Timed run stopper in use; limit is " << t_duration << " ms" );
+                wait_for_run_time( t_run_stop_lock, CLOCK_MONOTONIC, t_run_start + int64_t(t_duration) * 1000000, f_precise_timing );
+            }
+
+            // if we've reached here, we need to pause midge.
+            // reasons for this include the timer has run out in a timed run, or the run has been manually stopped
 
-        // if we've reached here, we need to pause midge.
-        // reasons for this include the timer has run out in a timed run, or the run has been manually stopped
+            LDEBUG( plog, "Run stopper has been released" );
 
-        LDEBUG( plog, "Run stopper has been released" );
+            if( f_midge_pkg.have_lock() ) f_midge_pkg->instruct( midge::instruction::pause );
+            f_dead_time.run_paused();
+            f_midge_is_resumed = false;
+            t_last_pause = clock_now( CLOCK_MONOTONIC );
+            {
+                std::unique_lock< std::mutex > t_times_lock( f_run_times_mutex );
+                f_run_times.f_pause = clock_now( t_clock_id );
+                f_run_sequence_times.push_back( f_run_times );
+                f_runs_metric.add();
+                f_run_duration_metric.record( uint64_t( t_last_pause - t_run_start ) );
+                LINFO( plog, "Run lasted " << double(f_run_times.f_pause - f_run_times.f_resume) * 1.e-6 << " ms" );
+            }
+
+            LINFO( plog, "Run has stopped" );
+            f_msg_relay->send_notice( "Run has stopped" );
+
+            this->on_post_run();
+        }
 
-        if( f_midge_pkg.have_lock() ) f_midge_pkg->instruct( midge::instruction::pause );
         set_status( status::activated );
 
-        LINFO( plog, "Run has stopped" );
-        f_msg_relay->send_notice( "Run has stopped" );
+        if( a_steps.size() > 1 )
+        {
+            LINFO( plog, "Run sequence has ended; the longest pause between runs was " << double(t_max_gap) * 1.e-6 << " ms" );
+        }
 
         if( f_do_break_run ) 
         {
@@ -449,8 +706,6 @@ namespace sandfly
             LINFO( plog, "Run was cancelled" );
         }
 
-        this->on_post_run();
-
         return;
     }
 
@@ -458,7 +713,8 @@ namespace sandfly
     {
         LINFO( plog, "Run stop requested" );
 
-        if( get_status() != status::running ) return;
+        // a scheduled run that hasn't started yet is also stopped
+        if( get_status() != status::running && ! f_run_is_scheduled ) return;
 
         if( ! f_midge_pkg.have_lock() ) 
         {
@@ -476,7 +732,7 @@ namespace sandfly
     {
         LDEBUG( plog, "Canceling DAQ control" );
 
-        if( get_status() == status::running )
+        if( get_status() == status::running || f_run_is_scheduled )
         {
             LDEBUG( plog, "Canceling run" );
             try
@@ -497,87 +753,309 @@ namespace sandfly
         return;
     }
 
+    void run_control::set_node_bindings( active_node_bindings* a_bindings )
+    {
+        std::unique_lock< std::shared_mutex > t_lock( f_node_bindings_mutex );
+        f_node_bindings = a_bindings;
+        return;
+    }
+
+    node_id_t run_control::find_node_id( const std::string& a_stream_name, const std::string& a_node_name ) const
+    {
+        node_id_t t_node_id = f_node_manager->names().find_node( a_stream_name, a_node_name );
+        if( t_node_id == name_registry::s_invalid_id )
+        {
+            throw error() << "Did not find node <" << a_stream_name << "." << a_node_name << ">";
+        }
+        return t_node_id;
+    }
+
+    node_id_t run_control::find_node_id( const std::string& a_full_name ) const
+    {
+        node_id_t t_node_id = f_node_manager->names().find_node( a_full_name );
+        if( t_node_id == name_registry::s_invalid_id )
+        {
+            throw error() << "Did not find node <" << a_full_name << ">";
+        }
+        return t_node_id;
+    }
+
+    void run_control::apply_config( const std::string& a_stream_name, const std::string& a_node_name, const scarab::param_node& a_config )
+    {
+        apply_config( find_node_id( a_stream_name, a_node_name ), a_config );
+        return;
+    }
+
     void run_control::apply_config( const std::string& a_node_name, const scarab::param_node& a_config )
     {
+        apply_config( find_node_id( a_node_name ), a_config );
+        return;
+    }
+
+    void run_control::apply_config( node_id_t a_node_id, const scarab::param_node& a_config )
+    {
+        const std::string& t_node_name = f_node_manager->names().full_node_name( a_node_id );
+
+        std::unique_lock< std::shared_mutex > t_lock( f_node_bindings_mutex );
         if( f_node_bindings == nullptr )
         {
-            throw error() << "Can't apply config to node <" << a_node_name << ">: node bindings aren't available";
+            throw error() << "Can't apply config to node <" << t_node_name << ">: node bindings aren't available";
         }
 
-        active_node_bindings::iterator t_binding_it = f_node_bindings->find( a_node_name );
-        if( t_binding_it == f_node_bindings->end() )
+        active_node_bindings::entry* t_binding = f_node_bindings->find( a_node_id );
+        if( t_binding == nullptr )
         {
-            throw error() << "Can't apply config to node <" << a_node_name << ">: did not find node";
+            throw error() << "Can't apply config to node <" << t_node_name << ">: did not find node";
         }
 
         try
         {
-            LDEBUG( plog, "Applying config to active node <" << a_node_name << ">: " << a_config );
-            t_binding_it->second.first->apply_config( t_binding_it->second.second, a_config );
+            LDEBUG( plog, "Applying config to active node <" << t_node_name << ">: " << a_config );
+            t_binding->f_binding->apply_config( t_binding->f_node, a_config );
         }
         catch( std::exception& e )
         {
-            throw error() << "Can't apply config to node <" << a_node_name << ">: " << e.what();
+            throw error() << "Can't apply config to node <" << t_node_name << ">: " << e.what();
         }
         return;
     }
 
+    void run_control::dump_config( const std::string& a_stream_name, const std::string& a_node_name, scarab::param_node& a_config )
+    {
+        dump_config( find_node_id( a_stream_name, a_node_name ), a_config );
+        return;
+    }
+
     void run_control::dump_config( const std::string& a_node_name, scarab::param_node& a_config )
     {
-        if( f_node_bindings == nullptr )
-        {
-            throw error() << "Can't dump config from node <" << a_node_name << ">: node bindings aren't available";
-        }
+        dump_config( find_node_id( a_node_name ), a_config );
+        return;
+    }
+
+    void run_control::dump_config( node_id_t a_node_id, scarab::param_node& a_config )
+    {
+        const std::string& t_node_name = f_node_manager->names().full_node_name( a_node_id );
 
+        std::unique_lock< std::shared_mutex > t_lock( f_node_bindings_mutex );
         if( f_node_bindings == nullptr )
         {
-            throw error() << "Can't dump config from node <" << a_node_name << ">: node bindings aren't available";
+            throw error() << "Can't dump config from node <" << t_node_name << ">: node bindings aren't available";
         }
 
-        active_node_bindings::iterator t_binding_it = f_node_bindings->find( a_node_name );
-        if( t_binding_it == f_node_bindings->end() )
+        active_node_bindings::entry* t_binding = f_node_bindings->find( a_node_id );
+        if( t_binding == nullptr )
         {
-            throw error() << "Can't dump config from node <" << a_node_name << ">: did not find node";
+            throw error() << "Can't dump config from node <" << t_node_name << ">: did not find node";
         }
 
         try
         {
-            LDEBUG( plog, "Dumping config from active node <" << a_node_name << ">" );
-            t_binding_it->second.first->dump_config( t_binding_it->second.second, a_config );
+            LDEBUG( plog, "Dumping config from active node <" << t_node_name << ">" );
+            t_binding->f_binding->dump_config( t_binding->f_node, a_config );
         }
         catch( std::exception& e )
         {
-            throw error() << "Can't dump config from node <" << a_node_name << ">: " << e.what();
+            throw error() << "Can't dump config from node <" << t_node_name << ">: " << e.what();
         }
         return;
     }
 
-    bool run_control::run_command( const std::string& a_node_name, const std::string& a_cmd, const scarab::param_node& a_args )
+    void run_control::apply_config_transaction( const scarab::param_node& a_configs )
     {
+        typedef std::vector< std::pair< node_id_t, const param_node* > > node_configs_t;
+
+        // validate the shape of the configs and find the node IDs before locking anything
+        node_configs_t t_node_configs;
+        for( param_node::const_iterator t_stream_it = a_configs.begin(); t_stream_it != a_configs.end(); ++t_stream_it )
+        {
+            if( ! t_stream_it->is_node() )
+            {
+                throw error() << "Config for stream <" << t_stream_it.name() << "> is not a node";
+            }
+            for( param_node::const_iterator t_node_it = t_stream_it->as_node().begin(); t_node_it != t_stream_it->as_node().end(); ++t_node_it )
+            {
+                if( ! t_node_it->is_node() || t_node_it->as_node().empty() )
+                {
+                    throw error() << "Config for node <" << t_stream_it.name() << "." << t_node_it.name() << "> is empty or is not a node";
+                }
+                t_node_configs.push_back( node_configs_t::value_type( find_node_id( t_stream_it.name(), t_node_it.name() ), &t_node_it->as_node() ) );
+            }
+        }
+        if( t_node_configs.empty() )
+        {
+            throw error() << "No node configs were given";
+        }
+
+        // holding the run-stop mutex keeps a run from starting or ending (or a run sequence from moving on) in the meantime
+        std::unique_lock< std::mutex > t_run_stop_lock( f_run_stop_mutex );
+        std::unique_lock< std::shared_mutex > t_bindings_lock( f_node_bindings_mutex );
+
         if( f_node_bindings == nullptr )
         {
-            throw error() << "Can't run command <" << a_cmd << "> on node <" << a_node_name << ">: node bindings aren't available";
+            throw error() << "Can't apply config: node bindings aren't available";
         }
 
+        // check that all of the nodes exist and that their configs are valid, and save their current config
+        const name_registry& t_names = f_node_manager->names();
+        std::vector< active_node_bindings::entry* > t_bindings;
+        std::vector< param_node > t_saved_configs( t_node_configs.size() );
+        for( unsigned i_node = 0; i_node < t_node_configs.size(); ++i_node )
+        {
+            active_node_bindings::entry* t_binding = f_node_bindings->find( t_node_configs[ i_node ].first );
+            if( t_binding == nullptr )
+            {
+                throw error() << "Can't apply config to node <" << t_names.full_node_name( t_node_configs[ i_node ].first ) << ">: did not find node";
+            }
+            t_bindings.push_back( t_binding );
+            try
+            {
+                t_binding->f_binding->validate_config( *t_node_configs[ i_node ].second );
+            }
+            catch( std::exception& e )
+            {
+                throw error() << "Config for node <" << t_names.full_node_name( t_node_configs[ i_node ].first ) << "> is invalid: " << e.what();
+            }
+            try
+            {
+                t_binding->f_binding->dump_config( t_binding->f_node, t_saved_configs[ i_node ] );
+            }
+            catch( std::exception& e )
+            {
+                throw error() << "Can't save the config of node <" << t_names.full_node_name( t_node_configs[ i_node ].first ) << ">: " << e.what();
+            }
+        }
+
+        // the status alone isn't enough: it's already running before do_run() resumes midge, and still running after the last pause of a run sequence;
+        // do_run() only changes f_midge_is_resumed while holding the run-stop mutex, so midge can't be paused or resumed behind our back
+        bool t_pause = f_midge_is_resumed && f_midge_pkg.have_lock();
+        if( t_pause )
+        {
+            LDEBUG( plog, "Pausing midge to apply the configs of " << t_node_configs.size() << " node(s)" );
+            f_midge_pkg->instruct( midge::instruction::pause );
+            f_dead_time.run_interrupted();
+        }
+
+        std::string t_error_message;
+        unsigned t_n_applied = 0;
+        for( ; t_n_applied < t_node_configs.size(); ++t_n_applied )
+        {
+            try
+            {
+                LDEBUG( plog, "Applying config to active node <" << t_names.full_node_name( t_node_configs[ t_n_applied ].first ) << ">: " << *t_node_configs[ t_n_applied ].second );
+                t_bindings[ t_n_applied ]->f_binding->apply_config( t_bindings[ t_n_applied ]->f_node, *t_node_configs[ t_n_applied ].second );
+            }
+            catch( std::exception& e )
+            {
+                t_error_message = "Can't apply config to node <" + t_names.full_node_name( t_node_configs[ t_n_applied ].first ) + ">: " + e.what();
+                break;
+            }
+        }
+
+        bool t_restored = true;
+        if( ! t_error_message.empty() )
+        {
+            // restore the parameters that were changed, including those of the node that failed, in reverse order
+            LWARN( plog, t_error_message << "; restoring the nodes that were changed" );
+            for( int i_node = int(t_n_applied); i_node >= 0; --i_node )
+            {
+                param_node t_restore;
+                const param_node& t_applied = *t_node_configs[ i_node ].second;
+                for( param_node::const_iterator t_param_it = t_applied.begin(); t_param_it != t_applied.end(); ++t_param_it )
+                {
+                    if( t_saved_configs[ i_node ].has( t_param_it.name() ) ) t_restore.add( t_param_it.name(), t_saved_configs[ i_node ][ t_param_it.name() ] );
+                    else
+                    {
+                        LWARN( plog, "Parameter <" << t_param_it.name() << "> of node <" << t_names.full_node_name( t_node_configs[ i_node ].first ) << "> was not in its dumped config and can't be restored" );
+                        t_restored = false;
+                    }
+                }
+                if( t_restore.empty() ) continue;
+                try
+                {
+                    t_bindings[ i_node ]->f_binding->apply_config( t_bindings[ i_node ]->f_node, t_restore );
+                }
+                catch( std::exception& e )
+                {
+                    LERROR( plog, "Unable to restore the config of node <" << t_names.full_node_name( t_node_configs[ i_node ].first ) << ">: " << e.what() );
+                    t_restored = false;
+                }
+            }
+        }
+
+        if( t_pause )
+        {
+            f_midge_pkg->instruct( midge::instruction::resume );
+            f_dead_time.run_continued();
+            LDEBUG( plog, "Midge has been resumed" );
+        }
+
+        if( ! t_error_message.empty() )
+        {
+            throw error() << t_error_message << (t_restored ? "; the nodes that were changed have been restored" : "; not all of the changes could be undone (see the log)");
+        }
+        return;
+    }
+
+    bool run_control::collect_node_statistics( const node_statistics_func_t& a_func )
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_node_bindings_mutex );
+        if( f_node_bindings == nullptr ) return false;
+
+        const name_registry& t_names = f_node_bindings->names();
+        const active_node_bindings::entries_t& t_entries = f_node_bindings->entries();
+        for( node_id_t t_node_id = 0; t_node_id < t_entries.size(); ++t_node_id )
+        {
+            if( t_entries[ t_node_id ].f_binding == nullptr ) continue;
+
+            node_statistics t_stats;
+            try
+            {
+                if( ! t_entries[ t_node_id ].f_binding->get_statistics( t_entries[ t_node_id ].f_node, t_stats ) ) continue;
+            }
+            catch( std::exception& e )
+            {
+                LWARN( plog, "Unable to get statistics from node <" << t_names.full_node_name( t_node_id ) << ">: " << e.what() );
+                continue;
+            }
+            a_func( t_names.stream_name( t_names.node_stream( t_node_id ) ), t_names.node_name( t_node_id ), t_stats );
+        }
+        return true;
+    }
+
+    bool run_control::run_command( const std::string& a_stream_name, const std::string& a_node_name, const std::string& a_cmd, const scarab::param_node& a_args )
+    {
+        return run_command( find_node_id( a_stream_name, a_node_name ), a_cmd, a_args );
+    }
+
+    bool run_control::run_command( const std::string& a_node_name, const std::string& a_cmd, const scarab::param_node& a_args )
+    {
+        return run_command( find_node_id( a_node_name ), a_cmd, a_args );
+    }
+
+    bool run_control::run_command( node_id_t a_node_id, const std::string& a_cmd, const scarab::param_node& a_args )
+    {
+        const std::string& t_node_name = f_node_manager->names().full_node_name( a_node_id );
+
+        std::unique_lock< std::shared_mutex > t_lock( f_node_bindings_mutex );
         if( f_node_bindings == nullptr )
         {
-            throw error() << "Can't run command <" << a_cmd << "> on node <" << a_node_name << ">: node bindings aren't available";
+            throw error() << "Can't run command <" << a_cmd << "> on node <" << t_node_name << ">: node bindings aren't available";
         }
 
-        active_node_bindings::iterator t_binding_it = f_node_bindings->find( a_node_name );
-        if( t_binding_it == f_node_bindings->end() )
+        active_node_bindings::entry* t_binding = f_node_bindings->find( a_node_id );
+        if( t_binding == nullptr )
         {
-            throw error() << "Can't run command <" << a_cmd << "> on node <" << a_node_name << ">: did not find node";
+            throw error() << "Can't run command <" << a_cmd << "> on node <" << t_node_name << ">: did not find node";
         }
 
         try
         {
-            LDEBUG( plog, "Running command <" << a_cmd << "> on active node <" << a_node_name << ">" );
-            return t_binding_it->second.first->run_command( t_binding_it->second.second, a_cmd, a_args );
+            LDEBUG( plog, "Running command <" << a_cmd << "> on active node <" << t_node_name << ">" );
+            return t_binding->f_binding->run_command( t_binding->f_node, a_cmd, a_args );
         }
         catch( std::exception& e )
         {
-            throw error() << "Can't run command <" << a_cmd << "> on node <" << a_node_name << ">: " << e.what();
+            throw error() << "Can't run command <" << a_cmd << "> on node <" << t_node_name << ">: " << e.what();
         }
     }
 
@@ -625,8 +1103,33 @@ namespace sandfly
     {
         try
         {
-            start_run();
-            return a_request->reply( dripline::dl_success(), "Run starting" );
+            run_clock t_clock = f_default_run_clock;
+            int64_t t_start_ns = 0;
+            if( a_request->payload().is_node() )
+            {
+                const param_node& t_payload = a_request->payload().as_node();
+                if( t_payload.has( "clock" ) ) t_clock = string_to_run_clock( t_payload["clock"]().as_string() );
+                if( t_payload.has( "start-time" ) ) t_start_ns = int64_t( t_payload["start-time"]().as_double() * 1.e9 );
+            }
+
+            start_run( t_clock, t_start_ns );
+
+            param_ptr_t t_payload_ptr( new param_node() );
+            param_node& t_reply_payload = t_payload_ptr->as_node();
+            t_reply_payload.add( "clock", param_value( run_clock_to_string( t_clock ) ) );
+            if( f_run_is_scheduled )
+            {
+                t_reply_payload.add( "start-time", param_value( ns_to_seconds( t_start_ns ) ) );
+                return a_request->reply( dripline::dl_success(), "Run scheduled", std::move(t_payload_ptr) );
+            }
+
+            // immediate start: wait (briefly) for midge to be resumed so that the resume time can be reported
+            wait_for_status( [this]( status ){ return get_run_times().f_resume != 0; },
+                    std::chrono::steady_clock::now() + std::chrono::seconds(1) );
+            run_times t_times = get_run_times();
+            if( t_times.f_resume != 0 ) t_reply_payload.add( "resume-time", param_value( ns_to_seconds( t_times.f_resume ) ) );
+            if( t_times.f_pause != 0 ) t_reply_payload.add( "pause-time", param_value( ns_to_seconds( t_times.f_pause ) ) );
+            return a_request->reply( dripline::dl_success(), "Run starting", std::move(t_payload_ptr) );
         }
         catch( std::exception& e )
         {
@@ -635,6 +1138,48 @@ namespace sandfly
         }
     }
 
+    dripline::reply_ptr_t run_control::handle_start_run_sequence_request( const dripline::request_ptr_t a_request )
+    {
+        try
+        {
+            if( ! a_request->payload().is_node() || ! a_request->payload().as_node().has( "runs" ) || ! a_request->payload()["runs"].is_array() )
+            {
+                return a_request->reply( dripline::dl_service_error_bad_payload(), "Unable to start run sequence: payload must include an array of \"runs\"" );
+            }
+            const param_node& t_payload = a_request->payload().as_node();
+
+            std::vector< run_step > t_steps;
+            const param_array& t_runs = t_payload["runs"].as_array();
+            for( param_array::const_iterator t_run_it = t_runs.begin(); t_run_it != t_runs.end(); ++t_run_it )
+            {
+                const param_node& t_run = t_run_it->as_node();
+                run_step t_step;
+                t_step.f_duration = t_run.get_value( "duration", 0U );
+                if( t_run.has( "config" ) ) t_step.f_config = t_run["config"].as_node();
+                t_steps.push_back( t_step );
+            }
+
+            run_clock t_clock = f_default_run_clock;
+            int64_t t_start_ns = 0;
+            if( t_payload.has( "clock" ) ) t_clock = string_to_run_clock( t_payload["clock"]().as_string() );
+            if( t_payload.has( "start-time" ) ) t_start_ns = int64_t( t_payload["start-time"]().as_double() * 1.e9 );
+
+            start_run_sequence( t_steps, t_clock, t_start_ns );
+
+            param_ptr_t t_payload_ptr( new param_node() );
+            param_node& t_reply_payload = t_payload_ptr->as_node();
+            t_reply_payload.add( "n-runs", param_value( unsigned(t_steps.size()) ) );
+            t_reply_payload.add( "clock", param_value( run_clock_to_string( t_clock ) ) );
+            if( f_run_is_scheduled ) t_reply_payload.add( "start-time", param_value( ns_to_seconds( t_start_ns ) ) );
+            return a_request->reply( dripline::dl_success(), f_run_is_scheduled ? "Run sequence scheduled" : "Run sequence starting", std::move(t_payload_ptr) );
+        }
+        catch( std::exception& e )
+        {
+            LWARN( plog, "there was an error starting a run sequence" );
+            return a_request->reply( dripline::dl_service_error(), string( "Unable to start run sequence: " ) + e.what() );
+        }
+    }
+
     dripline::reply_ptr_t run_control::handle_stop_run_request( const dripline::request_ptr_t a_request )
     {
         try
@@ -652,7 +1197,48 @@ namespace sandfly
     {
         if( a_request->parsed_specifier().size() < 2 )
         {
-            return a_request->reply( dripline::dl_service_error_invalid_method(), "Specifier is improperly formatted: active-config.[stream].[node] or node-config.[stream].[node].[parameter]" );
+            // several nodes at once: active-config ([stream]: [node]: params) or active-config.[stream] ([node]: params)
+            if( ! a_request->payload().is_node() || a_request->payload().as_node().empty() )
+            {
+                return a_request->reply( dripline::dl_service_error_bad_payload(), "Unable to perform active-config request: payload is empty" );
+            }
+
+            param_node t_configs;
+            if( a_request->parsed_specifier().empty() )
+            {
+                const param_node& t_request_configs = a_request->payload().as_node();
+                for( param_node::const_iterator t_it = t_request_configs.begin(); t_it != t_request_configs.end(); ++t_it )
+                {
+                    // "[stream].[node]" keys are split
+                    std::string::size_type t_dot = t_it.name().find( '.' );
+                    if( t_dot == std::string::npos )
+                    {
+                        if( t_configs.has( t_it.name() ) && t_it->is_node() ) t_configs[ t_it.name() ].as_node().merge( t_it->as_node() );
+                        else t_configs.add( t_it.name(), *t_it );
+                        continue;
+                    }
+                    std::string t_stream_name( t_it.name().substr( 0, t_dot ) );
+                    if( ! t_configs.has( t_stream_name ) ) t_configs.add( t_stream_name, param_node() );
+                    t_configs[ t_stream_name ].as_node().add( t_it.name().substr( t_dot + 1 ), *t_it );
+                }
+            }
+            else
+            {
+                t_configs.add( a_request->parsed_specifier().front(), a_request->payload().as_node() );
+            }
+
+            try
+            {
+                apply_config_transaction( t_configs );
+            }
+            catch( std::exception& e )
+            {
+                return a_request->reply( dripline::dl_service_error(), std::string("Unable to perform active-config request: ") + e.what() );
+            }
+
+            param_ptr_t t_payload_ptr( new param_node( t_configs ) );
+            LDEBUG( plog, "Active-config transaction was successful" );
+            return a_request->reply( dripline::dl_success(), "Performed active-config", std::move(t_payload_ptr) );
         }
 
         //size_t t_rks_size = a_request->parsed_rks().size();
@@ -660,7 +1246,7 @@ namespace sandfly
         std::string t_target_stream = a_request->parsed_specifier().front();
         a_request->parsed_specifier().pop_front();
 
-        std::string t_target_node = t_target_stream + "_" + a_request->parsed_specifier().front();
+        std::string t_target_node = a_request->parsed_specifier().front();
         a_request->parsed_specifier().pop_front();
 
         param_ptr_t t_payload_ptr( new param_node() );
@@ -669,7 +1255,7 @@ namespace sandfly
         if( a_request->parsed_specifier().empty() )
         {
             // payload should be a map of all parameters to be set
-            LDEBUG( plog, "Performing config for multiple values in active node <" << t_target_node << ">" );
+            LDEBUG( plog, "Performing config for multiple values in active node <" << t_target_stream << "." << t_target_node << ">" );
 
             if( ! a_request->payload().is_node() || a_request->payload().as_node().empty() )
             {
@@ -678,7 +1264,7 @@ namespace sandfly
 
             try
             {
-                apply_config( t_target_node, a_request->payload().as_node() );
+                apply_config( t_target_stream, t_target_node, a_request->payload().as_node() );
                 t_payload.merge( a_request->payload().as_node() );
             }
             catch( std::exception& e )
@@ -689,7 +1275,7 @@ namespace sandfly
         else
         {
             // payload should be values array with a single entry for the particular parameter to be set
-            LDEBUG( plog, "Performing node config for a single value in active node <" << t_target_node << ">" );
+            LDEBUG( plog, "Performing node config for a single value in active node <" << t_target_stream << "." << t_target_node << ">" );
 
             if( ! a_request->payload().is_node() || ! a_request->payload().as_node().has( "values" ) )
             {
@@ -709,7 +1295,7 @@ namespace sandfly
 
             try
             {
-                apply_config( t_target_node, t_param_to_set );
+                apply_config( t_target_stream, t_target_node, t_param_to_set );
                 t_payload.merge( t_param_to_set );
             }
             catch( std::exception& e )
@@ -734,7 +1320,7 @@ namespace sandfly
         std::string t_target_stream = a_request->parsed_specifier().front();
         a_request->parsed_specifier().pop_front();
 
-        std::string t_target_node = t_target_stream + "_" + a_request->parsed_specifier().front();
+        std::string t_target_node = a_request->parsed_specifier().front();
         a_request->parsed_specifier().pop_front();
 
         param_ptr_t t_payload_ptr( new param_node() );
@@ -743,11 +1329,11 @@ namespace sandfly
         if( a_request->parsed_specifier().empty() )
         {
             // getting full node configuration
-            LDEBUG( plog, "Getting node config for active node <" << t_target_node << ">" );
+            LDEBUG( plog, "Getting node config for active node <" << t_target_stream << "." << t_target_node << ">" );
 
             try
             {
-                dump_config( t_target_node, t_payload );
+                dump_config( t_target_stream, t_target_node, t_payload );
             }
             catch( std::exception& e )
             {
@@ -757,14 +1343,14 @@ namespace sandfly
         else
         {
             // getting value for a single parameter
-            LDEBUG( plog, "Getting value for a single parameter in active node <" << t_target_node << ">" );
+            LDEBUG( plog, "Getting value for a single parameter in active node <" << t_target_stream << "." << t_target_node << ">" );
 
             std::string t_param_to_get = a_request->parsed_specifier().front();
 
             try
             {
                 scarab::param_node t_param_dump;
-                dump_config( t_target_node, t_param_dump );
+                dump_config( t_target_stream, t_target_node, t_param_dump );
                 if( ! t_param_dump.has( t_param_to_get ) )
                 {
                     return a_request->reply( dripline::dl_service_error_invalid_key(), "Unable to get active-node parameter: cannot find parameter <" + t_param_to_get + ">" );
@@ -793,7 +1379,7 @@ namespace sandfly
         std::string t_target_stream = a_request->parsed_specifier().front();
         a_request->parsed_specifier().pop_front();
 
-        std::string t_target_node = t_target_stream + "_" + a_request->parsed_specifier().front();
+        std::string t_target_node = a_request->parsed_specifier().front();
         a_request->parsed_specifier().pop_front();
 
         scarab::param_node t_args_node;
@@ -802,7 +1388,7 @@ namespace sandfly
         std::string t_command( a_request->parsed_specifier().front() );
         a_request->parsed_specifier().pop_front();
 
-        LDEBUG( plog, "Performing run-command <" << t_command << "> for active node <" << t_target_node << ">; args:\n" << t_args_node );
+        LDEBUG( plog, "Performing run-command <" << t_command << "> for active node <" << t_target_stream << "." << t_target_node << ">; args:\n" << t_args_node );
 
         param_ptr_t t_payload_ptr( new param_node() );
         param_node& t_payload = t_payload_ptr->as_node();
@@ -810,7 +1396,7 @@ namespace sandfly
         bool t_return = false;
         try
         {
-            t_return = run_command( t_target_node, t_command, t_args_node );
+            t_return = run_command( t_target_stream, t_target_node, t_command, t_args_node );
             t_payload.merge( t_args_node );
             t_payload.add( "command", t_command );
         }
@@ -842,7 +1428,7 @@ namespace sandfly
             }
             f_run_duration =  t_new_duration;
 
-            LDEBUG( plog, "Duration set to <" << f_run_duration << "> ms" );
+            LDEBUG( plog, "Duration set to <" << t_new_duration << "> ms" );
             return a_request->reply( dripline::dl_success(), "Duration set" );
         }
         catch( std::exception& e )
@@ -857,7 +1443,55 @@ namespace sandfly
         t_server_node.add( "status", param_value( interpret_status( get_status() ) ) );
         t_server_node.add( "status-value", param_value( status_to_uint( get_status() ) ) );
 
-        // TODO: add status of nodes
+        run_times t_times = get_run_times();
+        param_node t_run_node;
+        t_run_node.add( "clock", param_value( run_clock_to_string( t_times.f_clock ) ) );
+        t_run_node.add( "precise-timing", param_value( f_precise_timing ) );
+        if( t_times.f_scheduled_start != 0 ) t_run_node.add( "scheduled-start-time", param_value( ns_to_seconds( t_times.f_scheduled_start ) ) );
+        if( t_times.f_resume != 0 ) t_run_node.add( "resume-time", param_value( ns_to_seconds( t_times.f_resume ) ) );
+        if( t_times.f_pause != 0 ) t_run_node.add( "pause-time", param_value( ns_to_seconds( t_times.f_pause ) ) );
+        t_server_node.add( "run", t_run_node );
+
+        std::vector< run_times > t_sequence_times = get_run_sequence_times();
+        if( t_sequence_times.size() > 1 )
+        {
+            param_array t_sequence_array;
+            int64_t t_max_gap = 0;
+            for( std::vector< run_times >::const_iterator t_it = t_sequence_times.begin(); t_it != t_sequence_times.end(); ++t_it )
+            {
+                param_node t_seq_run_node;
+                t_seq_run_node.add( "resume-time", param_value( ns_to_seconds( t_it->f_resume ) ) );
+                t_seq_run_node.add( "pause-time", param_value( ns_to_seconds( t_it->f_pause ) ) );
+                t_seq_run_node.add( "gap-ms", param_value( double(t_it->f_gap) * 1.e-6 ) );
+                t_sequence_array.push_back( t_seq_run_node );
+                t_max_gap = std::max( t_max_gap, t_it->f_gap );
+            }
+            param_node t_sequence_node;
+            t_sequence_node.add( "runs", t_sequence_array );
+            t_sequence_node.add( "max-gap-ms", param_value( double(t_max_gap) * 1.e-6 ) );
+            t_server_node.add( "run-sequence", t_sequence_node );
+        }
+
+        param_node t_livetime_node;
+        f_dead_time.fill_status( t_livetime_node );
+        t_server_node.add( "livetime", t_livetime_node );
+
+        // node statistics are only available while midge is running
+        param_node t_streams_node;
+        if( collect_node_statistics( [&t_streams_node]( const std::string& a_stream_name, const std::string& a_node_name, const node_statistics& a_stats ){
+                    param_node t_node_stats;
+                    a_stats.to_param( t_node_stats );
+                    if( ! t_streams_node.has( a_stream_name ) ) t_streams_node.add( a_stream_name, param_node() );
+                    t_streams_node[ a_stream_name ].as_node().add( a_node_name, t_node_stats );
+                } ) )
+        {
+            t_server_node.add( "streams", t_streams_node );
+        }
+
+        // effective placement and scheduling of the node threads that have started
+        param_node t_threads_node;
+        placement_registry::global().report_applied( t_threads_node );
+        if( ! t_threads_node.empty() ) t_server_node.add( "threads", t_threads_node );
 
         param_ptr_t t_payload_ptr( new param_node() );
         t_payload_ptr->as_node().add( "server", t_server_node );
@@ -869,7 +1503,7 @@ namespace sandfly
     dripline::reply_ptr_t run_control::handle_get_duration_request( const dripline::request_ptr_t a_request )
     {
         param_array t_values_array;
-        t_values_array.push_back( param_value( f_run_duration ) );
+        t_values_array.push_back( param_value( f_run_duration.load() ) );
 
         param_ptr_t t_payload_ptr( new param_node() );
         t_payload_ptr->as_node().add( "values", t_values_array );
@@ -897,6 +1531,7 @@ namespace sandfly
         a_receiver_ptr->register_cmd_handler( "run-daq-cmd", std::bind( &run_control::handle_run_command_request, this, _1 ) );
         a_receiver_ptr->register_cmd_handler( "stop-run", std::bind( &run_control::handle_stop_run_request, this, _1 ) );
         a_receiver_ptr->register_cmd_handler( "start-run", std::bind( &run_control::handle_start_run_request, this, _1 ) );
+        a_receiver_ptr->register_cmd_handler( "start-run-sequence", std::bind( &run_control::handle_start_run_sequence_request, this, _1 ) );
         a_receiver_ptr->register_cmd_handler( "activate-daq", std::bind( &run_control::handle_activate_run_control, this, _1 ) );
         a_receiver_ptr->register_cmd_handler( "reactivate-daq", std::bind( &run_control::handle_reactivate_run_control, this, _1 ) );
         a_receiver_ptr->register_cmd_handler( "deactivate-daq", std::bind( &run_control::handle_deactivate_run_control, this, _1 ) );
@@ -906,6 +1541,81 @@ namespace sandfly
         return;
     }
 
+    void run_control::set_status( status a_status )
+    {
+        status t_old_status;
+        {
+            std::unique_lock< std::mutex > t_lock( f_status_mutex );
+            t_old_status = f_status.exchange( a_status );
+        }
+        if( t_old_status == a_status ) return;
+
+        status_changed( t_old_status, a_status );
+        return;
+    }
+
+    void run_control::status_changed( status a_old_status, status a_new_status )
+    {
+        f_status_condition.notify_all();
+
+        // call the callbacks outside of the lock so that they can add or remove callbacks
+        std::map< unsigned, status_callback_t > t_callbacks;
+        {
+            std::unique_lock< std::mutex > t_lock( f_status_callback_mutex );
+            t_callbacks = f_status_callbacks;
+        }
+        for( std::map< unsigned, status_callback_t >::const_iterator t_cb_it = t_callbacks.begin(); t_cb_it != t_callbacks.end(); ++t_cb_it )
+        {
+            try
+            {
+                t_cb_it->second( a_old_status, a_new_status );
+            }
+            catch( std::exception& e )
+            {
+                LWARN( plog, "Exception caught in status callback: " << e.what() );
+            }
+        }
+        return;
+    }
+
+    void run_control::wait_for_status( const status_predicate_t& a_predicate )
+    {
+        std::unique_lock< std::mutex > t_lock( f_status_mutex );
+        f_status_condition.wait( t_lock, [&](){ return a_predicate( f_status.load() ); } );
+        return;
+    }
+
+    bool run_control::wait_for_status( const status_predicate_t& a_predicate, const status_deadline_t& a_deadline )
+    {
+        std::unique_lock< std::mutex > t_lock( f_status_mutex );
+        return f_status_condition.wait_until( t_lock, a_deadline, [&](){ return a_predicate( f_status.load() ); } );
+    }
+
+    void run_control::notify_status_waiters()
+    {
+        {
+            // make sure that no waiter is between checking its predicate and waiting
+            std::unique_lock< std::mutex > t_lock( f_status_mutex );
+        }
+        f_status_condition.notify_all();
+        return;
+    }
+
+    unsigned run_control::add_status_callback( const status_callback_t& a_callback )
+    {
+        std::unique_lock< std::mutex > t_lock( f_status_callback_mutex );
+        unsigned t_id = f_next_status_callback_id++;
+        f_status_callbacks[ t_id ] = a_callback;
+        return t_id;
+    }
+
+    void run_control::remove_status_callback( unsigned a_id )
+    {
+        std::unique_lock< std::mutex > t_lock( f_status_callback_mutex );
+        f_status_callbacks.erase( a_id );
+        return;
+    }
+
     uint32_t run_control::status_to_uint( status a_status )
     {
         return static_cast< uint32_t >( a_status );
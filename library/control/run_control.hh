@@ -9,7 +9,10 @@
 #define SANDFLY_RUN_CONTROL_HH_
 
 #include "control_access.hh"
+#include "dead_time_tracker.hh"
 #include "message_relayer.hh"
+#include "metrics.hh"
+#include "node_builder.hh" // for node_statistics
 #include "stream_manager.hh" // for midge_package
 #include "sandfly_error.hh"
 
@@ -18,10 +21,16 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <future>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <thread>
+#include <vector>
 
 namespace sandfly
 {
@@ -55,6 +64,18 @@ namespace sandfly
      Settings that can be applied in the "daq" section of the global config:
      - "duration" (integer): the duration of the next run in ms
      - "activate-at-startup" (boolean): whether or not the DAQ control is activated immediately on startup
+     - "use-standby" (boolean): whether or not the next midge object is prepared in the background after deactivation,
+       so that the next activation only has to swap it in (it holds a second set of node resources while deactivated; see stream_manager)
+     - "n-build-threads" (integer): number of threads used to construct and configure the nodes when midge is built
+     - "auto-placement" (boolean): whether or not the streams are placed on CPUs and NUMA nodes automatically (see stream_manager)
+     - "precise-timing" (boolean): whether or not timed runs are stopped with sub-millisecond accuracy (see below)
+     - "run-clock" (string): clock used for scheduled starts and run timestamps, "realtime" (CLOCK_REALTIME; default) or "tai" (CLOCK_TAI)
+
+     Runs last "duration" ms (or until stop-run).  A start-run request can include a "start-time" (seconds since the epoch of
+     the run clock) and a "clock" in its payload; the run is held until that time, and a start time in the past starts it immediately.
+     Scheduled starts are always precise; in precise-timing mode the end of a run is too (the wait on f_run_stopper stops shortly
+     before the end, and clock_nanosleep() covers the rest), and otherwise it's only accurate to the condition-variable wakeup.
+     A sequence of back-to-back runs can be started with start-run-sequence (see start_run_sequence()).
 
      Developer notes:
      - Even though run_control's constructor has a default argument for the message_relayer, if you derive a class from 
@@ -108,6 +129,47 @@ namespace sandfly
             /// Stop run with stop_run()
             void start_run();
 
+            enum class run_clock
+            {
+                realtime,
+                tai
+            };
+            static std::string run_clock_to_string( run_clock a_clock );
+            /// Throws sandfly::error if the string is not a valid clock name
+            static run_clock string_to_run_clock( const std::string& a_name );
+            /// Current time of a_clock in ns since its epoch
+            static int64_t run_clock_now( run_clock a_clock );
+
+            /// Start a run at a_start_ns (ns since the epoch of a_clock)
+            /// Can throw run_control::run_error or status_error; run_control will still be usable
+            /// Can throw sandfly::error; run_control will NOT be usable
+            void start_run( run_clock a_clock, int64_t a_start_ns );
+
+            /// One run in a run sequence
+            struct run_step
+            {
+                unsigned f_duration; // ms; must be non-zero
+                scarab::param_node f_config; // config applied to the active nodes before the run: [stream]: [node]: {[parameter]: [value]}
+            };
+            /// Start a sequence of back-to-back runs at a_start_ns (ns since the epoch of a_clock; 0 to start immediately)
+            /// Midge is paused between the runs only for as long as it takes to apply the next run's config; the sequence is stopped with stop_run()
+            /// Can throw run_control::run_error or status_error; run_control will still be usable
+            /// Can throw sandfly::error; run_control will NOT be usable
+            void start_run_sequence( const std::vector< run_step >& a_steps, run_clock a_clock, int64_t a_start_ns );
+
+            /// Timestamps of the current or most recent run; times are in ns since the epoch of f_clock, and are 0 if they have not happened (yet)
+            struct run_times
+            {
+                run_clock f_clock = run_clock::realtime;
+                int64_t f_scheduled_start = 0;
+                int64_t f_resume = 0;
+                int64_t f_pause = 0;
+                int64_t f_gap = 0; // time midge was paused between the previous run in a sequence and this run
+            };
+            run_times get_run_times() const;
+            /// Timestamps of the runs in the current or most recent run sequence (a single run is a sequence of one)
+            std::vector< run_times > get_run_sequence_times() const;
+
             /// Stop a run
             /// Can throw run_control::run_error or status_error; run_control will still be usable
             /// Can throw sandfly::error; run_control will NOT be usable
@@ -135,28 +197,49 @@ namespace sandfly
 
 
         public:
+            /// Nodes can be given by ID (see stream_manager::names()), by stream and node name, or by full name ([stream]_[node])
+            /// Throws sandfly::error if the node doesn't exist or if the config can't be applied or dumped
+            void apply_config( node_id_t a_node_id, const scarab::param_node& a_config );
+            void apply_config( const std::string& a_stream_name, const std::string& a_node_name, const scarab::param_node& a_config );
             void apply_config( const std::string& a_node_name, const scarab::param_node& a_config );
+            void dump_config( node_id_t a_node_id, scarab::param_node& a_config );
+            void dump_config( const std::string& a_stream_name, const std::string& a_node_name, scarab::param_node& a_config );
             void dump_config( const std::string& a_node_name, scarab::param_node& a_config );
+            /// Applies configs to several active nodes as one change; a_configs is [stream]: [node]: {[parameter]: [value]}
+            /// If a run is in progress, midge is paused while the configs are applied
+            /// Throws sandfly::error if the configs can't be applied; in that case the nodes that were changed are restored
+            void apply_config_transaction( const scarab::param_node& a_configs );
 
             /// Instruct a node to run a command
             /// Throws sandfly::error if the command fails; returns false if the command is not recognized
+            bool run_command( node_id_t a_node_id, const std::string& a_cmd, const scarab::param_node& a_args );
+            bool run_command( const std::string& a_stream_name, const std::string& a_node_name, const std::string& a_cmd, const scarab::param_node& a_args );
             bool run_command( const std::string& a_node_name, const std::string& a_cmd, const scarab::param_node& a_args );
 
+            typedef std::function< void( const std::string& a_stream_name, const std::string& a_node_name, const node_statistics& a_stats ) > node_statistics_func_t;
+            /// Calls a_func for each active node that reports statistics; returns false (and does nothing) if midge is not running
+            bool collect_node_statistics( const node_statistics_func_t& a_func );
+
         public:
             virtual dripline::reply_ptr_t handle_activate_run_control( const dripline::request_ptr_t a_request );
             virtual dripline::reply_ptr_t handle_reactivate_run_control( const dripline::request_ptr_t a_request );
             virtual dripline::reply_ptr_t handle_deactivate_run_control( const dripline::request_ptr_t a_request );
 
             virtual dripline::reply_ptr_t handle_start_run_request( const dripline::request_ptr_t a_request );
+            virtual dripline::reply_ptr_t handle_start_run_sequence_request( const dripline::request_ptr_t a_request );
 
             virtual dripline::reply_ptr_t handle_stop_run_request( const dripline::request_ptr_t a_request );
 
+            /// A set request to active-config without a node (active-config, or active-config.[stream]) is applied with apply_config_transaction();
+            /// its payload is [stream]: [node]: {[parameter]: [value]} (or [node]: {...} for a single stream), and "[stream].[node]" keys are also accepted
             virtual dripline::reply_ptr_t handle_apply_config_request( const dripline::request_ptr_t a_request );
             virtual dripline::reply_ptr_t handle_dump_config_request( const dripline::request_ptr_t a_request );
             virtual dripline::reply_ptr_t handle_run_command_request( const dripline::request_ptr_t a_request );
 
             virtual dripline::reply_ptr_t handle_set_duration_request( const dripline::request_ptr_t a_request );
 
+            /// daq-status includes the run times, the live and dead time ("livetime"; see dead_time_tracker),
+            /// and the effective placement and scheduling of each node thread ("threads")
             virtual dripline::reply_ptr_t handle_get_status_request( const dripline::request_ptr_t a_request );
             virtual dripline::reply_ptr_t handle_get_duration_request( const dripline::request_ptr_t a_request );
 
@@ -167,7 +250,13 @@ namespace sandfly
         protected:
             void do_cancellation( int a_code );
 
-            void do_run( unsigned a_duration );
+            void do_run( std::vector< run_step > a_steps, run_clock a_clock, int64_t a_start_ns );
+
+            // waits on f_run_stopper until a_target_ns on a_clock (ns since the epoch of the clock);
+            // if a_precise, the last part of the wait uses clock_nanosleep() for sub-ms accuracy;
+            // returns false if the wait was interrupted because the run was stopped or canceled;
+            // requires a_lock to hold f_run_stop_mutex
+            bool wait_for_run_time( std::unique_lock< std::mutex >& a_lock, int a_clock_id, int64_t a_target_ns, bool a_precise );
 
             virtual void derived_register_handlers( std::shared_ptr< request_receiver > ) {}
 
@@ -180,17 +269,40 @@ namespace sandfly
 
             midge_package f_midge_pkg;
             active_node_bindings* f_node_bindings;
+            // guards f_node_bindings; configuring nodes and running node commands take it exclusively, so that they're serialized
+            // even when requests are handled concurrently, while reading statistics shares it
+            mutable std::shared_mutex f_node_bindings_mutex;
+            void set_node_bindings( active_node_bindings* a_bindings );
+
+            // throw sandfly::error if the node has not been added to the stream_manager
+            node_id_t find_node_id( const std::string& a_stream_name, const std::string& a_node_name ) const;
+            node_id_t find_node_id( const std::string& a_full_name ) const;
 
             std::condition_variable f_run_stopper; // ends the run after a given amount of time
             std::mutex f_run_stop_mutex; // mutex used by the run_stopper
             bool f_do_break_run; // bool to confirm that the run should stop; protected by f_run_stop_mutex
+            bool f_midge_is_resumed; // true from the resume to the pause of each run in do_run(); protected by f_run_stop_mutex
 
             std::future< void > f_run_return;
+            std::atomic< bool > f_run_is_scheduled; // true while a run is waiting for its start time
+
+            run_times f_run_times;
+            std::vector< run_times > f_run_sequence_times;
+            mutable std::mutex f_run_times_mutex;
+
+            dead_time_tracker f_dead_time;
+
+            // recorded in metrics_registry::global()
+            sharded_counter& f_runs_metric;
+            log_histogram& f_run_duration_metric; // ns
 
             std::shared_ptr< message_relayer > f_msg_relay;
 
         public:
-            mv_accessible( unsigned, run_duration );
+            mv_atomic( unsigned, run_duration );
+            mv_accessible( bool, use_standby );
+            mv_accessible( bool, precise_timing );
+            mv_accessible( run_clock, default_run_clock );
 
         public:
             enum class status:uint32_t
@@ -211,10 +323,35 @@ namespace sandfly
             static std::string interpret_status( status a_status );
 
             status get_status() const;
+            /// Sets the status; on a change of status, wakes the status waiters and calls the status callbacks
             void set_status( status a_status );
 
+            typedef std::function< bool( status ) > status_predicate_t;
+            typedef std::chrono::steady_clock::time_point status_deadline_t;
+            /// Blocks until a_predicate returns true for the current status; the predicate is checked on every status change and notify_status_waiters() call
+            void wait_for_status( const status_predicate_t& a_predicate );
+            /// Blocks until a_predicate returns true for the current status or a_deadline passes; returns the final result of the predicate
+            bool wait_for_status( const status_predicate_t& a_predicate, const status_deadline_t& a_deadline );
+            /// Wakes all status waiters so that they re-check their predicates
+            void notify_status_waiters();
+
+            /// Callbacks are called with the old and new status, in the thread that changed the status; they should return quickly
+            typedef std::function< void( status, status ) > status_callback_t;
+            /// Returns an ID that can be used to remove the callback
+            unsigned add_status_callback( const status_callback_t& a_callback );
+            void remove_status_callback( unsigned a_id );
+
         protected:
+            /// Wakes the status waiters and calls the status callbacks; call without holding f_status_mutex
+            void status_changed( status a_old_status, status a_new_status );
+
             std::atomic< status > f_status;
+            std::mutex f_status_mutex;
+            std::condition_variable f_status_condition;
+
+            std::map< unsigned, status_callback_t > f_status_callbacks;
+            unsigned f_next_status_callback_id;
+            std::mutex f_status_callback_mutex;
 
 
     };
@@ -224,12 +361,6 @@ namespace sandfly
         return f_status.load();
     }
 
-    inline void run_control::set_status( status a_status )
-    {
-        f_status.store( a_status );
-        return;
-    }
-
     inline const message_relayer& run_control::relayer() const
     {
         return *f_msg_relay;
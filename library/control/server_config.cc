@@ -44,6 +44,11 @@ namespace sandfly
         t_daq_node.add( "n-files", 1U );
         t_daq_node.add( "duration", 1000U );
         t_daq_node.add( "max-file-size-mb", 500.0 );
+        t_daq_node.add( "use-standby", false );
+        t_daq_node.add( "n-build-threads", 1U );
+        t_daq_node.add( "auto-placement", false );
+        t_daq_node.add( "precise-timing", false );
+        t_daq_node.add( "run-clock", "realtime" );
         add( "daq", t_daq_node );
 
         param_node t_batch_commands;
@@ -55,6 +60,19 @@ namespace sandfly
         t_stop_array.push_back( t_stop_action );
         t_batch_commands.add( "hard-abort", t_stop_array );
         add( "batch-commands",  t_batch_commands );
+        add( "batch-max-concurrent", 8U );
+
+        add( "request-workers", 2U );
+        // get-handler name: TTL in ms; no replies are cached by default
+        add( "reply-cache", param_node() );
+
+        param_node t_metrics_node;
+        t_metrics_node.add( "enable", false );
+        t_metrics_node.add( "mode", "http" );
+        t_metrics_node.add( "address", "127.0.0.1" );
+        t_metrics_node.add( "port", 9464U );
+        t_metrics_node.add( "interval-ms", 5000U );
+        add( "metrics", t_metrics_node );
 
         param_node t_set_conditions;
         t_set_conditions.add( "10", "hard-abort" );
@@ -99,6 +117,16 @@ namespace sandfly
         an_app.add_config_option< unsigned >( "-n,--n-files", "daq.n-files", "Number of files to be written in parallel" );
         an_app.add_config_option< unsigned >( "-d,--duration", "daq.duration", "Run duration in ms" );
         an_app.add_config_option< double >( "-m,--max-file-size-mb", "daq.max-file-size-mb", "Maximum file size in MB" );
+        an_app.add_config_option< unsigned >( "--n-build-threads", "daq.n-build-threads", "Number of threads used to build the nodes at activation" );
+        an_app.add_config_flag< bool >( "--auto-placement", "daq.auto-placement", "Flag to place the streams on CPUs and NUMA nodes automatically" );
+        an_app.add_config_flag< bool >( "--use-standby", "daq.use-standby", "Flag to prepare the next midge object in the background after deactivation" );
+        an_app.add_config_flag< bool >( "--precise-timing", "daq.precise-timing", "Flag to stop timed runs with sub-millisecond accuracy" );
+        an_app.add_config_option< std::string >( "--run-clock", "daq.run-clock", "Clock used for scheduled run starts and run timestamps (realtime or tai)" );
+        an_app.add_config_option< unsigned >( "--request-workers", "request-workers", "Number of threads that handle read-only requests (0 to handle all requests in the listening thread)" );
+        an_app.add_config_flag< bool >( "--enable-metrics", "metrics.enable", "Flag to start the Prometheus metrics exporter" );
+        an_app.add_config_option< unsigned >( "--metrics-port", "metrics.port", "Port of the metrics exporter's HTTP listener" );
+        an_app.add_config_option< std::string >( "--metrics-mode", "metrics.mode", "How metrics are exported (http or textfile)" );
+        an_app.add_config_option< std::string >( "--metrics-textfile", "metrics.textfile", "Path of the metrics file in textfile mode" );
 
         return;
     }
@@ -31,6 +31,15 @@ namespace sandfly
      - duration
      - use-relayer
      - max-file-size-mb
+     - use-standby
+     - n-build-threads
+     - auto-placement
+     - precise-timing
+     - run-clock
+     - batch-max-concurrent
+     - request-workers
+     - reply-cache (see request_receiver)
+     - metrics (see metrics_exporter)
 
      These default configurations, together with the configurations from the command line and the config-file, are passed to scarab::configurator by the sandfly executable.
      The configurator combines them and extracts the final sandfly configuration which is then passed to the run_server during initialization.
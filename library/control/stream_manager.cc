@@ -10,14 +10,17 @@
 #include "node_builder.hh"
 #include "sandfly_error.hh"
 #include "stream_preset.hh"
+#include "thread_placement.hh"
 
 #include "node.hh"
 
 #include "logger.hh"
 
-#include <boost/algorithm/string/replace.hpp>
-
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <utility>
+#include <vector>
 
 using scarab::param_ptr_t;
 using scarab::param;
@@ -29,26 +32,71 @@ namespace sandfly
 {
     LOGGER( plog, "stream_manager" );
 
+    //************************
+    // active_node_bindings
+    //************************
+
+    active_node_bindings::active_node_bindings( const name_registry& a_names ) :
+            f_names( &a_names ),
+            f_entries()
+    {}
+
+    void active_node_bindings::set( node_id_t a_node_id, node_binding* a_binding, midge::node* a_node )
+    {
+        if( a_node_id == name_registry::s_invalid_id )
+        {
+            throw error() << "Can't add a node binding with an invalid node ID";
+        }
+        if( a_node_id >= f_entries.size() ) f_entries.resize( a_node_id + 1 );
+        f_entries[ a_node_id ].f_binding = a_binding;
+        f_entries[ a_node_id ].f_node = a_node;
+        return;
+    }
+
+    void active_node_bindings::swap( active_node_bindings& a_other )
+    {
+        std::swap( f_names, a_other.f_names );
+        f_entries.swap( a_other.f_entries );
+        return;
+    }
+
+    void active_node_bindings::clear()
+    {
+        f_entries.clear();
+        return;
+    }
+
+    //******************
+    // stream_manager
+    //******************
+
     stream_manager::stream_manager() :
+            f_names(),
             f_streams(),
+            f_change_callbacks(),
+            f_topology(),
+            f_have_topology( false ),
+            f_placement_plan(),
             f_manager_mutex(),
             f_midge(),
-            f_node_bindings(),
+            f_node_bindings( f_names ),
             f_must_reset_midge( true ),
-            f_midge_mutex()
+            f_midge_mutex(),
+            f_standby_midge(),
+            f_standby_node_bindings( f_names ),
+            f_standby_pending( false ),
+            f_standby_return(),
+            f_standby_mutex(),
+            f_n_build_threads( 1 ),
+            f_auto_placement( false )
     {
     }
 
     stream_manager::~stream_manager()
     {
-        for( streams_t::iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
-        {
-            for( stream_template::nodes_t::iterator t_node_it = t_stream_it->second.f_nodes.begin(); t_node_it != t_stream_it->second.f_nodes.end(); ++t_node_it )
-            {
-                delete t_node_it->second;
-                t_node_it->second = nullptr;
-            }
-        }
+        discard_standby();
+
+        delete_builders( f_streams );
 
         clear_node_bindings();
     }
@@ -77,6 +125,10 @@ namespace sandfly
         try
         {
             _add_stream( a_name, a_node );
+
+            // all of the new streams (e.g. the replicas) are placed together
+            std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+            update_placement_plan();
             return true;
         }
         catch( std::exception& e )
@@ -114,6 +166,120 @@ namespace sandfly
         }
     }
 
+    void stream_manager::add_change_callback( const change_callback_t& a_callback )
+    {
+        std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+        f_change_callbacks.push_back( a_callback );
+        return;
+    }
+
+    void stream_manager::templates_changed()
+    {
+        for( std::vector< change_callback_t >::const_iterator t_cb_it = f_change_callbacks.begin(); t_cb_it != f_change_callbacks.end(); ++t_cb_it )
+        {
+            (*t_cb_it)();
+        }
+        return;
+    }
+
+    namespace
+    {
+        // removes the CPUs and NUMA node that automatic placement gave a node, keeping its scheduling
+        void clear_automatic_location( const std::string& a_node_name )
+        {
+            thread_placement t_placement;
+            if( ! placement_registry::global().find( a_node_name, t_placement ) ) return;
+            t_placement.f_cpus.clear();
+            t_placement.f_numa_node = -1;
+            if( t_placement.empty() ) placement_registry::global().remove( a_node_name );
+            else placement_registry::global().set( a_node_name, t_placement );
+            return;
+        }
+    }
+
+    void stream_manager::refresh_topology()
+    {
+        std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+        f_topology = cpu_topology::read();
+        f_have_topology = true;
+        update_placement_plan();
+        return;
+    }
+
+    void stream_manager::update_placement_plan()
+    {
+        if( ! f_auto_placement ) return;
+
+        std::vector< placement_request > t_requests;
+        for( streams_t::const_iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+        {
+            const stream_template& t_stream = t_stream_it->second;
+
+            // sources are the nodes without inputs
+            std::set< std::string > t_sinks;
+            for( stream_template::connections_t::const_iterator t_edge_it = t_stream.f_connections.begin(); t_edge_it != t_stream.f_connections.end(); ++t_edge_it )
+            {
+                t_sinks.insert( t_edge_it->f_sink_node );
+            }
+
+            placement_request t_request;
+            t_request.f_stream = t_stream_it->first;
+            for( stream_template::nodes_t::const_iterator t_node_it = t_stream.f_nodes.begin(); t_node_it != t_stream.f_nodes.end(); ++t_node_it )
+            {
+                if( t_stream.f_placed_nodes.count( t_node_it->first ) != 0 ) continue;
+                t_request.f_nodes.push_back( t_node_it->second->name() );
+                if( t_sinks.count( t_node_it->first ) == 0 ) t_request.f_sources.insert( t_node_it->second->name() );
+            }
+            if( ! t_request.f_nodes.empty() ) t_requests.push_back( t_request );
+        }
+
+        placement_plan t_plan;
+        try
+        {
+            // the topology is read once; refresh_topology() reads it again
+            if( ! f_have_topology )
+            {
+                f_topology = cpu_topology::read();
+                f_have_topology = true;
+            }
+            t_plan = placement_planner( f_topology ).plan( t_requests );
+        }
+        catch( std::exception& e )
+        {
+            LWARN( plog, "Unable to place the streams automatically: " << e.what() );
+            for( placement_plan::nodes_t::const_iterator t_node_it = f_placement_plan.f_nodes.begin(); t_node_it != f_placement_plan.f_nodes.end(); ++t_node_it )
+            {
+                clear_automatic_location( t_node_it->first );
+            }
+            f_placement_plan = placement_plan();
+            return;
+        }
+
+        // nodes that aren't in the new plan don't keep the CPUs they were given automatically
+        for( placement_plan::nodes_t::const_iterator t_node_it = f_placement_plan.f_nodes.begin(); t_node_it != f_placement_plan.f_nodes.end(); ++t_node_it )
+        {
+            if( t_plan.f_nodes.count( t_node_it->first ) == 0 ) clear_automatic_location( t_node_it->first );
+        }
+        f_placement_plan = t_plan;
+
+        for( std::map< std::string, std::string >::const_iterator t_stream_it = f_placement_plan.f_stream_domains.begin(); t_stream_it != f_placement_plan.f_stream_domains.end(); ++t_stream_it )
+        {
+            LINFO( plog, "Stream <" << t_stream_it->first << "> is placed on " << t_stream_it->second );
+        }
+        for( placement_plan::nodes_t::const_iterator t_node_it = f_placement_plan.f_nodes.begin(); t_node_it != f_placement_plan.f_nodes.end(); ++t_node_it )
+        {
+            LINFO( plog, "Node <" << t_node_it->first << "> is placed on CPUs <" << format_cpu_list( t_node_it->second.f_placement.f_cpus ) << ">"
+                    << ( t_node_it->second.f_isolated ? " (isolated source)" : "" ) );
+            // keep any scheduling from the node's config
+            thread_placement t_placement;
+            placement_registry::global().find( t_node_it->first, t_placement );
+            t_placement.f_cpus = t_node_it->second.f_placement.f_cpus;
+            t_placement.f_numa_node = t_node_it->second.f_placement.f_numa_node;
+            placement_registry::global().set( t_node_it->first, t_placement );
+        }
+        return;
+    }
+
     bool stream_manager::dump_node_config( const std::string& a_stream_name, const std::string& a_node_name, param_node& a_config ) const
     {
         try
@@ -144,7 +310,30 @@ namespace sandfly
             throw error() << "Did not find node <" << a_node_name << "> in stream <" << a_stream_name << ">";
         }
 
-        t_node_it->second->configure_builder( a_config );
+        // placement keys go to the placement registry rather than to the node
+        param_node t_config( a_config );
+        // only a location given in this config takes the node out of the automatic placement; the registry entry may hold an automatic one
+        const bool t_sets_location = t_config.has( "cpu-set" ) || t_config.has( "numa-node" );
+        thread_placement t_placement;
+        placement_registry::global().find( t_node_it->second->name(), t_placement );
+        const bool t_has_placement = t_placement.take_from_config( t_config );
+        if( t_has_placement ) t_placement.effective_cpus(); // throws if the placement is impossible
+
+        // the node's config is validated before the placement is recorded, so that a failed configure changes nothing
+        t_node_it->second->configure_builder( t_config );
+
+        if( t_has_placement )
+        {
+            placement_registry::global().set( t_node_it->second->name(), t_placement );
+            if( t_sets_location && t_stream_it->second.f_placed_nodes.insert( a_node_name ).second )
+            {
+                // the node's location is now its own, so replanning mustn't clear it
+                f_placement_plan.f_nodes.erase( t_node_it->second->name() );
+                update_placement_plan();
+            }
+        }
+        t_stream_it->second.f_dirty_nodes.insert( a_node_name );
+        templates_changed();
 
         return;
     }
@@ -172,10 +361,163 @@ namespace sandfly
     }
 
 
+    namespace
+    {
+        // copies a_param, replacing "{index}" in string values with a_index; a value that's only "{index}" becomes an unsigned integer
+        param_ptr_t substitute_index( const param& a_param, unsigned a_index )
+        {
+            static const std::string s_placeholder( "{index}" );
+
+            if( a_param.is_node() )
+            {
+                param_ptr_t t_node( new param_node() );
+                for( param_node::const_iterator t_it = a_param.as_node().begin(); t_it != a_param.as_node().end(); ++t_it )
+                {
+                    t_node->as_node().add( t_it.name(), substitute_index( *t_it, a_index ) );
+                }
+                return t_node;
+            }
+            if( a_param.is_array() )
+            {
+                param_ptr_t t_array( new param_array() );
+                for( param_array::const_iterator t_it = a_param.as_array().begin(); t_it != a_param.as_array().end(); ++t_it )
+                {
+                    t_array->as_array().push_back( substitute_index( *t_it, a_index ) );
+                }
+                return t_array;
+            }
+            if( a_param.is_value() && a_param.as_value().is_string() )
+            {
+                std::string t_string = a_param.as_value().as_string();
+                if( t_string == s_placeholder ) return param_ptr_t( new param_value( a_index ) );
+
+                std::string t_index = std::to_string( a_index );
+                for( std::string::size_type t_pos = t_string.find( s_placeholder ); t_pos != std::string::npos; t_pos = t_string.find( s_placeholder, t_pos + t_index.size() ) )
+                {
+                    t_string.replace( t_pos, s_placeholder.size(), t_index );
+                }
+                return param_ptr_t( new param_value( t_string ) );
+            }
+            return a_param.clone();
+        }
+    }
+
+    void stream_manager::_add_replicas( const std::string& a_name, const param_node& a_node )
+    {
+        if( ! a_node["replicas"].is_value() || a_node["replicas"]().as_uint() == 0 )
+        {
+            throw error() << "Invalid number of replicas for stream <" << a_name << ">: " << a_node["replicas"];
+        }
+        unsigned t_n_replicas = a_node["replicas"]().as_uint();
+
+        const param_array* t_cpu_sets = nullptr;
+        if( a_node.has( "replica-cpu-sets" ) )
+        {
+            if( ! a_node["replica-cpu-sets"].is_array() || a_node["replica-cpu-sets"].as_array().empty() )
+            {
+                throw error() << "\"replica-cpu-sets\" for stream <" << a_name << "> should be a non-empty array";
+            }
+            t_cpu_sets = &a_node["replica-cpu-sets"].as_array();
+        }
+
+        param_node t_template( a_node );
+        t_template.erase( "replicas" );
+        t_template.erase( "replica-cpu-sets" );
+
+        // an inline preset is added once, and the replicas refer to it by type
+        if( t_template.has( "preset" ) && t_template["preset"].is_node() )
+        {
+            if( ! runtime_stream_preset::add_preset( t_template["preset"].as_node() ) )
+            {
+                throw error() << "Runtime preset could not be added";
+            }
+            std::string t_type = t_template["preset"]["type"]().as_string();
+            t_template.replace( "preset", param_value( t_type ) );
+        }
+
+        std::vector< std::string > t_replica_names;
+        for( unsigned t_index = 0; t_index < t_n_replicas; ++t_index )
+        {
+            t_replica_names.push_back( a_name + "_" + std::to_string( t_index ) );
+        }
+        check_new_stream_names( t_replica_names, t_template );
+
+        LINFO( plog, "Adding " << t_n_replicas << " replicas of stream <" << a_name << ">" );
+
+        unsigned t_n_added = 0;
+        try
+        {
+            for( ; t_n_added < t_n_replicas; ++t_n_added )
+            {
+                param_ptr_t t_replica = substitute_index( t_template, t_n_added );
+                if( t_cpu_sets != nullptr ) t_replica->as_node().replace( "cpu-set", (*t_cpu_sets)[ t_n_added % t_cpu_sets->size() ] );
+
+                _add_stream( t_replica_names[ t_n_added ], t_replica->as_node() );
+            }
+        }
+        catch( std::exception& e )
+        {
+            // the replicas are added all together or not at all; they haven't been built, so discarding them doesn't require a reset
+            std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+            for( unsigned t_index = 0; t_index < t_n_added; ++t_index )
+            {
+                streams_t::iterator t_stream_it = f_streams.find( t_replica_names[ t_index ] );
+                if( t_stream_it != f_streams.end() ) discard_stream( t_stream_it );
+            }
+            if( t_n_added != 0 ) templates_changed();
+            throw error() << "Unable to add replica " << t_n_added << " of stream <" << a_name << ">: " << e.what();
+        }
+        return;
+    }
+
+    void stream_manager::check_new_stream_names( const std::vector< std::string >& a_stream_names, const param_node& a_node ) const
+    {
+        if( ! a_node.has( "preset" ) || ! a_node["preset"].is_value() )
+        {
+            throw error() << "No preset specified";
+        }
+        compiled_preset_ptr_t t_preset = stream_preset_registry::get( a_node["preset"]().as_string() );
+        if( ! t_preset )
+        {
+            throw error() << "Unable to find the preset of type <" << a_node["preset"]().as_string() << ">. The type may not be registered or there may be a typo.";
+        }
+
+        std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+        std::set< std::string > t_full_names;
+        for( std::vector< std::string >::const_iterator t_stream_it = a_stream_names.begin(); t_stream_it != a_stream_names.end(); ++t_stream_it )
+        {
+            check_new_stream_name( *t_stream_it, *t_preset, t_full_names );
+        }
+        return;
+    }
+
+    void stream_manager::check_new_stream_name( const std::string& a_stream_name, const compiled_stream_preset& a_preset, std::set< std::string >& a_full_names ) const
+    {
+        if( f_streams.find( a_stream_name ) != f_streams.end() )
+        {
+            throw error() << "Already have a stream called <" << a_stream_name << ">";
+        }
+        for( stream_preset::nodes_t::const_iterator t_node_it = a_preset.f_nodes.begin(); t_node_it != a_preset.f_nodes.end(); ++t_node_it )
+        {
+            // removed streams have released their full names (see discard_stream), so only the nodes of current streams can collide
+            std::string t_full_name = name_registry::make_full_node_name( a_stream_name, t_node_it->first );
+            if( f_names.find_node( t_full_name ) != name_registry::s_invalid_id || ! a_full_names.insert( t_full_name ).second )
+            {
+                throw error() << "Node <" << t_node_it->first << "> of stream <" << a_stream_name << "> would have the same full name as another node: <" << t_full_name << ">";
+            }
+        }
+        return;
+    }
+
     void stream_manager::_add_stream( const std::string& a_name, const param_node& a_node )
     {
         // do not need to lock the mutex here because we're not doing anything to the stream_manager until inside _add_stream( string, param_node )
 
+        if( a_node.has( "replicas" ) )
+        {
+            return _add_replicas( a_name, a_node );
+        }
+
         try
         {
             if( ! a_node.has( "preset" ) )
@@ -214,38 +556,48 @@ namespace sandfly
     {
         // do not need to lock the mutex here because we're not doing anything to the stream_manager until later
 
-        stream_preset* t_preset = scarab::factory< stream_preset, const std::string& >::get_instance()->create( a_type, a_type );
+        compiled_preset_ptr_t t_preset = stream_preset_registry::get( a_type );
 
-        if( t_preset == nullptr )
+        if( ! t_preset )
         {
             throw error() << "Unable to create preset called <" << a_name << "> of type <" << a_type << ">. The type may not be registered or there may be a typo.";
         }
 
-        // lock the mutex here so that we know which stream name this will be if it succeeds
-        std::unique_lock< std::mutex > t_lock( f_manager_mutex );
-
-        if( f_streams.find( a_name ) != f_streams.end() )
+        thread_placement t_stream_placement;
+        try
         {
-            throw error() << "Already have a stream called <" << a_name << ">";
+            param_node t_placement_config;
+            const std::vector< std::string >& t_keys = thread_placement::config_keys();
+            for( std::vector< std::string >::const_iterator t_key_it = t_keys.begin(); t_key_it != t_keys.end(); ++t_key_it )
+            {
+                if( a_node.has( *t_key_it ) ) t_placement_config.add( *t_key_it, a_node[*t_key_it] );
+            }
+            t_stream_placement.take_from_config( t_placement_config );
+        }
+        catch( error& e )
+        {
+            throw error() << "Invalid placement for stream <" << a_name << ">: " << e.what();
         }
 
         LINFO( plog, "Preparing stream <" << a_name << ">");
 
-        stream_template t_stream;
-
+        // the preset's connections were validated when it was compiled
         typedef stream_preset::nodes_t preset_nodes_t;
-        const preset_nodes_t& t_new_nodes = t_preset->get_nodes();
-        std::map< std::string, std::string > t_name_replacements;
+        const preset_nodes_t& t_new_nodes = t_preset->f_nodes;
+
+        // the builders are made and their configs validated before anything is registered, so a bad config leaves no trace;
+        // they're owned here until the stream is committed
+        typedef std::map< std::string, std::unique_ptr< node_builder > > new_builders_t;
+        new_builders_t t_builders;
+        std::map< std::string, thread_placement > t_placements;
+        std::set< std::string > t_placed_nodes;
         for( preset_nodes_t::const_iterator t_node_it = t_new_nodes.begin(); t_node_it != t_new_nodes.end(); ++t_node_it )
         {
-            std::stringstream t_nn_str;
-            t_nn_str << a_name << "_" << t_node_it->first;
-            std::string t_node_name = t_nn_str.str();
-            t_name_replacements[ t_node_it->first ] = t_node_name;
+            const std::string t_node_name = name_registry::make_full_node_name( a_name, t_node_it->first );
 
             LDEBUG( plog, "Creating node of type <" << t_node_it->second << "> called <" << t_node_name << ">" );
-            node_builder* t_builder = scarab::factory< node_builder >::get_instance()->create( t_node_it->second );
-            if( t_builder == nullptr )
+            std::unique_ptr< node_builder > t_builder( scarab::factory< node_builder >::get_instance()->create( t_node_it->second ) );
+            if( ! t_builder )
             {
                 throw error() << "Cannot find binding for node type <" << t_node_it->second << ">";
             }
@@ -258,28 +610,68 @@ namespace sandfly
             if( a_node.has( t_node_it->first ) ) t_node_config.merge( a_node[t_node_it->first].as_node() );
             // add stream-wide config data to the node config
             if( a_node.has( "device" ) ) t_node_config.add( "device", a_node["device"].as_node() );
+            // the node's placement is the stream's, overridden by any placement keys in the node config
+            thread_placement t_placement( t_stream_placement );
+            try
+            {
+                t_placement.take_from_config( t_node_config );
+                t_placement.effective_cpus(); // throws if the placement is impossible
+            }
+            catch( error& e )
+            {
+                throw error() << "Invalid placement for node <" << t_node_name << ">: " << e.what();
+            }
+            if( ! t_placement.empty() )
+            {
+                t_placements[ t_node_name ] = t_placement;
+                if( t_placement.has_location() ) t_placed_nodes.insert( t_node_it->first );
+            }
             // pass the configuration to the builder
             t_builder->configure_builder( t_node_config );
 
-            t_stream.f_nodes.insert( stream_template::nodes_t::value_type( t_node_it->first, t_builder ) );
+            t_builders[ t_node_it->first ] = std::move( t_builder );
         }
 
-        typedef stream_preset::connections_t preset_conn_t;
-        const preset_conn_t& t_new_connections = t_preset->get_connections();
-        for( preset_conn_t::const_iterator t_conn_it = t_new_connections.begin(); t_conn_it != t_new_connections.end(); ++t_conn_it )
+        // lock the mutex here so that we know which stream name this will be if it succeeds
+        std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+
+        std::set< std::string > t_full_names;
+        check_new_stream_name( a_name, *t_preset, t_full_names );
+
+        // nothing below can fail, so the names can be interned and the builders handed over to the stream
+        stream_template t_stream;
+        t_stream.f_id = f_names.intern_stream( a_name );
+        t_stream.f_placed_nodes = t_placed_nodes;
+
+        std::map< std::string, std::string > t_name_replacements;
+        for( new_builders_t::iterator t_builder_it = t_builders.begin(); t_builder_it != t_builders.end(); ++t_builder_it )
         {
-            std::string t_connection( *t_conn_it );
-            for( std::map< std::string, std::string >::const_iterator t_it = t_name_replacements.begin(); t_it != t_name_replacements.end(); ++t_it )
-            {
-                boost::replace_all( t_connection, t_it->first, t_it->second );
-            }
-            LDEBUG( plog, "Adding connection: " << t_connection );
-            t_stream.f_connections.insert( t_connection );
+            node_id_t t_node_id = f_names.intern_node( t_stream.f_id, t_builder_it->first );
+            t_builder_it->second->set_node_id( t_node_id );
+            t_name_replacements[ t_builder_it->first ] = t_builder_it->second->name();
+            t_stream.f_nodes.insert( stream_template::nodes_t::value_type( t_builder_it->first, t_builder_it->second.release() ) );
         }
 
-        // add the new stream to the vector of streams
-        f_must_reset_midge = true;
+        // the join strings use the nodes' full names
+        t_stream.f_connections = t_preset->f_connections.edges();
+        for( connection_graph::edges_t::iterator t_edge_it = t_stream.f_connections.begin(); t_edge_it != t_stream.f_connections.end(); ++t_edge_it )
+        {
+            t_edge_it->f_join_string = t_name_replacements[ t_edge_it->f_source_node ] + "." + t_edge_it->f_source_port + ":"
+                    + t_name_replacements[ t_edge_it->f_sink_node ] + "." + t_edge_it->f_sink_port;
+            LDEBUG( plog, "Adding connection: " << t_edge_it->f_join_string );
+        }
+
+        for( std::map< std::string, thread_placement >::const_iterator t_placement_it = t_placements.begin(); t_placement_it != t_placements.end(); ++t_placement_it )
+        {
+            LDEBUG( plog, "Node <" << t_placement_it->first << "> will run on CPUs <" << format_cpu_list( t_placement_it->second.effective_cpus() )
+                    << ">, with preferred NUMA node " << t_placement_it->second.f_numa_node << " and scheduling policy " << sched_policy_to_string( t_placement_it->second.f_policy ) );
+            placement_registry::global().set( t_placement_it->first, t_placement_it->second );
+        }
+
+        // add the new stream to the vector of streams; it will be built into midge at the next reset
+        t_stream.f_needs_build = true;
         f_streams.insert( streams_t::value_type( a_name, t_stream ) );
+        templates_changed();
         LDEBUG( plog, "Added stream <" << a_name << ">" );
         return;
     }
@@ -295,16 +687,28 @@ namespace sandfly
             throw error() << "Stream <" << a_name << "> does not exist";
         }
 
+        // nodes can't be removed from midge, so the whole thing has to be rebuilt
         f_must_reset_midge = true;
+        templates_changed();
 
-        for( stream_template::nodes_t::iterator t_node_it = t_to_erase->second.f_nodes.begin(); t_node_it != t_to_erase->second.f_nodes.end(); ++t_node_it )
+        discard_stream( t_to_erase );
+        update_placement_plan();
+
+        return;
+    }
+
+    void stream_manager::discard_stream( streams_t::iterator a_stream_it )
+    {
+        for( stream_template::nodes_t::iterator t_node_it = a_stream_it->second.f_nodes.begin(); t_node_it != a_stream_it->second.f_nodes.end(); ++t_node_it )
         {
+            placement_registry::global().remove( t_node_it->second->name() );
             delete t_node_it->second;
             t_node_it->second = nullptr;
         }
 
-        f_streams.erase( t_to_erase );
-
+        // the IDs stay valid, but the nodes' full names can now be used by other streams
+        if( a_stream_it->second.f_id != name_registry::s_invalid_id ) f_names.release_stream( a_stream_it->second.f_id );
+        f_streams.erase( a_stream_it );
         return;
     }
 
@@ -319,59 +723,239 @@ namespace sandfly
             throw error() << "No streams have been setup";
         }
 
+        std::unique_lock< std::mutex > t_midge_lock( f_midge_mutex );
+
+        if( f_standby_pending )
+        {
+            // the streams that changed since the snapshot was taken are built or reconfigured below
+            f_standby_pending = false;
+            if( f_must_reset_midge )
+            {
+                // a stream was removed since the snapshot was taken
+                std::unique_lock< std::mutex > t_sb_lock( f_standby_mutex );
+                drop_standby();
+            }
+            else if( swap_in_standby() )
+            {
+                LINFO( plog, "Using the standby midge object" );
+            }
+            else
+            {
+                // the streams in the snapshot are no longer marked as needing to be built
+                f_must_reset_midge = true;
+            }
+        }
+
+        if( f_must_reset_midge || ! f_midge )
+        {
+            LDEBUG( plog, "Starting from a new midge object; all streams will be built" );
+            f_midge.reset( new midge::diptera() );
+            clear_node_bindings();
+            for( streams_t::iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+            {
+                t_stream_it->second.f_needs_build = true;
+                t_stream_it->second.f_dirty_nodes.clear();
+            }
+        }
+
+        // if anything fails from here on, the state of the midge object is unknown, and it will have to be rebuilt from scratch
         f_must_reset_midge = true;
 
-        std::unique_lock< std::mutex > t_midge_lock( f_midge_mutex );
-        f_midge.reset( new midge::diptera() );
-        clear_node_bindings();
+        std::vector< const stream_template* > t_to_build;
+        for( streams_t::iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+        {
+            if( t_stream_it->second.f_needs_build )
+            {
+                LDEBUG( plog, "Stream <" << t_stream_it->first << "> will be built" );
+                t_to_build.push_back( &t_stream_it->second );
+            }
+            else if( ! t_stream_it->second.f_dirty_nodes.empty() )
+            {
+                LDEBUG( plog, "Reconfiguring " << t_stream_it->second.f_dirty_nodes.size() << " node(s) in stream <" << t_stream_it->first << ">" );
+                reconfigure_dirty_nodes( t_stream_it->second );
+            }
+            else
+            {
+                LDEBUG( plog, "Reusing the nodes and connections of stream <" << t_stream_it->first << ">" );
+            }
+        }
 
-        for( streams_t::const_iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+        build_streams( t_to_build, *f_midge, f_node_bindings );
+        for( streams_t::iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
         {
-            for( stream_template::nodes_t::const_iterator t_node_it = t_stream_it->second.f_nodes.begin(); t_node_it != t_stream_it->second.f_nodes.end(); ++t_node_it )
+            t_stream_it->second.f_needs_build = false;
+            t_stream_it->second.f_dirty_nodes.clear();
+        }
+
+        f_must_reset_midge = false;
+        return;
+    }
+
+    void stream_manager::build_streams( const std::vector< const stream_template* >& a_streams, midge::diptera& a_midge, active_node_bindings& a_bindings )
+    {
+        // Constructing and configuring the nodes is independent for each node, so that is spread over the worker threads.
+        // Adding the nodes to midge and joining them is done serially afterwards.
+        std::vector< node_builder* > t_builders;
+        for( std::vector< const stream_template* >::const_iterator t_stream_it = a_streams.begin(); t_stream_it != a_streams.end(); ++t_stream_it )
+        {
+            for( stream_template::nodes_t::const_iterator t_node_it = (*t_stream_it)->f_nodes.begin(); t_node_it != (*t_stream_it)->f_nodes.end(); ++t_node_it )
             {
-                midge::node* t_new_node = t_node_it->second->build();
+                t_builders.push_back( t_node_it->second );
+            }
+        }
 
+        std::vector< midge::node* > t_new_nodes( t_builders.size(), nullptr );
+        std::vector< std::exception_ptr > t_build_errors( t_builders.size() );
+        std::atomic< unsigned > t_next_node( 0 );
+        auto t_build_worker = [&]() {
+            for( unsigned t_index = t_next_node++; t_index < t_builders.size(); t_index = t_next_node++ )
+            {
                 try
                 {
-                    LINFO( plog, "Adding node <" << t_node_it->first << ">" );
-                    f_midge->add( t_new_node );
-
-                    node_binding* t_new_binding = t_node_it->second->binding().clone();
-                    LDEBUG( plog, "Adding new node binding for node <" << t_node_it->second->name() << ">");
-                    f_node_bindings[ t_node_it->second->name() ] = std::make_pair( t_new_binding, t_new_node );
+                    // nodes are built on their own CPUs and NUMA node so that memory allocated and touched in their constructors is local
+                    thread_placement t_placement;
+                    placement_registry::global().find( t_builders[ t_index ]->name(), t_placement );
+                    placement_guard t_guard( t_placement );
+                    t_new_nodes[ t_index ] = t_builders[ t_index ]->build();
                 }
-                catch( std::exception& e )
+                catch( ... )
+                {
+                    t_build_errors[ t_index ] = std::current_exception();
+                }
+            }
+        };
+
+        unsigned t_n_threads = std::max( 1U, std::min< unsigned >( f_n_build_threads, t_builders.size() ) );
+        LDEBUG( plog, "Building " << t_builders.size() << " node(s) with " << t_n_threads << " thread(s)" );
+        std::vector< std::future< void > > t_workers;
+        for( unsigned t_thread = 1; t_thread < t_n_threads; ++t_thread )
+        {
+            t_workers.push_back( std::async( std::launch::async, t_build_worker ) );
+        }
+        t_build_worker();
+        for( std::vector< std::future< void > >::iterator t_worker_it = t_workers.begin(); t_worker_it != t_workers.end(); ++t_worker_it )
+        {
+            t_worker_it->wait();
+        }
+
+        for( unsigned t_index = 0; t_index < t_builders.size(); ++t_index )
+        {
+            if( ! t_build_errors[ t_index ] ) continue;
+
+            for( std::vector< midge::node* >::iterator t_node_it = t_new_nodes.begin(); t_node_it != t_new_nodes.end(); ++t_node_it )
+            {
+                delete *t_node_it;
+            }
+            try
+            {
+                std::rethrow_exception( t_build_errors[ t_index ] );
+            }
+            catch( std::exception& e )
+            {
+                throw error() << "Unable to build node <" << t_builders[ t_index ]->name() << ">: " << e.what();
+            }
+        }
+
+        // on failure, only the bindings added here are removed; bindings of streams that were reused are left alone
+        auto t_remove_new_bindings = [&]( unsigned a_n_added ) {
+            for( unsigned t_index = 0; t_index < a_n_added; ++t_index )
+            {
+                active_node_bindings::entry* t_entry = a_bindings.find( t_builders[ t_index ]->get_node_id() );
+                if( t_entry == nullptr ) continue;
+                delete t_entry->f_binding;
+                a_bindings.set( t_builders[ t_index ]->get_node_id(), nullptr, nullptr );
+            }
+        };
+
+        for( unsigned t_index = 0; t_index < t_builders.size(); ++t_index )
+        {
+            try
+            {
+                LINFO( plog, "Adding node <" << t_builders[ t_index ]->name() << ">" );
+                a_midge.add( t_new_nodes[ t_index ] );
+
+                node_binding* t_new_binding = t_builders[ t_index ]->binding().clone();
+                LDEBUG( plog, "Adding new node binding for node <" << t_builders[ t_index ]->name() << ">");
+                a_bindings.set( t_builders[ t_index ]->get_node_id(), t_new_binding, t_new_nodes[ t_index ] );
+            }
+            catch( std::exception& e )
+            {
+                t_remove_new_bindings( t_index );
+                // nodes that were already added are owned by midge
+                for( unsigned t_remaining = t_index; t_remaining < t_new_nodes.size(); ++t_remaining )
                 {
-                    clear_node_bindings();
-                    delete t_new_node;
-                    throw error() << "Unable to add processor <" << t_node_it->first << ">: " << e.what();
+                    delete t_new_nodes[ t_remaining ];
                 }
+                throw error() << "Unable to add processor <" << t_builders[ t_index ]->name() << ">: " << e.what();
             }
+        }
 
-            // Then deal with connections
-            for( stream_template::connections_t::const_iterator t_conn_it = t_stream_it->second.f_connections.begin(); t_conn_it != t_stream_it->second.f_connections.end(); ++t_conn_it )
+        // Then deal with connections
+        for( std::vector< const stream_template* >::const_iterator t_stream_it = a_streams.begin(); t_stream_it != a_streams.end(); ++t_stream_it )
+        {
+            for( stream_template::connections_t::const_iterator t_conn_it = (*t_stream_it)->f_connections.begin(); t_conn_it != (*t_stream_it)->f_connections.end(); ++t_conn_it )
             {
                 try
                 {
-                    LINFO( plog, "Adding connection <" << *t_conn_it << ">" );
-                    f_midge->join( *t_conn_it );
+                    LINFO( plog, "Adding connection <" << t_conn_it->f_join_string << ">" );
+                    a_midge.join( t_conn_it->f_join_string );
                 }
                 catch( std::exception& e )
                 {
+                    t_remove_new_bindings( t_builders.size() );
                     throw error() << "Unable to join nodes: " << e.what();
                 }
 
-                LINFO( plog, "Node connection made:  <" << *t_conn_it << ">" );
+                LINFO( plog, "Node connection made:  <" << t_conn_it->f_join_string << ">" );
             }
         }
 
-        f_must_reset_midge = false;
         return;
     }
 
+    void stream_manager::reconfigure_dirty_nodes( stream_template& a_stream )
+    {
+        for( std::set< std::string >::const_iterator t_dirty_it = a_stream.f_dirty_nodes.begin(); t_dirty_it != a_stream.f_dirty_nodes.end(); ++t_dirty_it )
+        {
+            stream_template::nodes_t::iterator t_node_it = a_stream.f_nodes.find( *t_dirty_it );
+            if( t_node_it == a_stream.f_nodes.end() )
+            {
+                throw error() << "Did not find dirty node <" << *t_dirty_it << ">";
+            }
+
+            active_node_bindings::entry* t_binding = f_node_bindings.find( t_node_it->second->get_node_id() );
+            if( t_binding == nullptr )
+            {
+                throw error() << "Node <" << t_node_it->second->name() << "> is not present in midge";
+            }
+
+            // the builder's config already includes the node defaults (or the schema's defaults), so applying it gives the same result as building a fresh node
+            try
+            {
+                LINFO( plog, "Reconfiguring node <" << t_node_it->second->name() << ">" );
+                t_node_it->second->apply_builder_config( t_binding->f_node );
+            }
+            catch( std::exception& e )
+            {
+                throw error() << "Unable to reconfigure node <" << t_node_it->second->name() << ">: " << e.what();
+            }
+        }
+        a_stream.f_dirty_nodes.clear();
+        return;
+    }
+
+    bool stream_manager::has_dirty_streams() const
+    {
+        for( streams_t::const_iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+        {
+            if( t_stream_it->second.f_needs_build || ! t_stream_it->second.f_dirty_nodes.empty() ) return true;
+        }
+        return false;
+    }
+
     midge_package stream_manager::get_midge()
     {
-        if( f_must_reset_midge )
+        if( must_reset_midge() )
         {
             reset_midge();
         }
@@ -382,7 +966,22 @@ namespace sandfly
     {
         midge_package t_returned( std::move( a_midge ) );
         t_returned.unlock();
-        f_must_reset_midge = true;
+
+        // A full rebuild is unavoidable here, not just a rebuild of the streams that changed: midge::diptera::run() takes every node
+        // through initialize, execute, and finalize, and neither diptera nor the nodes can be reset to run again.
+        // Every node of the returned object is spent, whether or not it was configured, so none of them can be reused.
+        // The returned object is therefore released now (freeing the nodes' buffers and devices), and every stream is marked as needing
+        // to be built, which is what makes must_reset_midge() true.  The per-stream tracking still pays off for a standby
+        // (see prepare_standby), which is built from every stream and then only needs the streams changed since its snapshot.
+        std::unique_lock< std::mutex > t_mgr_lock( f_manager_mutex );
+        std::unique_lock< std::mutex > t_midge_lock( f_midge_mutex );
+        f_midge.reset();
+        clear_node_bindings();
+        for( streams_t::iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+        {
+            t_stream_it->second.f_needs_build = true;
+            t_stream_it->second.f_dirty_nodes.clear();
+        }
         return;
     }
 
@@ -394,15 +993,30 @@ namespace sandfly
         for( streams_t::const_iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
         {
             stream_template::nodes_t::const_iterator t_node_it = t_stream_it->second.f_nodes.begin();
-            t_run_str = t_stream_it->first + "_" + t_node_it->first;
+            t_run_str = t_node_it->second->name();
             for( ++t_node_it; t_node_it != t_stream_it->second.f_nodes.end(); ++t_node_it )
             {
-                t_run_str += midge::diptera::separator() + t_stream_it->first + "_" + t_node_it->first;
+                t_run_str += midge::diptera::separator() + t_node_it->second->name();
             }
         }
         return t_run_str;
     }
 
+    bool stream_manager::split_node_name( const std::string& a_full_name, std::string& a_stream_name, std::string& a_node_name ) const
+    {
+        // the registry keeps the names of removed streams, so check that the stream and node still exist
+        node_id_t t_node_id = f_names.find_node( a_full_name );
+        if( t_node_id == name_registry::s_invalid_id ) return false;
+
+        std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+        streams_t::const_iterator t_stream_it = f_streams.find( f_names.stream_name( f_names.node_stream( t_node_id ) ) );
+        if( t_stream_it == f_streams.end() || t_stream_it->second.f_nodes.count( f_names.node_name( t_node_id ) ) == 0 ) return false;
+
+        a_stream_name = t_stream_it->first;
+        a_node_name = f_names.node_name( t_node_id );
+        return true;
+    }
+
     bool stream_manager::is_in_use() const
     {
         LERROR( plog, "Checking if manager mutex is in use" );
@@ -417,12 +1031,164 @@ namespace sandfly
     void stream_manager::clear_node_bindings()
     {
         LDEBUG( plog, "Clearing node bindings" );
-        for( active_node_bindings::iterator t_it = f_node_bindings.begin(); t_it != f_node_bindings.end(); ++t_it )
+        delete_bindings( f_node_bindings );
+        return;
+    }
+
+    void stream_manager::delete_bindings( active_node_bindings& a_bindings )
+    {
+        for( active_node_bindings::entries_t::iterator t_it = a_bindings.entries().begin(); t_it != a_bindings.entries().end(); ++t_it )
+        {
+            delete t_it->f_binding;
+            t_it->f_binding = nullptr;
+        }
+        a_bindings.clear();
+        return;
+    }
+
+    void stream_manager::delete_builders( streams_t& a_streams )
+    {
+        for( streams_t::iterator t_stream_it = a_streams.begin(); t_stream_it != a_streams.end(); ++t_stream_it )
+        {
+            for( stream_template::nodes_t::iterator t_node_it = t_stream_it->second.f_nodes.begin(); t_node_it != t_stream_it->second.f_nodes.end(); ++t_node_it )
+            {
+                delete t_node_it->second;
+                t_node_it->second = nullptr;
+            }
+        }
+        return;
+    }
+
+    void stream_manager::prepare_standby()
+    {
+        // take the snapshot here so that the background thread never needs the manager mutex;
+        // reset_midge() holds the manager mutex while it waits for the standby to finish
+        std::shared_ptr< streams_t > t_snapshot = std::make_shared< streams_t >();
+        {
+            std::unique_lock< std::mutex > t_mgr_lock( f_manager_mutex );
+            if( f_streams.empty() )
+            {
+                LDEBUG( plog, "No streams; a standby midge object will not be prepared" );
+                return;
+            }
+            for( streams_t::const_iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+            {
+                stream_template& t_copy = (*t_snapshot)[ t_stream_it->first ];
+                t_copy.f_id = t_stream_it->second.f_id;
+                t_copy.f_device_config = t_stream_it->second.f_device_config;
+                t_copy.f_connections = t_stream_it->second.f_connections;
+                for( stream_template::nodes_t::const_iterator t_node_it = t_stream_it->second.f_nodes.begin(); t_node_it != t_stream_it->second.f_nodes.end(); ++t_node_it )
+                {
+                    t_copy.f_nodes[ t_node_it->first ] = static_cast< node_builder* >( t_node_it->second->clone() );
+                }
+            }
+
+            std::unique_lock< std::mutex > t_sb_lock( f_standby_mutex );
+            if( f_standby_return.valid() ) LDEBUG( plog, "Replacing the previous standby midge object" );
+            drop_standby();
+
+            // from here on, changes are tracked relative to the standby, which has every stream
+            for( streams_t::iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+            {
+                t_stream_it->second.f_needs_build = false;
+                t_stream_it->second.f_dirty_nodes.clear();
+            }
+            f_must_reset_midge = false;
+            f_standby_pending = true;
+
+            LDEBUG( plog, "Building a standby midge object in the background" );
+            f_standby_return = std::async( std::launch::async, &stream_manager::build_standby, this, t_snapshot );
+        }
+        return;
+    }
+
+    void stream_manager::build_standby( std::shared_ptr< streams_t > a_snapshot )
+    {
+        // the standby members are only read after f_standby_return has been waited on, so they don't need to be locked here
+        midge_ptr_t t_midge( new midge::diptera() );
+        active_node_bindings t_bindings( f_names );
+        try
+        {
+            std::vector< const stream_template* > t_to_build;
+            for( streams_t::const_iterator t_stream_it = a_snapshot->begin(); t_stream_it != a_snapshot->end(); ++t_stream_it )
+            {
+                t_to_build.push_back( &t_stream_it->second );
+            }
+            build_streams( t_to_build, *t_midge, t_bindings );
+        }
+        catch( std::exception& e )
+        {
+            LWARN( plog, "Unable to build the standby midge object: " << e.what() );
+            delete_bindings( t_bindings );
+            delete_builders( *a_snapshot );
+            throw;
+        }
+        delete_builders( *a_snapshot );
+
+        f_standby_midge = t_midge;
+        f_standby_node_bindings.swap( t_bindings );
+        LINFO( plog, "Standby midge object is ready" );
+        return;
+    }
+
+    bool stream_manager::swap_in_standby()
+    {
+        std::unique_lock< std::mutex > t_sb_lock( f_standby_mutex );
+        if( ! f_standby_return.valid() ) return false;
+
+        try
         {
-            delete t_it->second.first;
-            t_it->second.first = nullptr;
+            // if the standby is still being built, it's faster to wait for it than to start over
+            f_standby_return.get();
+        }
+        catch( std::exception& e )
+        {
+            LWARN( plog, "Standby midge object is not available: " << e.what() );
+            f_standby_midge.reset();
+            delete_bindings( f_standby_node_bindings );
+            return false;
+        }
+
+        clear_node_bindings();
+        f_midge = f_standby_midge;
+        f_standby_midge.reset();
+        f_node_bindings.swap( f_standby_node_bindings );
+        f_must_reset_midge = false;
+        return true;
+    }
+
+    void stream_manager::discard_standby()
+    {
+        std::unique_lock< std::mutex > t_mgr_lock( f_manager_mutex );
+        if( ! f_standby_pending ) return;
+
+        std::unique_lock< std::mutex > t_sb_lock( f_standby_mutex );
+        drop_standby();
+        f_standby_pending = false;
+        // the streams in the snapshot have to be built again
+        for( streams_t::iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
+        {
+            t_stream_it->second.f_needs_build = true;
+            t_stream_it->second.f_dirty_nodes.clear();
         }
-        f_node_bindings.clear();
+        return;
+    }
+
+    void stream_manager::drop_standby()
+    {
+        if( f_standby_return.valid() )
+        {
+            try
+            {
+                f_standby_return.get();
+            }
+            catch( std::exception& e )
+            {
+                LDEBUG( plog, "Standby build had failed: " << e.what() );
+            }
+        }
+        f_standby_midge.reset();
+        delete_bindings( f_standby_node_bindings );
         return;
     }
 
@@ -578,6 +1344,12 @@ namespace sandfly
             try
             {
                 _dump_node_config( t_target_stream, t_target_node, t_payload );
+
+                param_node t_placement;
+                if( placement_registry::global().report( f_names.full_node_name( f_names.find_node( t_target_stream, t_target_node ) ), t_placement ) )
+                {
+                    t_payload.add( "placement", t_placement );
+                }
             }
             catch( std::exception& e )
             {
@@ -624,6 +1396,7 @@ namespace sandfly
         param_node& t_payload = t_payload_ptr->as_node();
         try
         {
+            std::unique_lock< std::mutex > t_lock( f_manager_mutex );
             for ( streams_t::iterator t_stream_it = f_streams.begin(); t_stream_it != f_streams.end(); ++t_stream_it )
             {
                 t_streams_list.push_back( param_value( t_stream_it->first ) );
@@ -638,6 +1411,30 @@ namespace sandfly
         return a_request->reply( dripline::dl_success(), "Performed get-stream-list", std::move( t_payload_ptr ) );
     }
 
+    dripline::reply_ptr_t stream_manager::handle_get_placement_plan_request( const dripline::request_ptr_t a_request )
+    {
+        param_ptr_t t_payload_ptr( new param_node() );
+        param_node& t_payload = t_payload_ptr->as_node();
+        try
+        {
+            std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+            t_payload.add( "auto-placement", f_auto_placement );
+            if( f_auto_placement )
+            {
+                param_node t_topology;
+                f_topology.to_param( t_topology );
+                t_payload.add( "topology", t_topology );
+                f_placement_plan.to_param( t_payload );
+            }
+        }
+        catch( std::exception& e )
+        {
+            return a_request->reply( dripline::dl_service_error(), std::string("Unable to perform get-placement-plan request: ") + e.what() );
+        }
+        LDEBUG( plog, "Get-placement-plan was successful" );
+        return a_request->reply( dripline::dl_success(), "Performed get-placement-plan", std::move( t_payload_ptr ) );
+    }
+
     dripline::reply_ptr_t stream_manager::handle_get_stream_node_list_request( const dripline::request_ptr_t a_request )
     {
         if( a_request->parsed_specifier().size() < 1 )
@@ -648,6 +1445,8 @@ namespace sandfly
         std::string t_target_stream = a_request->parsed_specifier().front();
         a_request->parsed_specifier().pop_front();
 
+        std::unique_lock< std::mutex > t_lock( f_manager_mutex );
+
         if( !f_streams.count( t_target_stream ) )
         {
             return a_request->reply( dripline::dl_service_error_invalid_key(), "Specifier is improperly formatted: node-list.[stream]" );
@@ -8,7 +8,10 @@
 #ifndef SANDFLY_STREAM_MANAGER_HH_
 #define SANDFLY_STREAM_MANAGER_HH_
 
+#include "connection_graph.hh"
 #include "locked_resource.hh"
+#include "name_registry.hh"
+#include "placement_planner.hh"
 
 #include "diptera.hh"
 
@@ -16,12 +19,18 @@
 
 #include "param.hh"
 
+#include <functional>
 #include <map>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <vector>
 
 namespace sandfly
 {
+    struct compiled_stream_preset;
+
 /*!
      @class stream_manager
      @author N. S. Oblath
@@ -38,13 +47,103 @@ namespace sandfly
      The node binding classes allow access to the nodes held and owned by midge.
      Via the node binding classes some node configurations can be changed while the daq is activated.
      When the daq is de- or re-activated these settings are lost, as stream_manager makes a fresh copy of every node with the original/global configurations.
+
+     Streams are made from compiled presets (see stream_preset_registry), whose connections were parsed and validated once;
+     the midge join strings are made when the stream is added, so building a stream only replays them.
+
+     Stream configs can have these options in addition to the preset and the node configs:
+     - "replicas" (unsigned): the stream is added that many times, as [name]_0 to [name]_[N-1]; in each replica's config,
+       "{index}" in string values is replaced by the replica's index (a value of just "{index}" becomes a number),
+       e.g. device: { channel: "{index}" }; if one replica can't be added, none of them are
+     - "replica-cpu-sets" (array): CPU lists assigned to the replicas in turn, as their "cpu-set"
+     - "cpu-set" (string): CPU list (e.g. "0-3,8") that the stream's node threads are restricted to (see placement_registry)
+     - "numa-node" (unsigned): NUMA node preferred for the memory of the stream's nodes (see thread_placement)
+     - "sched-policy", "sched-priority", and "nice": scheduling of the stream's node threads (see thread_placement)
+     The placement keys can also be given in a node's config (and with configure_node), overriding the stream's values for that node.
+     Nodes are built on their placement (see placement_guard), and the node-config get request reports the placement under "placement".
+
+     Automatic placement (auto_placement, set before the streams are added): whenever streams are added or removed,
+     the streams are placed with placement_planner; nodes with a cpu-set or numa-node from their config are left alone.
+     The CPU topology is read the first time the streams are placed, and again only on refresh_topology().
+     The plan is logged, and the placement-plan get request returns it along with the topology it was based on.
+
+     Changes to the stream templates are tracked per stream:
+     - add_stream marks the new stream as needing to be built;
+     - configure_node marks the configured node as dirty within its stream;
+     - remove_stream requires a full reset, because nodes cannot be removed from a midge object;
+     - return_midge marks every stream as needing to be built: a midge object and its nodes can't be run again,
+       so none of the returned nodes can be reused, changed or not; the returned object is released right away.
+     As long as the current midge object has not been run, reset_midge only builds the streams that need it and
+     re-applies the builder configuration to the dirty nodes; the node instances and connections of unchanged streams are reused.
+     This is how a standby midge object (see below) is brought up to date.
+
+     Stream and node names are interned in a name_registry (names()) when a stream is added;
+     the node bindings are indexed by node ID, and node builders carry their node's ID.
+
+     Callbacks added with add_change_callback() are called whenever the stream templates change (add_stream, remove_stream, configure_node).
+     They're called with the manager mutex locked, so they must not call back into the stream_manager.
+
+     Nodes are constructed and configured by n_build_threads worker threads; they are then added to midge and joined serially.
+
+     Standby mode: prepare_standby takes a snapshot of the stream templates and builds a complete midge object
+     (nodes, connections, and node bindings) from it in a background thread; from then on, changes are tracked relative to the snapshot.
+     The next reset_midge swaps the standby in, and then builds the streams added and reconfigures the nodes configured since the snapshot;
+     a stream removed since the snapshot means the standby is discarded and everything is built again.
+     Resource cost: the standby is a second full set of nodes, with the buffers and devices they acquire when they're constructed and configured,
+     held from prepare_standby until the next reset_midge or discard_standby.  run_control prepares it after the previous midge object
+     has been returned (and released), so the two sets never exist at the same time and nothing is doubled while data is being taken;
+     what's left is the cost of holding the standby's resources while the DAQ is deactivated.
      */
     class stream_manager;
     typedef locked_resource< midge::diptera, stream_manager > midge_package;
 
     class node_binding;
-    // the node_binding is owned by this map; the node is not
-    typedef std::map< std::string, std::pair< node_binding*, midge::node* > > active_node_bindings;
+
+    /*!
+     @class active_node_bindings
+
+     @brief The node bindings of a midge object, in a contiguous table indexed by node ID
+
+     @details
+     Node IDs come from the stream_manager's name_registry; IDs without an active node have null entries.
+     The lookups by name are thin wrappers around the registry.
+     The node_bindings are owned by the stream_manager that fills the table; the nodes are owned by midge.
+     */
+    class active_node_bindings
+    {
+        public:
+            struct entry
+            {
+                node_binding* f_binding = nullptr;
+                midge::node* f_node = nullptr;
+            };
+            typedef std::vector< entry > entries_t;
+
+        public:
+            active_node_bindings( const name_registry& a_names );
+
+            void set( node_id_t a_node_id, node_binding* a_binding, midge::node* a_node );
+
+            /// The find functions return nullptr if there's no active node with that ID or name
+            entry* find( node_id_t a_node_id );
+            const entry* find( node_id_t a_node_id ) const;
+            entry* find( const std::string& a_full_name );
+            entry* find( const std::string& a_stream_name, const std::string& a_node_name );
+
+            /// Entries indexed by node ID
+            const entries_t& entries() const;
+            entries_t& entries();
+
+            const name_registry& names() const;
+
+            void swap( active_node_bindings& a_other );
+            /// Removes the entries; does not delete the bindings
+            void clear();
+
+        private:
+            const name_registry* f_names;
+            entries_t f_entries;
+    };
 
     class node_builder;
 
@@ -55,12 +154,21 @@ namespace sandfly
             {
                 scarab::param_node f_device_config;
 
+                stream_id_t f_id = name_registry::s_invalid_id;
+
                 typedef std::map< std::string, node_builder* > nodes_t;
-                typedef std::set< std::string > connections_t;
+                typedef connection_graph::edges_t connections_t;
 
                 nodes_t f_nodes;
                 connections_t f_connections;
 
+                /// true if the stream's nodes and connections are not present in the current midge object
+                bool f_needs_build = true;
+                /// nodes that have been configured since they were added to the current midge object
+                std::set< std::string > f_dirty_nodes;
+                /// nodes with a placement from their config, which automatic placement leaves alone
+                std::set< std::string > f_placed_nodes;
+
                 //std::string f_run_string;
             };
 
@@ -80,6 +188,9 @@ namespace sandfly
             bool configure_node( const std::string& a_stream_name, const std::string& a_node_name, const scarab::param_node& a_config );
             bool dump_node_config( const std::string& a_stream_name, const std::string& a_node_name, scarab::param_node& a_config ) const;
 
+            /// Reads the CPU topology again, and places the streams on it if auto_placement is on
+            void refresh_topology();
+
         public:
             void reset_midge(); // throws sandfly::error in the event of an error configuring midge
             bool must_reset_midge() const;
@@ -89,10 +200,26 @@ namespace sandfly
 
             active_node_bindings* get_node_bindings();
 
+            /// IDs of the streams and nodes; names are interned when a stream is added
+            const name_registry& names() const;
+
             std::string get_node_run_str() const;
 
+            /// Finds the stream and node names for a full node name ([stream]_[node], as used in midge and the node bindings)
+            /// Returns false if there is no such node
+            bool split_node_name( const std::string& a_full_name, std::string& a_stream_name, std::string& a_node_name ) const;
+
             bool is_in_use() const;
 
+            /// Starts building a standby midge object in the background from the current stream templates
+            /// The standby holds a second set of node resources until it's used or discarded; see the class description
+            void prepare_standby();
+            /// Throws away the standby midge object, if there is one; the streams will be built again at the next reset
+            void discard_standby();
+
+            typedef std::function< void() > change_callback_t;
+            void add_change_callback( const change_callback_t& a_callback );
+
         public:
             dripline::reply_ptr_t handle_add_stream_request( const dripline::request_ptr_t a_request );
             dripline::reply_ptr_t handle_remove_stream_request( const dripline::request_ptr_t a_request );
@@ -101,11 +228,17 @@ namespace sandfly
             dripline::reply_ptr_t handle_dump_config_node_request( const dripline::request_ptr_t a_request );
             dripline::reply_ptr_t handle_get_stream_list_request( const dripline::request_ptr_t a_request );
             dripline::reply_ptr_t handle_get_stream_node_list_request( const dripline::request_ptr_t a_request );
+            dripline::reply_ptr_t handle_get_placement_plan_request( const dripline::request_ptr_t a_request );
 
         private:
             void _add_stream( const std::string& a_name, const scarab::param_node& a_node );
+            void _add_replicas( const std::string& a_name, const scarab::param_node& a_node );
             void _add_stream( const std::string& a_name, const std::string& a_type, const scarab::param_node& a_node );
             void _remove_stream( const std::string& a_name );
+            /// Throws sandfly::error if any of the streams, with the nodes of a_node's preset, would clash with an existing stream or node name
+            void check_new_stream_names( const std::vector< std::string >& a_stream_names, const scarab::param_node& a_node ) const;
+            /// Adds the stream's full node names to a_full_names; requires the manager lock
+            void check_new_stream_name( const std::string& a_stream_name, const compiled_stream_preset& a_preset, std::set< std::string >& a_full_names ) const;
 
             void _configure_node( const std::string& a_stream_name, const std::string& a_node_name, const scarab::param_node& a_config );
             void _dump_node_config( const std::string& a_stream_name, const std::string& a_node_name, scarab::param_node& a_config ) const;
@@ -113,14 +246,58 @@ namespace sandfly
             void clear_node_bindings();
 
             typedef std::map< std::string, stream_template > streams_t;
+
+            // requires f_manager_mutex to be locked
+            bool has_dirty_streams() const;
+
+            // these are called from reset_midge() with both the manager and midge mutexes locked
+            void build_streams( const std::vector< const stream_template* >& a_streams, midge::diptera& a_midge, active_node_bindings& a_bindings );
+            void reconfigure_dirty_nodes( stream_template& a_stream );
+            bool swap_in_standby();
+            // waits for the standby build and throws away the result; requires f_standby_mutex to be locked
+            void drop_standby();
+
+            void build_standby( std::shared_ptr< streams_t > a_snapshot );
+
+            // deletes the stream's builders and placements, and erases it; requires f_manager_mutex to be locked
+            void discard_stream( streams_t::iterator a_stream_it );
+
+            static void delete_builders( streams_t& a_streams );
+            static void delete_bindings( active_node_bindings& a_bindings );
+
+            name_registry f_names;
             streams_t f_streams;
 
+            // calls the change callbacks; requires f_manager_mutex to be locked
+            void templates_changed();
+            std::vector< change_callback_t > f_change_callbacks; // guarded by f_manager_mutex
+
+            // places the streams automatically, if auto_placement is on; requires f_manager_mutex to be locked
+            // called once per add, remove, or configure; the locations from the previous plan are replaced or cleared
+            void update_placement_plan();
+            cpu_topology f_topology; // guarded by f_manager_mutex
+            bool f_have_topology; // guarded by f_manager_mutex
+            placement_plan f_placement_plan; // guarded by f_manager_mutex
+
             mutable std::mutex f_manager_mutex;
 
             midge_ptr_t f_midge;
             active_node_bindings f_node_bindings;
-            bool f_must_reset_midge;
+            bool f_must_reset_midge; // a full rebuild of the midge object is required
             mutable std::mutex f_midge_mutex;
+
+            // lock order is f_manager_mutex, f_midge_mutex, f_standby_mutex
+            midge_ptr_t f_standby_midge;
+            active_node_bindings f_standby_node_bindings;
+            bool f_standby_pending; // the stream templates' change tracking is relative to the standby; guarded by f_manager_mutex
+            std::future< void > f_standby_return;
+            std::mutex f_standby_mutex;
+
+        public:
+            /// Number of threads used to construct and configure nodes when midge is built
+            mv_accessible( unsigned, n_build_threads );
+            /// Whether the nodes without a configured placement are placed automatically
+            mv_accessible( bool, auto_placement );
     };
 
 
@@ -135,7 +312,7 @@ namespace sandfly
     inline bool stream_manager::must_reset_midge() const
     {
         std::unique_lock< std::mutex > t_lock( f_manager_mutex );
-        return f_must_reset_midge;
+        return f_must_reset_midge || f_standby_pending || has_dirty_streams();
     }
 
     inline active_node_bindings* stream_manager::get_node_bindings()
@@ -143,6 +320,49 @@ namespace sandfly
         return &f_node_bindings;
     }
 
+    inline const name_registry& stream_manager::names() const
+    {
+        return f_names;
+    }
+
+
+    inline active_node_bindings::entry* active_node_bindings::find( node_id_t a_node_id )
+    {
+        if( a_node_id >= f_entries.size() || f_entries[ a_node_id ].f_binding == nullptr ) return nullptr;
+        return &f_entries[ a_node_id ];
+    }
+
+    inline const active_node_bindings::entry* active_node_bindings::find( node_id_t a_node_id ) const
+    {
+        if( a_node_id >= f_entries.size() || f_entries[ a_node_id ].f_binding == nullptr ) return nullptr;
+        return &f_entries[ a_node_id ];
+    }
+
+    inline active_node_bindings::entry* active_node_bindings::find( const std::string& a_full_name )
+    {
+        return find( f_names->find_node( a_full_name ) );
+    }
+
+    inline active_node_bindings::entry* active_node_bindings::find( const std::string& a_stream_name, const std::string& a_node_name )
+    {
+        return find( f_names->find_node( a_stream_name, a_node_name ) );
+    }
+
+    inline const active_node_bindings::entries_t& active_node_bindings::entries() const
+    {
+        return f_entries;
+    }
+
+    inline active_node_bindings::entries_t& active_node_bindings::entries()
+    {
+        return f_entries;
+    }
+
+    inline const name_registry& active_node_bindings::names() const
+    {
+        return *f_names;
+    }
+
 
 } /* namespace sandfly */
 
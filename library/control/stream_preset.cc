@@ -73,6 +73,75 @@ namespace sandfly
     }
 
 
+    //**************************
+    // compiled_stream_preset
+    //**************************
+
+    compiled_stream_preset::compiled_stream_preset( const stream_preset& a_preset ) :
+            f_type( a_preset.get_type() ),
+            f_nodes( a_preset.get_nodes() ),
+            f_connection_strings( a_preset.get_connections() ),
+            f_connections()
+    {
+        std::set< std::string > t_node_names;
+        for( stream_preset::nodes_t::const_iterator t_node_it = f_nodes.begin(); t_node_it != f_nodes.end(); ++t_node_it )
+        {
+            t_node_names.insert( t_node_it->first );
+        }
+        try
+        {
+            for( stream_preset::connections_t::const_iterator t_conn_it = f_connection_strings.begin(); t_conn_it != f_connection_strings.end(); ++t_conn_it )
+            {
+                f_connections.add( *t_conn_it );
+            }
+            f_connections.validate( t_node_names );
+        }
+        catch( std::exception& e )
+        {
+            throw error() << "Invalid preset <" << f_type << ">: " << e.what();
+        }
+    }
+
+
+    //**************************
+    // stream_preset_registry
+    //**************************
+
+    stream_preset_registry::presets_t stream_preset_registry::s_presets;
+    std::shared_mutex stream_preset_registry::s_presets_mutex;
+
+    compiled_preset_ptr_t stream_preset_registry::get( const std::string& a_type )
+    {
+        compiled_preset_ptr_t t_compiled = find( a_type );
+        if( t_compiled ) return t_compiled;
+
+        // compile it from the registered class; this happens once per preset type
+        std::unique_ptr< stream_preset > t_preset( scarab::factory< stream_preset, const std::string& >::get_instance()->create( a_type, a_type ) );
+        if( ! t_preset ) return compiled_preset_ptr_t();
+        t_compiled = std::make_shared< const compiled_stream_preset >( *t_preset );
+
+        std::unique_lock< std::shared_mutex > t_lock( s_presets_mutex );
+        // if another thread compiled it in the meantime, theirs is used
+        return s_presets.insert( presets_t::value_type( a_type, t_compiled ) ).first->second;
+    }
+
+    compiled_preset_ptr_t stream_preset_registry::find( const std::string& a_type )
+    {
+        std::shared_lock< std::shared_mutex > t_lock( s_presets_mutex );
+        presets_t::const_iterator t_it = s_presets.find( a_type );
+        if( t_it == s_presets.end() ) return compiled_preset_ptr_t();
+        return t_it->second;
+    }
+
+    bool stream_preset_registry::add( const stream_preset& a_preset )
+    {
+        compiled_preset_ptr_t t_compiled = std::make_shared< const compiled_stream_preset >( a_preset );
+
+        std::unique_lock< std::shared_mutex > t_lock( s_presets_mutex );
+        return s_presets.insert( presets_t::value_type( a_preset.get_type(), t_compiled ) ).second;
+    }
+
+
     //*************************
     // runtime_stream_preset
     //*************************
@@ -88,13 +157,11 @@ namespace sandfly
     runtime_stream_preset::runtime_stream_preset( const std::string& a_type ) :
             stream_preset( a_type )
     {
-        //std::unique_lock< std::mutex > t_lock( s_runtime_presets_mutex );
-        runtime_presets::const_iterator t_preset_it = s_runtime_presets.find( a_type );
-        if( t_preset_it != s_runtime_presets.end() )
+        compiled_preset_ptr_t t_compiled = stream_preset_registry::find( a_type );
+        if( t_compiled )
         {
-            *this = *t_preset_it->second.f_preset_ptr.get();
-            //f_nodes = s_runtime_presets.at( a_type ).f_preset.f_nodes;
-            //f_connections = s_runtime_presets.at( a_type ).f_preset.f_connections;
+            f_nodes = t_compiled->f_nodes;
+            f_connections = t_compiled->f_connection_strings;
         }
     }
 
@@ -131,61 +198,74 @@ namespace sandfly
         }
         const scarab::param_array& t_nodes_array = a_preset_node["nodes"].as_array();
 
-        std::unique_lock< std::mutex > t_lock( s_runtime_presets_mutex );
-
-        auto t_rp_pair = s_runtime_presets.insert( runtime_presets::value_type( t_preset_type, rsp_creator( t_preset_type ) ) );
-        if( ! t_rp_pair.second )
+        if( stream_preset_registry::find( t_preset_type ) )
         {
-            LERROR( plog, "Unable to add new runtime preset <" << t_preset_type << ">" );
+            LERROR( plog, "Unable to add new runtime preset <" << t_preset_type << ">: it already exists" );
             return false;
         }
-        runtime_presets::iterator t_new_rsp_creator = t_rp_pair.first;
 
-        std::string t_type;
-        for( scarab::param_array::const_iterator t_nodes_it = t_nodes_array.begin(); t_nodes_it != t_nodes_array.end(); ++t_nodes_it )
+        // the preset is filled in locally and only becomes visible once it's been compiled
+        runtime_stream_preset t_preset;
+        t_preset.f_type = t_preset_type;
+
+        try
         {
-            if( ! t_nodes_it->is_node() )
+            std::string t_type;
+            for( scarab::param_array::const_iterator t_nodes_it = t_nodes_array.begin(); t_nodes_it != t_nodes_array.end(); ++t_nodes_it )
             {
-                LERROR( plog, "Invalid node specification in preset <" << t_preset_type << ">" );
-                scarab::factory< stream_preset, runtime_stream_preset, const std::string& >::get_instance()->remove_class( t_preset_type );
-                s_runtime_presets.erase( t_new_rsp_creator );
-                return false;
+                if( ! t_nodes_it->is_node() )
+                {
+                    LERROR( plog, "Invalid node specification in preset <" << t_preset_type << ">" );
+                    return false;
+                }
+
+                t_type = t_nodes_it->as_node().get_value( "type", "" );
+                if( t_type.empty() )
+                {
+                    LERROR( plog, "No type given for one of the nodes in preset <" << t_preset_type << ">" );
+                    return false;
+                }
+
+                LDEBUG( plog, "Adding node <" << t_type << ":" << t_nodes_it->as_node().get_value( "name", t_type ) << "> to preset <" << t_preset_type << ">" );
+                t_preset.node( t_type, t_nodes_it->as_node().get_value( "name", t_type ) );
             }
 
-            t_type = t_nodes_it->as_node().get_value( "type", "" );
-            if( t_type.empty() )
+            if( ! a_preset_node.has( "connections" ) )
             {
-                LERROR( plog, "No type given for one of the nodes in preset <" << t_preset_type << ">" );
-                scarab::factory< stream_preset, runtime_stream_preset, const std::string& >::get_instance()->remove_class( t_preset_type );
-                s_runtime_presets.erase( t_new_rsp_creator );
-                return false;
+                LDEBUG( plog, "Preset <" << t_preset_type << "> is being setup with no connections" );
             }
-
-            LDEBUG( plog, "Adding node <" << t_type << ":" << t_nodes_it->as_node().get_value( "name", t_type ) << "> to preset <" << t_preset_type << ">" );
-            t_new_rsp_creator->second.f_preset_ptr->node( t_type, t_nodes_it->as_node().get_value( "name", t_type ) );
-        }
-
-        if( ! a_preset_node.has( "connections" ) )
-        {
-            LDEBUG( plog, "Preset <" << t_preset_type << "> is being setup with no connections" );
-        }
-        else
-        {
-            const scarab::param_array& t_conn_array = a_preset_node["connections"].as_array();
-            for( scarab::param_array::const_iterator t_conn_it = t_conn_array.begin(); t_conn_it != t_conn_array.end(); ++t_conn_it )
+            else
             {
-                if( ! t_conn_it->is_value() )
+                const scarab::param_array& t_conn_array = a_preset_node["connections"].as_array();
+                for( scarab::param_array::const_iterator t_conn_it = t_conn_array.begin(); t_conn_it != t_conn_array.end(); ++t_conn_it )
                 {
-                    LERROR( plog, "Invalid connection specification in preset <" << t_preset_type << ">" );
-                    scarab::factory< stream_preset, runtime_stream_preset, const std::string& >::get_instance()->remove_class( t_preset_type );
-                    s_runtime_presets.erase( t_new_rsp_creator );
-                    return false;
+                    if( ! t_conn_it->is_value() )
+                    {
+                        LERROR( plog, "Invalid connection specification in preset <" << t_preset_type << ">" );
+                        return false;
+                    }
+
+                    LDEBUG( plog, "Adding connection <" << t_conn_it->as_value().as_string() << "> to preset <" << t_preset_type << ">");
+                    t_preset.connection( t_conn_it->as_value().as_string() );
                 }
+            }
 
-                LDEBUG( plog, "Adding connection <" << t_conn_it->as_value().as_string() << "> to preset <" << t_preset_type << ">");
-                t_new_rsp_creator->second.f_preset_ptr->connection( t_conn_it->as_value().as_string() );
+            if( ! stream_preset_registry::add( t_preset ) )
+            {
+                LERROR( plog, "Unable to add new runtime preset <" << t_preset_type << ">: it already exists" );
+                return false;
             }
         }
+        catch( std::exception& e )
+        {
+            LERROR( plog, e.what() );
+            return false;
+        }
+
+        {
+            std::unique_lock< std::mutex > t_lock( s_runtime_presets_mutex );
+            s_runtime_presets[ t_preset_type ].reset( new registrar_t( t_preset_type ) );
+        }
 
         LINFO( plog, "Preset <" << t_preset_type << "> is now available" );
 
@@ -8,11 +8,15 @@
 #ifndef SANDFLY_STREAM_PRESET_HH_
 #define SANDFLY_STREAM_PRESET_HH_
 
+#include "connection_graph.hh"
+
 #include "factory.hh"
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <string>
 
 namespace scarab
@@ -38,6 +42,7 @@ namespace sandfly
 
             stream_preset& operator=( const stream_preset& a_rhs );
 
+            const std::string& get_type() const;
             const nodes_t& get_nodes() const;
             const connections_t& get_connections() const;
 
@@ -52,6 +57,65 @@ namespace sandfly
     };
 
 
+    /*!
+     @struct compiled_stream_preset
+
+     @brief Immutable form of a stream preset, with its connections parsed and validated
+
+     @details
+     Compiled presets are shared (as compiled_preset_ptr_t) by everything that uses them; they're never modified once they're made.
+     */
+    struct compiled_stream_preset
+    {
+        std::string f_type;
+        stream_preset::nodes_t f_nodes;
+        stream_preset::connections_t f_connection_strings;
+        connection_graph f_connections;
+
+        /// Throws sandfly::error if the preset's connections are invalid
+        compiled_stream_preset( const stream_preset& a_preset );
+    };
+    typedef std::shared_ptr< const compiled_stream_preset > compiled_preset_ptr_t;
+
+    /*!
+     @class stream_preset_registry
+
+     @brief Registry of compiled stream presets
+
+     @details
+     Presets registered with REGISTER_PRESET are compiled the first time they're requested; runtime presets are compiled when they're added.
+     Lookups take a shared lock, so streams can be made from presets concurrently, and they only copy the shared_ptr.
+     */
+    class stream_preset_registry
+    {
+        public:
+            /// Returns the compiled preset, or nullptr if there's no preset of that type
+            /// Throws sandfly::error if the preset has to be compiled and is invalid
+            static compiled_preset_ptr_t get( const std::string& a_type );
+
+            /// Returns the compiled preset if it's already in the registry, or nullptr
+            static compiled_preset_ptr_t find( const std::string& a_type );
+
+            /// Compiles and adds a preset; returns false if there's already a preset of that type
+            /// Throws sandfly::error if the preset is invalid
+            static bool add( const stream_preset& a_preset );
+
+        private:
+            typedef std::map< std::string, compiled_preset_ptr_t > presets_t;
+            static presets_t s_presets;
+            static std::shared_mutex s_presets_mutex;
+    };
+
+
+    /*!
+     @class runtime_stream_preset
+
+     @brief Stream preset defined in a configuration rather than in code
+
+     @details
+     add_preset() compiles the preset into the stream_preset_registry and registers the type with the stream_preset factory.
+     Presets created by the factory are copies of the compiled preset; stream_manager uses the compiled preset directly.
+     */
     class runtime_stream_preset : public stream_preset
     {
         public:
@@ -66,15 +130,8 @@ namespace sandfly
             static bool add_preset( const scarab::param_node& a_preset_node );
 
         protected:
-            struct rsp_creator
-            {
-                std::shared_ptr< runtime_stream_preset > f_preset_ptr;
-                typedef scarab::registrar< stream_preset, runtime_stream_preset, const std::string& > registrar_t;
-                std::shared_ptr< registrar_t > f_registrar_ptr;
-                rsp_creator() : f_preset_ptr( new runtime_stream_preset() ), f_registrar_ptr( new registrar_t( "" ) ) {}
-                rsp_creator( const std::string& a_type ) : f_preset_ptr( new runtime_stream_preset( a_type ) ), f_registrar_ptr( new registrar_t( a_type ) ) {}
-            };
-            typedef std::map< std::string, rsp_creator> runtime_presets;
+            typedef scarab::registrar< stream_preset, runtime_stream_preset, const std::string& > registrar_t;
+            typedef std::map< std::string, std::shared_ptr< registrar_t > > runtime_presets;
             static runtime_presets s_runtime_presets;
             static std::mutex s_runtime_presets_mutex;
 
@@ -83,6 +140,11 @@ namespace sandfly
 
 
 
+    inline const std::string& stream_preset::get_type() const
+    {
+        return f_type;
+    }
+
     inline const stream_preset::nodes_t& stream_preset::get_nodes() const
     {
         return f_nodes;
@@ -0,0 +1,561 @@
+/*
+ * thread_placement.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "thread_placement.hh"
+
+#include "sandfly_error.hh"
+
+#include "logger.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sandfly
+{
+    LOGGER( plog, "thread_placement" );
+
+    namespace
+    {
+        unsigned parse_cpu( const std::string& a_list, const std::string& a_cpu )
+        {
+            if( a_cpu.empty() || a_cpu.find_first_not_of( "0123456789" ) != std::string::npos )
+            {
+                throw error() << "Invalid CPU list <" << a_list << ">: <" << a_cpu << "> is not a CPU number";
+            }
+            unsigned long t_cpu = std::stoul( a_cpu );
+            if( t_cpu >= CPU_SETSIZE )
+            {
+                throw error() << "Invalid CPU list <" << a_list << ">: CPU " << t_cpu << " is out of range";
+            }
+            return unsigned(t_cpu);
+        }
+
+        // memory policy modes from linux/mempolicy.h, which isn't installed everywhere (libnuma isn't a dependency)
+        const int s_mpol_default = 0;
+        const int s_mpol_preferred = 1;
+
+        int set_memory_policy( int a_mode, int a_numa_node )
+        {
+#ifdef SYS_set_mempolicy
+            unsigned long t_mask = 0;
+            if( a_mode != s_mpol_default )
+            {
+                if( a_numa_node < 0 || a_numa_node >= int(sizeof(t_mask) * 8) ) return EINVAL;
+                t_mask = 1UL << a_numa_node;
+            }
+            if( syscall( SYS_set_mempolicy, a_mode, a_mode == s_mpol_default ? nullptr : &t_mask, sizeof(t_mask) * 8 + 1 ) != 0 ) return errno;
+            return 0;
+#else
+            return ENOSYS;
+#endif
+        }
+
+        int set_thread_cpus( const std::vector< unsigned >& a_cpus )
+        {
+            cpu_set_t t_cpu_set;
+            CPU_ZERO( &t_cpu_set );
+            for( std::vector< unsigned >::const_iterator t_cpu_it = a_cpus.begin(); t_cpu_it != a_cpus.end(); ++t_cpu_it )
+            {
+                CPU_SET( *t_cpu_it, &t_cpu_set );
+            }
+            return pthread_setaffinity_np( pthread_self(), sizeof(t_cpu_set), &t_cpu_set );
+        }
+
+        // nice values below the current one need CAP_SYS_NICE, or RLIMIT_NICE (which allows down to 20 - limit)
+        int set_best_nice( const std::string& a_node_name, pid_t a_thread_id, int a_nice )
+        {
+            if( setpriority( PRIO_PROCESS, a_thread_id, a_nice ) == 0 ) return a_nice;
+            int t_error = errno;
+
+            errno = 0;
+            int t_current = getpriority( PRIO_PROCESS, a_thread_id );
+            if( errno != 0 ) t_current = 0;
+
+            int t_lowest = t_current;
+            struct rlimit t_limit;
+            if( getrlimit( RLIMIT_NICE, &t_limit ) == 0 )
+            {
+                t_lowest = std::min( t_current, 20 - int(std::min< rlim_t >( t_limit.rlim_cur, 40 )) );
+            }
+
+            int t_nice = std::max( a_nice, t_lowest );
+            if( t_nice != a_nice && t_nice != t_current && setpriority( PRIO_PROCESS, a_thread_id, t_nice ) == 0 )
+            {
+                LWARN( plog, "Unable to set nice " << a_nice << " for node <" << a_node_name << ">: " << strerror( t_error ) << "; using nice " << t_nice << " (RLIMIT_NICE)" );
+                return t_nice;
+            }
+            LWARN( plog, "Unable to set nice " << a_nice << " for node <" << a_node_name << ">: " << strerror( t_error ) << "; staying at nice " << t_current );
+            return t_current;
+        }
+
+        void apply_schedule( const std::string& a_node_name, const thread_placement& a_placement, pid_t a_thread_id )
+        {
+            if( a_placement.f_policy == sched_policy::inherit ) return;
+
+            if( a_placement.f_policy == sched_policy::other )
+            {
+                // in case midge's thread inherited a real-time policy
+                struct sched_param t_param;
+                t_param.sched_priority = 0;
+                pthread_setschedparam( pthread_self(), SCHED_OTHER, &t_param );
+                set_best_nice( a_node_name, a_thread_id, a_placement.f_nice );
+                return;
+            }
+
+            int t_policy = a_placement.f_policy == sched_policy::fifo ? SCHED_FIFO : SCHED_RR;
+            struct sched_param t_param;
+            t_param.sched_priority = std::max( sched_get_priority_min( t_policy ), std::min( sched_get_priority_max( t_policy ), a_placement.f_priority ) );
+            int t_result = pthread_setschedparam( pthread_self(), t_policy, &t_param );
+            if( t_result == 0 ) return;
+
+            // without CAP_SYS_NICE, real-time priorities up to RLIMIT_RTPRIO are allowed
+            struct rlimit t_limit;
+            if( t_result == EPERM && getrlimit( RLIMIT_RTPRIO, &t_limit ) == 0 && t_limit.rlim_cur != RLIM_INFINITY
+                    && t_limit.rlim_cur > 0 && int(t_limit.rlim_cur) < t_param.sched_priority )
+            {
+                int t_requested = t_param.sched_priority;
+                t_param.sched_priority = int(t_limit.rlim_cur);
+                if( pthread_setschedparam( pthread_self(), t_policy, &t_param ) == 0 )
+                {
+                    LWARN( plog, "Unable to use " << sched_policy_to_string( a_placement.f_policy ) << " priority " << t_requested << " for node <" << a_node_name
+                            << ">; using priority " << t_param.sched_priority << " (RLIMIT_RTPRIO)" );
+                    return;
+                }
+            }
+
+            LWARN( plog, "Unable to use " << sched_policy_to_string( a_placement.f_policy ) << " priority " << t_param.sched_priority << " for node <" << a_node_name
+                    << ">: " << strerror( t_result ) << "; falling back to other with the lowest nice value allowed" );
+            set_best_nice( a_node_name, a_thread_id, -20 );
+            return;
+        }
+
+        int get_thread_cpus( std::vector< unsigned >& a_cpus )
+        {
+            cpu_set_t t_cpu_set;
+            CPU_ZERO( &t_cpu_set );
+            int t_result = pthread_getaffinity_np( pthread_self(), sizeof(t_cpu_set), &t_cpu_set );
+            if( t_result != 0 ) return t_result;
+            a_cpus.clear();
+            for( unsigned t_cpu = 0; t_cpu < CPU_SETSIZE; ++t_cpu )
+            {
+                if( CPU_ISSET( t_cpu, &t_cpu_set ) ) a_cpus.push_back( t_cpu );
+            }
+            return 0;
+        }
+    }
+
+    std::vector< unsigned > parse_cpu_list( const std::string& a_list )
+    {
+        std::vector< unsigned > t_cpus;
+        std::stringstream t_stream( a_list );
+        std::string t_item;
+        while( std::getline( t_stream, t_item, ',' ) )
+        {
+            t_item.erase( std::remove( t_item.begin(), t_item.end(), ' ' ), t_item.end() );
+            std::string::size_type t_dash = t_item.find( '-' );
+            if( t_dash == std::string::npos )
+            {
+                t_cpus.push_back( parse_cpu( a_list, t_item ) );
+                continue;
+            }
+            unsigned t_first = parse_cpu( a_list, t_item.substr( 0, t_dash ) );
+            unsigned t_last = parse_cpu( a_list, t_item.substr( t_dash + 1 ) );
+            if( t_last < t_first )
+            {
+                throw error() << "Invalid CPU list <" << a_list << ">: range <" << t_item << "> is backwards";
+            }
+            for( unsigned t_cpu = t_first; t_cpu <= t_last; ++t_cpu ) t_cpus.push_back( t_cpu );
+        }
+        if( t_cpus.empty() )
+        {
+            throw error() << "Invalid CPU list <" << a_list << ">: no CPUs were given";
+        }
+        std::sort( t_cpus.begin(), t_cpus.end() );
+        t_cpus.erase( std::unique( t_cpus.begin(), t_cpus.end() ), t_cpus.end() );
+        return t_cpus;
+    }
+
+    std::string format_cpu_list( const std::vector< unsigned >& a_cpus )
+    {
+        std::stringstream t_stream;
+        for( unsigned i_cpu = 0; i_cpu < a_cpus.size(); )
+        {
+            unsigned t_end = i_cpu;
+            while( t_end + 1 < a_cpus.size() && a_cpus[ t_end + 1 ] == a_cpus[ t_end ] + 1 ) ++t_end;
+
+            if( i_cpu != 0 ) t_stream << ",";
+            t_stream << a_cpus[ i_cpu ];
+            if( t_end != i_cpu ) t_stream << "-" << a_cpus[ t_end ];
+            i_cpu = t_end + 1;
+        }
+        return t_stream.str();
+    }
+
+    std::vector< unsigned > numa_node_cpus( unsigned a_numa_node )
+    {
+        std::stringstream t_path;
+        t_path << "/sys/devices/system/node/node" << a_numa_node << "/cpulist";
+        std::ifstream t_file( t_path.str() );
+        if( ! t_file )
+        {
+            throw error() << "NUMA node " << a_numa_node << " does not exist";
+        }
+        std::string t_list( (std::istreambuf_iterator< char >( t_file )), std::istreambuf_iterator< char >() );
+        t_list.erase( std::remove( t_list.begin(), t_list.end(), '\n' ), t_list.end() );
+        if( t_list.empty() )
+        {
+            throw error() << "NUMA node " << a_numa_node << " has no CPUs";
+        }
+        return parse_cpu_list( t_list );
+    }
+
+
+    sched_policy string_to_sched_policy( const std::string& a_policy )
+    {
+        std::string t_policy( a_policy );
+        std::transform( t_policy.begin(), t_policy.end(), t_policy.begin(), []( unsigned char a_char ){ return std::tolower( a_char ); } );
+        if( t_policy.compare( 0, 6, "sched_" ) == 0 ) t_policy.erase( 0, 6 );
+
+        if( t_policy == "other" ) return sched_policy::other;
+        if( t_policy == "fifo" ) return sched_policy::fifo;
+        if( t_policy == "rr" ) return sched_policy::rr;
+        throw error() << "Invalid scheduling policy <" << a_policy << ">: should be fifo, rr, or other";
+    }
+
+    std::string sched_policy_to_string( sched_policy a_policy )
+    {
+        switch( a_policy )
+        {
+            case sched_policy::inherit: return "inherit";
+            case sched_policy::other: return "other";
+            case sched_policy::fifo: return "fifo";
+            case sched_policy::rr: return "rr";
+        }
+        return "unknown";
+    }
+
+
+    const std::vector< std::string >& thread_placement::config_keys()
+    {
+        static const std::vector< std::string > s_keys = { "cpu-set", "numa-node", "sched-policy", "sched-priority", "nice" };
+        return s_keys;
+    }
+
+    bool thread_placement::empty() const
+    {
+        return ! has_location() && f_policy == sched_policy::inherit;
+    }
+
+    bool thread_placement::has_location() const
+    {
+        return ! f_cpus.empty() || f_numa_node >= 0;
+    }
+
+    bool thread_placement::take_from_config( scarab::param_node& a_config )
+    {
+        bool t_found = false;
+        if( a_config.has( "cpu-set" ) )
+        {
+            if( ! a_config["cpu-set"].is_value() )
+            {
+                throw error() << "Invalid \"cpu-set\": it should be a CPU list";
+            }
+            // a single CPU can be given as a number
+            f_cpus = parse_cpu_list( a_config["cpu-set"]().to_string() );
+            a_config.erase( "cpu-set" );
+            t_found = true;
+        }
+        if( a_config.has( "numa-node" ) )
+        {
+            if( ! a_config["numa-node"].is_value() || ! a_config["numa-node"]().is_uint() )
+            {
+                throw error() << "Invalid \"numa-node\": it should be an unsigned integer";
+            }
+            f_numa_node = int(a_config["numa-node"]().as_uint());
+            a_config.erase( "numa-node" );
+            t_found = true;
+        }
+        if( a_config.has( "sched-policy" ) )
+        {
+            if( ! a_config["sched-policy"].is_value() || ! a_config["sched-policy"]().is_string() )
+            {
+                throw error() << "Invalid \"sched-policy\": it should be fifo, rr, or other";
+            }
+            f_policy = string_to_sched_policy( a_config["sched-policy"]().as_string() );
+            if( f_policy != sched_policy::other ) f_nice = 0;
+            if( f_policy == sched_policy::other ) f_priority = 0;
+            else if( f_priority == 0 ) f_priority = 1;
+            a_config.erase( "sched-policy" );
+            t_found = true;
+        }
+        if( a_config.has( "sched-priority" ) )
+        {
+            if( ! a_config["sched-priority"].is_value() || ! a_config["sched-priority"]().is_uint()
+                    || a_config["sched-priority"]().as_uint() < 1 || a_config["sched-priority"]().as_uint() > 99 )
+            {
+                throw error() << "Invalid \"sched-priority\": it should be from 1 to 99";
+            }
+            if( f_policy != sched_policy::fifo && f_policy != sched_policy::rr )
+            {
+                throw error() << "\"sched-priority\" only applies to the fifo and rr scheduling policies";
+            }
+            f_priority = int(a_config["sched-priority"]().as_uint());
+            a_config.erase( "sched-priority" );
+            t_found = true;
+        }
+        if( a_config.has( "nice" ) )
+        {
+            if( ! a_config["nice"].is_value() || ! ( a_config["nice"]().is_int() || a_config["nice"]().is_uint() )
+                    || a_config["nice"]().as_int() < -20 || a_config["nice"]().as_int() > 19 )
+            {
+                throw error() << "Invalid \"nice\": it should be from -20 to 19";
+            }
+            if( f_policy == sched_policy::inherit ) f_policy = sched_policy::other;
+            if( f_policy != sched_policy::other )
+            {
+                throw error() << "\"nice\" only applies to the other scheduling policy";
+            }
+            f_nice = a_config["nice"]().as_int();
+            a_config.erase( "nice" );
+            t_found = true;
+        }
+        return t_found;
+    }
+
+    std::vector< unsigned > thread_placement::effective_cpus() const
+    {
+        if( f_numa_node < 0 ) return f_cpus;
+
+        std::vector< unsigned > t_node_cpus = numa_node_cpus( unsigned(f_numa_node) );
+        if( f_cpus.empty() ) return t_node_cpus;
+
+        std::vector< unsigned > t_cpus;
+        std::set_intersection( f_cpus.begin(), f_cpus.end(), t_node_cpus.begin(), t_node_cpus.end(), std::back_inserter( t_cpus ) );
+        if( t_cpus.empty() )
+        {
+            throw error() << "None of the CPUs <" << format_cpu_list( f_cpus ) << "> are on NUMA node " << f_numa_node << " (CPUs <" << format_cpu_list( t_node_cpus ) << ">)";
+        }
+        return t_cpus;
+    }
+
+    void thread_placement::to_param( scarab::param_node& a_node ) const
+    {
+        if( ! f_cpus.empty() ) a_node.add( "cpu-set", format_cpu_list( f_cpus ) );
+        if( f_numa_node >= 0 ) a_node.add( "numa-node", unsigned(f_numa_node) );
+        if( f_policy != sched_policy::inherit ) a_node.add( "sched-policy", sched_policy_to_string( f_policy ) );
+        if( f_policy == sched_policy::fifo || f_policy == sched_policy::rr ) a_node.add( "sched-priority", unsigned(f_priority) );
+        if( f_policy == sched_policy::other ) a_node.add( "nice", f_nice );
+        return;
+    }
+
+
+    placement_guard::placement_guard( const thread_placement& a_placement ) :
+            f_restore_cpus( false ),
+            f_restore_memory( false ),
+            f_previous_cpus()
+    {
+        if( a_placement.empty() ) return;
+
+        try
+        {
+            std::vector< unsigned > t_cpus = a_placement.effective_cpus();
+            if( ! t_cpus.empty() && get_thread_cpus( f_previous_cpus ) == 0 )
+            {
+                int t_result = set_thread_cpus( t_cpus );
+                if( t_result == 0 ) f_restore_cpus = true;
+                else LWARN( plog, "Unable to move to CPUs <" << format_cpu_list( t_cpus ) << "> while building a node: " << strerror( t_result ) );
+            }
+        }
+        catch( error& e )
+        {
+            LWARN( plog, "Unable to place the node while building it: " << e.what() );
+        }
+
+        if( a_placement.f_numa_node >= 0 )
+        {
+            int t_result = set_memory_policy( s_mpol_preferred, a_placement.f_numa_node );
+            if( t_result == 0 ) f_restore_memory = true;
+            else LWARN( plog, "Unable to prefer memory on NUMA node " << a_placement.f_numa_node << " while building a node: " << strerror( t_result ) );
+        }
+    }
+
+    placement_guard::~placement_guard()
+    {
+        if( f_restore_memory )
+        {
+            int t_result = set_memory_policy( s_mpol_default, -1 );
+            if( t_result != 0 ) LWARN( plog, "Unable to restore the default memory policy: " << strerror( t_result ) );
+        }
+        if( f_restore_cpus )
+        {
+            int t_result = set_thread_cpus( f_previous_cpus );
+            if( t_result != 0 ) LWARN( plog, "Unable to restore the CPU affinity: " << strerror( t_result ) );
+        }
+    }
+
+
+    placement_registry::placement_registry() :
+            f_placements(),
+            f_mutex()
+    {}
+
+    placement_registry::~placement_registry()
+    {}
+
+    placement_registry& placement_registry::global()
+    {
+        static placement_registry s_registry;
+        return s_registry;
+    }
+
+    void placement_registry::set( const std::string& a_node_name, const thread_placement& a_placement )
+    {
+        std::unique_lock< std::shared_mutex > t_lock( f_mutex );
+        entry& t_entry = f_placements[ a_node_name ];
+        t_entry = entry();
+        t_entry.f_requested = a_placement;
+        return;
+    }
+
+    void placement_registry::remove( const std::string& a_node_name )
+    {
+        std::unique_lock< std::shared_mutex > t_lock( f_mutex );
+        f_placements.erase( a_node_name );
+        return;
+    }
+
+    bool placement_registry::find( const std::string& a_node_name, thread_placement& a_placement ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        std::map< std::string, entry >::const_iterator t_it = f_placements.find( a_node_name );
+        if( t_it == f_placements.end() ) return false;
+        a_placement = t_it->second.f_requested;
+        return true;
+    }
+
+    bool placement_registry::apply_to_current_thread( const std::string& a_node_name )
+    {
+        thread_placement t_placement;
+        if( ! find( a_node_name, t_placement ) ) return false;
+
+        std::vector< unsigned > t_cpus = t_placement.effective_cpus();
+        if( ! t_cpus.empty() )
+        {
+            int t_result = set_thread_cpus( t_cpus );
+            if( t_result != 0 )
+            {
+                throw error() << "Unable to set the CPU affinity of node <" << a_node_name << "> to <" << format_cpu_list( t_cpus ) << ">: " << strerror( t_result );
+            }
+            LDEBUG( plog, "Node <" << a_node_name << "> is running on CPUs <" << format_cpu_list( t_cpus ) << ">" );
+        }
+
+        // the policy applies to the thread's future allocations; it's a preference, so the kernel falls back to other nodes when this one is full
+        bool t_memory_preferred = false;
+        if( t_placement.f_numa_node >= 0 )
+        {
+            int t_result = set_memory_policy( s_mpol_preferred, t_placement.f_numa_node );
+            if( t_result == 0 )
+            {
+                t_memory_preferred = true;
+                LDEBUG( plog, "Node <" << a_node_name << "> prefers memory on NUMA node " << t_placement.f_numa_node );
+            }
+            else
+            {
+                LWARN( plog, "Unable to prefer memory on NUMA node " << t_placement.f_numa_node << " for node <" << a_node_name << ">: " << strerror( t_result ) );
+            }
+        }
+
+        pid_t t_thread_id = pid_t(syscall( SYS_gettid ));
+        apply_schedule( a_node_name, t_placement, t_thread_id );
+
+        // record what the thread ended up with, after any fallback
+        int t_policy = SCHED_OTHER;
+        struct sched_param t_param;
+        t_param.sched_priority = 0;
+        pthread_getschedparam( pthread_self(), &t_policy, &t_param );
+        errno = 0;
+        int t_nice = getpriority( PRIO_PROCESS, t_thread_id );
+        if( errno != 0 ) t_nice = 0;
+
+        std::unique_lock< std::shared_mutex > t_lock( f_mutex );
+        std::map< std::string, entry >::iterator t_it = f_placements.find( a_node_name );
+        if( t_it != f_placements.end() )
+        {
+            t_it->second.f_applied = true;
+            t_it->second.f_effective_cpus = t_cpus;
+            t_it->second.f_memory_preferred = t_memory_preferred;
+            t_it->second.f_thread_id = t_thread_id;
+            t_it->second.f_effective_policy = t_policy == SCHED_FIFO ? sched_policy::fifo : ( t_policy == SCHED_RR ? sched_policy::rr : sched_policy::other );
+            t_it->second.f_effective_priority = t_param.sched_priority;
+            t_it->second.f_effective_nice = t_nice;
+        }
+        return true;
+    }
+
+    bool placement_registry::report( const std::string& a_node_name, scarab::param_node& a_report ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        std::map< std::string, entry >::const_iterator t_it = f_placements.find( a_node_name );
+        if( t_it == f_placements.end() ) return false;
+
+        report_entry( t_it->second, a_report );
+        return true;
+    }
+
+    void placement_registry::report_applied( scarab::param_node& a_report ) const
+    {
+        std::shared_lock< std::shared_mutex > t_lock( f_mutex );
+        for( std::map< std::string, entry >::const_iterator t_it = f_placements.begin(); t_it != f_placements.end(); ++t_it )
+        {
+            if( ! t_it->second.f_applied ) continue;
+            scarab::param_node t_node;
+            report_entry( t_it->second, t_node );
+            a_report.add( t_it->first, t_node );
+        }
+        return;
+    }
+
+    void placement_registry::clear_applied()
+    {
+        std::unique_lock< std::shared_mutex > t_lock( f_mutex );
+        for( std::map< std::string, entry >::iterator t_it = f_placements.begin(); t_it != f_placements.end(); ++t_it )
+        {
+            thread_placement t_requested( t_it->second.f_requested );
+            t_it->second = entry();
+            t_it->second.f_requested = t_requested;
+        }
+        return;
+    }
+
+    void placement_registry::report_entry( const entry& a_entry, scarab::param_node& a_report )
+    {
+        a_entry.f_requested.to_param( a_report );
+        a_report.add( "applied", a_entry.f_applied );
+        if( a_entry.f_applied )
+        {
+            if( ! a_entry.f_effective_cpus.empty() ) a_report.add( "effective-cpu-set", format_cpu_list( a_entry.f_effective_cpus ) );
+            a_report.add( "memory-policy", a_entry.f_memory_preferred ? "preferred" : "default" );
+            a_report.add( "thread-id", a_entry.f_thread_id );
+            a_report.add( "effective-sched-policy", sched_policy_to_string( a_entry.f_effective_policy ) );
+            if( a_entry.f_effective_policy == sched_policy::other ) a_report.add( "effective-nice", a_entry.f_effective_nice );
+            else a_report.add( "effective-sched-priority", a_entry.f_effective_priority );
+        }
+        return;
+    }
+
+} /* namespace sandfly */
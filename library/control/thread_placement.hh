@@ -0,0 +1,170 @@
+/*
+ * thread_placement.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_THREAD_PLACEMENT_HH_
+#define SANDFLY_THREAD_PLACEMENT_HH_
+
+#include "param.hh"
+
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace sandfly
+{
+    /// Parses a CPU list in the Linux format, e.g. "0-3,8,10-11"; the result is sorted and has no duplicates
+    /// Throws sandfly::error if the list is malformed
+    std::vector< unsigned > parse_cpu_list( const std::string& a_list );
+    /// Formats CPUs as a CPU list, with ranges where possible
+    std::string format_cpu_list( const std::vector< unsigned >& a_cpus );
+
+    /// CPUs of a NUMA node, from sysfs; throws sandfly::error if there's no such node
+    std::vector< unsigned > numa_node_cpus( unsigned a_numa_node );
+
+    /// Scheduling class of a node's thread; inherit leaves the thread as midge started it
+    enum class sched_policy
+    {
+        inherit,
+        other,
+        fifo,
+        rr
+    };
+    /// Accepts "other", "fifo", and "rr", in either case and optionally prefixed with "sched_"; throws sandfly::error otherwise
+    sched_policy string_to_sched_policy( const std::string& a_policy );
+    std::string sched_policy_to_string( sched_policy a_policy );
+
+    /*!
+     @struct thread_placement
+
+     @brief Where a node's thread should run and where its memory should be allocated
+
+     @details
+     Config keys (at the stream level, and for individual nodes, which override the stream's values):
+     - "cpu-set" (string or unsigned): CPU list that the thread is restricted to
+     - "numa-node" (unsigned): NUMA node whose memory is preferred for allocations; if there's no cpu-set,
+       the thread is also restricted to the node's CPUs
+     - "sched-policy" (string): "fifo", "rr", or "other"
+     - "sched-priority" (unsigned): real-time priority for fifo and rr, from 1 to 99 (default 1)
+     - "nice" (integer): nice value for other, from -20 to 19; giving a nice value without a policy implies other
+     */
+    struct thread_placement
+    {
+        std::vector< unsigned > f_cpus; // CPUs the thread may run on; empty if it's not restricted
+        int f_numa_node = -1; // preferred NUMA node for memory; negative if there's no preference
+        sched_policy f_policy = sched_policy::inherit;
+        int f_priority = 0; // for fifo and rr
+        int f_nice = 0; // for other
+
+        /// Config keys that make up a placement
+        static const std::vector< std::string >& config_keys();
+
+        bool empty() const;
+        /// true if the placement restricts the CPUs or the NUMA node (as opposed to only the scheduling)
+        bool has_location() const;
+
+        /// Reads "cpu-set", "numa-node", "sched-policy", "sched-priority", and "nice" from a_config, if they're present, and removes them from it
+        /// Returns true if any of them was present; throws sandfly::error if the values are invalid or don't fit the scheduling policy
+        bool take_from_config( scarab::param_node& a_config );
+
+        /// The CPUs the thread will be restricted to: the cpu-set, limited to the NUMA node's CPUs if both are given
+        /// Throws sandfly::error if the NUMA node doesn't exist or has none of the CPUs in the cpu-set
+        std::vector< unsigned > effective_cpus() const;
+
+        void to_param( scarab::param_node& a_node ) const;
+    };
+
+    /*!
+     @class placement_guard
+
+     @brief Applies a placement to the current thread for the lifetime of the guard
+
+     @details
+     Used while a node is built, so that memory the node allocates and touches in its constructor is on the right NUMA node.
+     The thread's previous CPU affinity and the default memory policy are restored when the guard is destroyed.
+     Failures are logged rather than thrown, since the placement is only an optimization at that point.
+     */
+    class placement_guard
+    {
+        public:
+            placement_guard( const thread_placement& a_placement );
+            ~placement_guard();
+
+        private:
+            bool f_restore_cpus;
+            bool f_restore_memory;
+            std::vector< unsigned > f_previous_cpus;
+    };
+
+    /*!
+     @class placement_registry
+
+     @brief Placements of the nodes' threads, by full node name
+
+     @details
+     stream_manager sets the placements when streams are added (from the stream's "cpu-set") and removes them with the stream.
+
+     midge starts the node threads itself, so the placement is applied from within the node's thread:
+     a node that supports placement calls
+
+         sandfly::placement_registry::global().apply_to_current_thread( get_name() );
+
+     at the start of its execute() function. That sets the thread's CPU affinity and, if there's a NUMA node,
+     makes it the preferred node for the thread's allocations (set_mempolicy), so buffers the node allocates
+     and first touches in its thread are local. Nodes are also built under a placement_guard.
+
+     It then sets the thread's scheduling.  If the process isn't allowed the requested setting (no CAP_SYS_NICE),
+     it falls back to the best setting the resource limits allow, with a warning:
+     - fifo and rr: the priority is lowered to RLIMIT_RTPRIO if that's nonzero; otherwise other with the lowest nice value allowed;
+     - other: the nice value is raised to the lowest allowed by RLIMIT_NICE.
+
+     report() gives the requested placement and, once the node's thread has applied it, the effective CPUs, memory policy, and scheduling.
+     run_control clears the applied state before each run and reports the nodes' threads in the daq-status.
+     */
+    class placement_registry
+    {
+        public:
+            placement_registry();
+            virtual ~placement_registry();
+
+            static placement_registry& global();
+
+            void set( const std::string& a_node_name, const thread_placement& a_placement );
+            void remove( const std::string& a_node_name );
+            /// Returns false if the node has no placement
+            bool find( const std::string& a_node_name, thread_placement& a_placement ) const;
+
+            /// Applies the node's placement to the calling thread; returns false if the node has no placement
+            /// Throws sandfly::error if the placement can't be applied
+            bool apply_to_current_thread( const std::string& a_node_name );
+
+            /// Adds the node's placement to a_report; returns false if the node has no placement
+            bool report( const std::string& a_node_name, scarab::param_node& a_report ) const;
+            /// Adds the placements of the nodes whose threads have applied them, by node name
+            void report_applied( scarab::param_node& a_report ) const;
+            /// Forgets which placements have been applied, e.g. before the node threads are started again
+            void clear_applied();
+
+        private:
+            struct entry
+            {
+                thread_placement f_requested;
+                bool f_applied = false;
+                std::vector< unsigned > f_effective_cpus;
+                bool f_memory_preferred = false;
+                long f_thread_id = 0;
+                sched_policy f_effective_policy = sched_policy::inherit;
+                int f_effective_priority = 0;
+                int f_effective_nice = 0;
+            };
+            static void report_entry( const entry& a_entry, scarab::param_node& a_report );
+            std::map< std::string, entry > f_placements;
+            mutable std::shared_mutex f_mutex;
+    };
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_THREAD_PLACEMENT_HH_ */
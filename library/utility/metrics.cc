@@ -0,0 +1,242 @@
+/*
+ * metrics.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "metrics.hh"
+
+#include "param.hh"
+
+#include <algorithm>
+#include <limits>
+
+namespace sandfly
+{
+
+    unsigned this_thread_metric_shard()
+    {
+        static std::atomic< unsigned > s_next_shard( 0 );
+        thread_local unsigned t_shard = s_next_shard.fetch_add( 1, std::memory_order_relaxed ) % k_n_metric_shards;
+        return t_shard;
+    }
+
+    //*******************
+    // sharded_counter
+    //*******************
+
+    sharded_counter::sharded_counter() :
+            f_shards()
+    {
+        for( unsigned i_shard = 0; i_shard < k_n_metric_shards; ++i_shard )
+        {
+            f_shards[ i_shard ].f_value.store( 0, std::memory_order_relaxed );
+        }
+    }
+
+    uint64_t sharded_counter::value() const
+    {
+        uint64_t t_value = 0;
+        for( unsigned i_shard = 0; i_shard < k_n_metric_shards; ++i_shard )
+        {
+            t_value += f_shards[ i_shard ].f_value.load( std::memory_order_relaxed );
+        }
+        return t_value;
+    }
+
+    //*********
+    // gauge
+    //*********
+
+    gauge::gauge() :
+            f_value( 0 )
+    {}
+
+    //**********************
+    // histogram_snapshot
+    //**********************
+
+    uint64_t histogram_snapshot::bucket_upper_bound( unsigned a_bucket )
+    {
+        if( a_bucket == 0 ) return 1;
+        if( a_bucket >= 64 ) return std::numeric_limits< uint64_t >::max();
+        return uint64_t(1) << a_bucket;
+    }
+
+    double histogram_snapshot::percentile( double a_fraction ) const
+    {
+        uint64_t t_total = 0;
+        for( unsigned i_bucket = 0; i_bucket < s_n_buckets; ++i_bucket ) t_total += f_buckets[ i_bucket ];
+        if( t_total == 0 ) return 0.;
+
+        // nearest rank, then interpolate linearly within the bucket
+        double t_rank = a_fraction * double(t_total);
+        uint64_t t_below = 0;
+        for( unsigned i_bucket = 0; i_bucket < s_n_buckets; ++i_bucket )
+        {
+            if( f_buckets[ i_bucket ] == 0 ) continue;
+            if( double(t_below + f_buckets[ i_bucket ]) >= t_rank )
+            {
+                double t_lower = i_bucket == 0 ? 0. : double( bucket_upper_bound( i_bucket - 1 ) );
+                double t_upper = double( bucket_upper_bound( i_bucket ) );
+                return t_lower + (t_upper - t_lower) * (t_rank - double(t_below)) / double(f_buckets[ i_bucket ]);
+            }
+            t_below += f_buckets[ i_bucket ];
+        }
+        return double( bucket_upper_bound( s_n_buckets - 1 ) );
+    }
+
+    double histogram_snapshot::mean() const
+    {
+        return f_count == 0 ? 0. : double(f_sum) / double(f_count);
+    }
+
+    void histogram_snapshot::fill( scarab::param_node& a_node, double a_scale ) const
+    {
+        a_node.add( "count", scarab::param_value( f_count ) );
+        if( f_count == 0 ) return;
+        a_node.add( "sum", scarab::param_value( double(f_sum) / a_scale ) );
+        a_node.add( "mean", scarab::param_value( mean() / a_scale ) );
+        a_node.add( "p50", scarab::param_value( percentile( 0.50 ) / a_scale ) );
+        a_node.add( "p90", scarab::param_value( percentile( 0.90 ) / a_scale ) );
+        a_node.add( "p99", scarab::param_value( percentile( 0.99 ) / a_scale ) );
+        a_node.add( "max", scarab::param_value( double(f_max) / a_scale ) );
+        return;
+    }
+
+    //*****************
+    // log_histogram
+    //*****************
+
+    log_histogram::log_histogram() :
+            f_shards()
+    {
+        for( unsigned i_shard = 0; i_shard < k_n_metric_shards; ++i_shard )
+        {
+            shard& t_shard = f_shards[ i_shard ];
+            t_shard.f_writes_started.store( 0, std::memory_order_relaxed );
+            t_shard.f_writes_finished.store( 0, std::memory_order_relaxed );
+            t_shard.f_count.store( 0, std::memory_order_relaxed );
+            t_shard.f_sum.store( 0, std::memory_order_relaxed );
+            t_shard.f_max.store( 0, std::memory_order_relaxed );
+            for( unsigned i_bucket = 0; i_bucket < histogram_snapshot::s_n_buckets; ++i_bucket )
+            {
+                t_shard.f_buckets[ i_bucket ].store( 0, std::memory_order_relaxed );
+            }
+        }
+    }
+
+    histogram_snapshot log_histogram::snapshot() const
+    {
+        const unsigned t_max_tries = 100;
+
+        histogram_snapshot t_snapshot;
+        histogram_snapshot t_shard_snapshot;
+        for( unsigned i_shard = 0; i_shard < k_n_metric_shards; ++i_shard )
+        {
+            const shard& t_shard = f_shards[ i_shard ];
+            for( unsigned i_try = 0; i_try < t_max_tries; ++i_try )
+            {
+                uint64_t t_finished = t_shard.f_writes_finished.load( std::memory_order_acquire );
+                uint64_t t_started = t_shard.f_writes_started.load( std::memory_order_acquire );
+
+                t_shard_snapshot.f_count = t_shard.f_count.load( std::memory_order_relaxed );
+                t_shard_snapshot.f_sum = t_shard.f_sum.load( std::memory_order_relaxed );
+                t_shard_snapshot.f_max = t_shard.f_max.load( std::memory_order_relaxed );
+                for( unsigned i_bucket = 0; i_bucket < histogram_snapshot::s_n_buckets; ++i_bucket )
+                {
+                    t_shard_snapshot.f_buckets[ i_bucket ] = t_shard.f_buckets[ i_bucket ].load( std::memory_order_relaxed );
+                }
+
+                // the data loads can't be moved after this fence
+                std::atomic_thread_fence( std::memory_order_acquire );
+                // clean read: no write was in progress when we started, and no write started since
+                if( t_started == t_finished && t_shard.f_writes_started.load( std::memory_order_relaxed ) == t_started ) break;
+            }
+
+            t_snapshot.f_count += t_shard_snapshot.f_count;
+            t_snapshot.f_sum += t_shard_snapshot.f_sum;
+            if( t_shard_snapshot.f_max > t_snapshot.f_max ) t_snapshot.f_max = t_shard_snapshot.f_max;
+            for( unsigned i_bucket = 0; i_bucket < histogram_snapshot::s_n_buckets; ++i_bucket )
+            {
+                t_snapshot.f_buckets[ i_bucket ] += t_shard_snapshot.f_buckets[ i_bucket ];
+            }
+        }
+        return t_snapshot;
+    }
+
+    //********************
+    // metrics_registry
+    //********************
+
+    metrics_registry& metrics_registry::global()
+    {
+        static metrics_registry s_registry;
+        return s_registry;
+    }
+
+    metrics_registry::key_t metrics_registry::make_key( const std::string& a_name, const metric_labels_t& a_labels )
+    {
+        key_t t_key( a_name, a_labels );
+        std::sort( t_key.second.begin(), t_key.second.end() );
+        return t_key;
+    }
+
+    sharded_counter& metrics_registry::counter( const std::string& a_name, const metric_labels_t& a_labels )
+    {
+        key_t t_key( make_key( a_name, a_labels ) );
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        std::unique_ptr< sharded_counter >& t_counter = f_counters[ t_key ];
+        if( ! t_counter ) t_counter.reset( new sharded_counter() );
+        return *t_counter;
+    }
+
+    gauge& metrics_registry::get_gauge( const std::string& a_name, const metric_labels_t& a_labels )
+    {
+        key_t t_key( make_key( a_name, a_labels ) );
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        std::unique_ptr< gauge >& t_gauge = f_gauges[ t_key ];
+        if( ! t_gauge ) t_gauge.reset( new gauge() );
+        return *t_gauge;
+    }
+
+    log_histogram& metrics_registry::histogram( const std::string& a_name, const metric_labels_t& a_labels )
+    {
+        key_t t_key( make_key( a_name, a_labels ) );
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        std::unique_ptr< log_histogram >& t_histogram = f_histograms[ t_key ];
+        if( ! t_histogram ) t_histogram.reset( new log_histogram() );
+        return *t_histogram;
+    }
+
+    void metrics_registry::for_each_counter( const std::function< void( const std::string&, const metric_labels_t&, uint64_t ) >& a_func ) const
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        for( std::map< key_t, std::unique_ptr< sharded_counter > >::const_iterator t_it = f_counters.begin(); t_it != f_counters.end(); ++t_it )
+        {
+            a_func( t_it->first.first, t_it->first.second, t_it->second->value() );
+        }
+        return;
+    }
+
+    void metrics_registry::for_each_gauge( const std::function< void( const std::string&, const metric_labels_t&, int64_t ) >& a_func ) const
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        for( std::map< key_t, std::unique_ptr< gauge > >::const_iterator t_it = f_gauges.begin(); t_it != f_gauges.end(); ++t_it )
+        {
+            a_func( t_it->first.first, t_it->first.second, t_it->second->value() );
+        }
+        return;
+    }
+
+    void metrics_registry::for_each_histogram( const std::function< void( const std::string&, const metric_labels_t&, const histogram_snapshot& ) >& a_func ) const
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        for( std::map< key_t, std::unique_ptr< log_histogram > >::const_iterator t_it = f_histograms.begin(); t_it != f_histograms.end(); ++t_it )
+        {
+            a_func( t_it->first.first, t_it->first.second, t_it->second->snapshot() );
+        }
+        return;
+    }
+
+} /* namespace sandfly */
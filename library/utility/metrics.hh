@@ -0,0 +1,267 @@
+/*
+ * metrics.hh
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SANDFLY_METRICS_HH_
+#define SANDFLY_METRICS_HH_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace sandfly
+{
+    /*!
+     @file metrics.hh
+
+     @brief Counters, gauges, and histograms that are cheap to record into from data-processing threads
+
+     @details
+     Counters and histograms are sharded: each thread records into one of k_n_metric_shards cache-line-aligned shards
+     (assigned round-robin the first time a thread records anything), so threads don't contend for the same cache line.
+     Recording is a few relaxed atomic operations on the thread's own shard; nothing is locked.
+     Reading sums over the shards, and is meant for status requests and exporters, not for the hot path.
+
+     Histograms use logarithmic buckets: bucket 0 holds the value 0, and bucket i holds values in [2^(i-1), 2^i).
+     A histogram snapshot is read seqlock-style: each shard counts the writes that have started and finished,
+     and the reader retries a shard until no write started or was in progress while it was read,
+     so that the count, sum, max, and buckets of a snapshot are consistent.
+     The max is exact: each shard keeps its largest value with an atomic fetch-max, which only writes when the value is a new max.
+     If a shard is written too often to get a clean read, the last read is used; values are never torn, but the count
+     may be off from the bucket total by the number of concurrent writes.
+
+     metrics_registry holds named metrics so that they can be found by exporters; metrics can also be used on their own.
+     Metrics of the same kind can share a name and be told apart by their labels (e.g. one latency histogram per handler);
+     the name and the labels are kept separately, so exporters never have to parse them out of a name.
+     */
+
+    static const unsigned k_n_metric_shards = 16;
+    static const std::size_t k_cache_line_size = 64;
+
+    /// Returns the shard used by the calling thread
+    unsigned this_thread_metric_shard();
+
+    //*******************
+    // sharded_counter
+    //*******************
+
+    /// Monotonic counter
+    class sharded_counter
+    {
+        public:
+            sharded_counter();
+            sharded_counter( const sharded_counter& ) = delete;
+            sharded_counter& operator=( const sharded_counter& ) = delete;
+
+            void add( uint64_t a_value = 1 );
+
+            uint64_t value() const;
+
+        private:
+            struct alignas( k_cache_line_size ) shard
+            {
+                std::atomic< uint64_t > f_value;
+            };
+            std::array< shard, k_n_metric_shards > f_shards;
+    };
+
+    //*********
+    // gauge
+    //*********
+
+    /// Value that can go up and down (e.g. a queue depth); not sharded, since it's set rather than accumulated
+    class gauge
+    {
+        public:
+            gauge();
+            gauge( const gauge& ) = delete;
+            gauge& operator=( const gauge& ) = delete;
+
+            void set( int64_t a_value );
+            void add( int64_t a_value );
+
+            int64_t value() const;
+
+        private:
+            alignas( k_cache_line_size ) std::atomic< int64_t > f_value;
+    };
+
+    //*****************
+    // log_histogram
+    //*****************
+
+    struct histogram_snapshot
+    {
+        static const unsigned s_n_buckets = 65;
+
+        uint64_t f_count = 0;
+        uint64_t f_sum = 0;
+        uint64_t f_max = 0;
+        std::array< uint64_t, s_n_buckets > f_buckets = {};
+
+        /// Exclusive upper edge of a bucket (the largest value for the last bucket)
+        static uint64_t bucket_upper_bound( unsigned a_bucket );
+
+        /// Estimates the value below which a_fraction (0 to 1) of the recorded values lie; accurate to within a factor of 2
+        double percentile( double a_fraction ) const;
+        double mean() const;
+
+        /// Adds count, sum, mean, p50, p90, p99, and max; values are divided by a_scale
+        void fill( scarab::param_node& a_node, double a_scale = 1. ) const;
+    };
+
+    class log_histogram
+    {
+        public:
+            log_histogram();
+            log_histogram( const log_histogram& ) = delete;
+            log_histogram& operator=( const log_histogram& ) = delete;
+
+            void record( uint64_t a_value );
+
+            histogram_snapshot snapshot() const;
+
+            static unsigned bucket( uint64_t a_value );
+
+        private:
+            struct alignas( k_cache_line_size ) shard
+            {
+                std::atomic< uint64_t > f_writes_started;
+                std::atomic< uint64_t > f_writes_finished;
+                std::atomic< uint64_t > f_count;
+                std::atomic< uint64_t > f_sum;
+                std::atomic< uint64_t > f_max;
+                std::array< std::atomic< uint64_t >, histogram_snapshot::s_n_buckets > f_buckets;
+            };
+            std::array< shard, k_n_metric_shards > f_shards;
+    };
+
+    /// Records the time from construction to destruction, in ns, into a histogram
+    class scoped_timer
+    {
+        public:
+            scoped_timer( log_histogram& a_histogram );
+            ~scoped_timer();
+
+        private:
+            log_histogram& f_histogram;
+            std::chrono::steady_clock::time_point f_start;
+    };
+
+    //********************
+    // metrics_registry
+    //********************
+
+    /// Label names and values, e.g. { {"stream", "s0"}, {"node", "rec"} }
+    typedef std::vector< std::pair< std::string, std::string > > metric_labels_t;
+
+    /// Named metrics; the references returned stay valid for the lifetime of the registry
+    class metrics_registry
+    {
+        public:
+            metrics_registry() = default;
+            metrics_registry( const metrics_registry& ) = delete;
+            metrics_registry& operator=( const metrics_registry& ) = delete;
+
+            /// The registry used by sandfly's components
+            static metrics_registry& global();
+
+            /// Get-or-create; look the metric up once and keep the reference, rather than looking it up on the hot path
+            /// A metric is identified by its name and labels; the order of the labels doesn't matter
+            sharded_counter& counter( const std::string& a_name, const metric_labels_t& a_labels = metric_labels_t() );
+            gauge& get_gauge( const std::string& a_name, const metric_labels_t& a_labels = metric_labels_t() );
+            log_histogram& histogram( const std::string& a_name, const metric_labels_t& a_labels = metric_labels_t() );
+
+            /// Metrics are visited in order of name, so metrics that share a name are visited together; labels are sorted by label name
+            void for_each_counter( const std::function< void( const std::string&, const metric_labels_t&, uint64_t ) >& a_func ) const;
+            void for_each_gauge( const std::function< void( const std::string&, const metric_labels_t&, int64_t ) >& a_func ) const;
+            void for_each_histogram( const std::function< void( const std::string&, const metric_labels_t&, const histogram_snapshot& ) >& a_func ) const;
+
+        private:
+            typedef std::pair< std::string, metric_labels_t > key_t;
+            static key_t make_key( const std::string& a_name, const metric_labels_t& a_labels );
+
+            std::map< key_t, std::unique_ptr< sharded_counter > > f_counters;
+            std::map< key_t, std::unique_ptr< gauge > > f_gauges;
+            std::map< key_t, std::unique_ptr< log_histogram > > f_histograms;
+            mutable std::mutex f_mutex;
+    };
+
+
+    //*******************
+    // Implementations
+    //*******************
+
+    inline void sharded_counter::add( uint64_t a_value )
+    {
+        f_shards[ this_thread_metric_shard() ].f_value.fetch_add( a_value, std::memory_order_relaxed );
+        return;
+    }
+
+    inline void gauge::set( int64_t a_value )
+    {
+        f_value.store( a_value, std::memory_order_relaxed );
+        return;
+    }
+
+    inline void gauge::add( int64_t a_value )
+    {
+        f_value.fetch_add( a_value, std::memory_order_relaxed );
+        return;
+    }
+
+    inline int64_t gauge::value() const
+    {
+        return f_value.load( std::memory_order_relaxed );
+    }
+
+    inline unsigned log_histogram::bucket( uint64_t a_value )
+    {
+        return a_value == 0 ? 0 : 64 - __builtin_clzll( a_value );
+    }
+
+    inline void log_histogram::record( uint64_t a_value )
+    {
+        shard& t_shard = f_shards[ this_thread_metric_shard() ];
+        // seqlock-style writer: the fence keeps the data updates after the start count, and the release keeps them before the finish count, as seen by the reader
+        t_shard.f_writes_started.fetch_add( 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        t_shard.f_count.fetch_add( 1, std::memory_order_relaxed );
+        t_shard.f_sum.fetch_add( a_value, std::memory_order_relaxed );
+        // fetch-max; the shard's max rarely changes, so this is usually just the load
+        uint64_t t_max = t_shard.f_max.load( std::memory_order_relaxed );
+        while( a_value > t_max && ! t_shard.f_max.compare_exchange_weak( t_max, a_value, std::memory_order_relaxed ) ) {}
+        t_shard.f_buckets[ bucket( a_value ) ].fetch_add( 1, std::memory_order_relaxed );
+        t_shard.f_writes_finished.fetch_add( 1, std::memory_order_release );
+        return;
+    }
+
+    inline scoped_timer::scoped_timer( log_histogram& a_histogram ) :
+            f_histogram( a_histogram ),
+            f_start( std::chrono::steady_clock::now() )
+    {}
+
+    inline scoped_timer::~scoped_timer()
+    {
+        f_histogram.record( std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - f_start ).count() );
+    }
+
+} /* namespace sandfly */
+
+#endif /* SANDFLY_METRICS_HH_ */
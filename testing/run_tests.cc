@@ -0,0 +1,10 @@
+/*
+ * run_tests.cc
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Catch's main() for the sandfly unit tests; the tests are in the test_*.cc files
+ */
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
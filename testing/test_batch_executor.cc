@@ -0,0 +1,150 @@
+/*
+ * test_batch_executor.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "batch_executor.hh"
+#include "sandfly_error.hh"
+
+#include "catch2/catch.hpp"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+
+using sandfly::action_info;
+
+namespace
+{
+    // runs the scheduler on its own, recording the order in which the actions are executed instead of submitting requests
+    class recording_batch_executor : public sandfly::batch_executor
+    {
+        public:
+            typedef std::chrono::steady_clock::time_point time_point_t;
+
+            recording_batch_executor()
+            {
+                set_max_concurrent_actions( 1 );
+            }
+
+            void queue( const std::vector< action_info >& a_actions )
+            {
+                queue_actions( a_actions );
+                return;
+            }
+
+            void run()
+            {
+                scheduled_action t_action;
+                unsigned t_generation = 0;
+                while( wait_for_action( t_action, t_generation, false ) )
+                {
+                    start_action( t_action, t_generation );
+                }
+                finish_running_actions();
+                return;
+            }
+
+            std::vector< std::string > order() const
+            {
+                std::unique_lock< std::mutex > t_lock( f_record_mutex );
+                return f_order;
+            }
+
+            time_point_t start_time( const std::string& a_id ) const
+            {
+                std::unique_lock< std::mutex > t_lock( f_record_mutex );
+                return f_start_times.at( a_id );
+            }
+
+        private:
+            virtual void do_an_action( const action_info& a_action, unsigned )
+            {
+                std::unique_lock< std::mutex > t_lock( f_record_mutex );
+                f_order.push_back( a_action.f_id );
+                f_start_times[ a_action.f_id ] = std::chrono::steady_clock::now();
+                return;
+            }
+
+            std::vector< std::string > f_order;
+            std::map< std::string, time_point_t > f_start_times;
+            mutable std::mutex f_record_mutex;
+    };
+
+    // an action that doesn't wait for anything unless a_after is given
+    action_info make_action( const std::string& a_id, int a_priority = 0, const std::vector< std::string >& a_after = std::vector< std::string >(),
+            unsigned a_delay_ms = 0, unsigned a_sleep_ms = 0 )
+    {
+        action_info t_action;
+        t_action.f_is_custom_action = false;
+        t_action.f_sleep_duration_ms = a_sleep_ms;
+        t_action.f_delay_ms = a_delay_ms;
+        t_action.f_priority = a_priority;
+        t_action.f_id = a_id;
+        t_action.f_after = a_after;
+        t_action.f_after_previous = false;
+        return t_action;
+    }
+
+    // an action that waits for the previously queued action, as when "after" is not given
+    action_info make_sequential_action( const std::string& a_id, int a_priority = 0 )
+    {
+        action_info t_action = make_action( a_id, a_priority );
+        t_action.f_after_previous = true;
+        return t_action;
+    }
+}
+
+TEST_CASE( "batch actions are sequential by default", "[batch_executor]" )
+{
+    recording_batch_executor t_executor;
+    t_executor.queue( { make_sequential_action( "g" ), make_sequential_action( "h", 9 ), make_sequential_action( "i", 5 ) } );
+    t_executor.run();
+    REQUIRE( t_executor.order() == std::vector< std::string >{ "g", "h", "i" } );
+    REQUIRE( t_executor.queue_size() == 0 );
+}
+
+TEST_CASE( "ready batch actions are executed by priority, then in the order they were queued", "[batch_executor]" )
+{
+    recording_batch_executor t_executor;
+    t_executor.queue( { make_action( "a" ), make_action( "b", 5 ), make_action( "c", 5 ), make_sequential_action( "d" ) } );
+    t_executor.run();
+    // d waits for c; when it's released, a was queued earlier with the same priority
+    REQUIRE( t_executor.order() == std::vector< std::string >{ "b", "c", "a", "d" } );
+}
+
+TEST_CASE( "batch actions wait for their dependencies", "[batch_executor]" )
+{
+    recording_batch_executor t_executor;
+    t_executor.queue( { make_action( "config-0" ), make_action( "config-1" ), make_action( "start", 10, { "config-0", "config-1" } ), make_action( "other", 1 ) } );
+    t_executor.run();
+    REQUIRE( t_executor.order() == std::vector< std::string >{ "other", "config-0", "config-1", "start" } );
+}
+
+TEST_CASE( "a delayed batch action doesn't hold back ready actions", "[batch_executor]" )
+{
+    recording_batch_executor t_executor;
+    std::chrono::steady_clock::time_point t_queued = std::chrono::steady_clock::now();
+    t_executor.queue( { make_action( "e", 10, {}, 50 ), make_action( "f" ) } );
+    t_executor.run();
+    REQUIRE( t_executor.order() == std::vector< std::string >{ "f", "e" } );
+    REQUIRE( t_executor.start_time( "e" ) - t_queued >= std::chrono::milliseconds( 50 ) );
+}
+
+TEST_CASE( "a post-action sleep only holds back the action's dependents", "[batch_executor]" )
+{
+    recording_batch_executor t_executor;
+    t_executor.queue( { make_action( "x", 0, {}, 0, 50 ), make_action( "y", 10, { "x" } ), make_action( "z" ) } );
+    t_executor.run();
+    REQUIRE( t_executor.order() == std::vector< std::string >{ "x", "z", "y" } );
+    REQUIRE( t_executor.start_time( "y" ) - t_executor.start_time( "x" ) >= std::chrono::milliseconds( 50 ) );
+}
+
+TEST_CASE( "batch actions can't depend on unknown actions", "[batch_executor]" )
+{
+    recording_batch_executor t_executor;
+    REQUIRE_THROWS_AS( t_executor.queue( { make_action( "a" ), make_action( "b", 0, { "c" } ) } ), sandfly::error );
+    // nothing was queued
+    REQUIRE( t_executor.queue_size() == 0 );
+}
@@ -0,0 +1,61 @@
+/*
+ * test_config_key_index.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "node_config_schema.hh"
+
+#include "catch2/catch.hpp"
+
+#include <sstream>
+
+using sandfly::config_key_index;
+
+TEST_CASE( "config_key_index finds each key at its position", "[config_key_index]" )
+{
+    std::vector< std::string > t_keys;
+    for( unsigned i_key = 0; i_key < 100; ++i_key )
+    {
+        std::stringstream t_key;
+        t_key << "param-" << i_key;
+        t_keys.push_back( t_key.str() );
+    }
+    t_keys.push_back( "" );
+    t_keys.push_back( "rate" );
+
+    config_key_index t_index;
+    t_index.build( t_keys );
+
+    for( unsigned i_key = 0; i_key < t_keys.size(); ++i_key )
+    {
+        REQUIRE( t_index.find( t_keys[ i_key ] ) == int(i_key) );
+    }
+
+    REQUIRE( t_index.find( "param-100" ) == -1 );
+    REQUIRE( t_index.find( "Rate" ) == -1 );
+    REQUIRE( t_index.find( "rate " ) == -1 );
+}
+
+TEST_CASE( "config_key_index with no keys", "[config_key_index]" )
+{
+    config_key_index t_unbuilt;
+    REQUIRE( t_unbuilt.find( "rate" ) == -1 );
+
+    config_key_index t_empty;
+    t_empty.build( std::vector< std::string >() );
+    REQUIRE( t_empty.find( "rate" ) == -1 );
+    REQUIRE( t_empty.find( "" ) == -1 );
+}
+
+TEST_CASE( "config_key_index can be rebuilt", "[config_key_index]" )
+{
+    config_key_index t_index;
+    t_index.build( std::vector< std::string >{ "a", "b" } );
+    REQUIRE( t_index.find( "b" ) == 1 );
+
+    t_index.build( std::vector< std::string >{ "b", "c", "d" } );
+    REQUIRE( t_index.find( "a" ) == -1 );
+    REQUIRE( t_index.find( "b" ) == 0 );
+    REQUIRE( t_index.find( "d" ) == 2 );
+}
@@ -0,0 +1,96 @@
+/*
+ * test_connection_graph.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "connection_graph.hh"
+#include "sandfly_error.hh"
+
+#include "catch2/catch.hpp"
+
+using sandfly::connection_graph;
+using sandfly::stream_connection;
+
+TEST_CASE( "stream_connection::parse", "[connection_graph]" )
+{
+    stream_connection t_connection = stream_connection::parse( "tfr.out_0:fft.in_0" );
+    REQUIRE( t_connection.f_source_node == "tfr" );
+    REQUIRE( t_connection.f_source_port == "out_0" );
+    REQUIRE( t_connection.f_sink_node == "fft" );
+    REQUIRE( t_connection.f_sink_port == "in_0" );
+
+    // the port is everything after the first '.'
+    REQUIRE( stream_connection::parse( "a.x.y:b.z" ).f_source_port == "x.y" );
+
+    REQUIRE_THROWS_AS( stream_connection::parse( "tfr.out_0" ), sandfly::error );
+    REQUIRE_THROWS_AS( stream_connection::parse( "tfr.out_0:fft.in_0:x.y" ), sandfly::error );
+    REQUIRE_THROWS_AS( stream_connection::parse( "tfr:fft.in_0" ), sandfly::error );
+    REQUIRE_THROWS_AS( stream_connection::parse( ".out_0:fft.in_0" ), sandfly::error );
+    REQUIRE_THROWS_AS( stream_connection::parse( "tfr.out_0:fft." ), sandfly::error );
+}
+
+TEST_CASE( "connection_graph::validate", "[connection_graph]" )
+{
+    const std::set< std::string > t_nodes{ "a", "b", "c", "d" };
+
+    SECTION( "a tree with fan-out is valid" )
+    {
+        connection_graph t_graph;
+        t_graph.add( "a.out_0:b.in_0" );
+        t_graph.add( "a.out_1:c.in_0" );
+        t_graph.add( "b.out_0:d.in_0" );
+        t_graph.add( "c.out_0:d.in_1" );
+        REQUIRE( t_graph.edges().size() == 4 );
+        REQUIRE_NOTHROW( t_graph.validate( t_nodes ) );
+    }
+
+    SECTION( "an output can feed several inputs" )
+    {
+        connection_graph t_graph;
+        t_graph.add( "a.out_0:b.in_0" );
+        t_graph.add( "a.out_0:c.in_0" );
+        REQUIRE_NOTHROW( t_graph.validate( t_nodes ) );
+    }
+
+    SECTION( "an input with two connections is invalid" )
+    {
+        connection_graph t_graph;
+        t_graph.add( "a.out_0:c.in_0" );
+        t_graph.add( "b.out_0:c.in_0" );
+        REQUIRE_THROWS_AS( t_graph.validate( t_nodes ), sandfly::error );
+    }
+
+    SECTION( "the same connection given twice is invalid" )
+    {
+        connection_graph t_graph;
+        t_graph.add( "a.out_0:b.in_0" );
+        t_graph.add( "a.out_0:b.in_0" );
+        REQUIRE_THROWS_AS( t_graph.validate( t_nodes ), sandfly::error );
+    }
+
+    SECTION( "cycles are invalid" )
+    {
+        connection_graph t_loop;
+        t_loop.add( "a.out_0:a.in_0" );
+        REQUIRE_THROWS_AS( t_loop.validate( t_nodes ), sandfly::error );
+
+        connection_graph t_cycle;
+        t_cycle.add( "a.out_0:b.in_0" );
+        t_cycle.add( "b.out_0:c.in_0" );
+        t_cycle.add( "c.out_0:d.in_0" );
+        t_cycle.add( "d.out_0:b.in_1" );
+        REQUIRE_THROWS_AS( t_cycle.validate( t_nodes ), sandfly::error );
+    }
+
+    SECTION( "connections to unknown nodes are invalid" )
+    {
+        connection_graph t_source;
+        t_source.add( "x.out_0:a.in_0" );
+        REQUIRE_THROWS_AS( t_source.validate( t_nodes ), sandfly::error );
+
+        connection_graph t_sink;
+        t_sink.add( "a.out_0:x.in_0" );
+        REQUIRE_THROWS_AS( t_sink.validate( t_nodes ), sandfly::error );
+    }
+}
@@ -0,0 +1,42 @@
+/*
+ * test_cpu_list.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "thread_placement.hh"
+#include "sandfly_error.hh"
+
+#include "catch2/catch.hpp"
+
+using sandfly::parse_cpu_list;
+using sandfly::format_cpu_list;
+
+TEST_CASE( "parse_cpu_list", "[thread_placement]" )
+{
+    REQUIRE( parse_cpu_list( "3" ) == std::vector< unsigned >{ 3 } );
+    REQUIRE( parse_cpu_list( "0-3,8,10-11" ) == std::vector< unsigned >{ 0, 1, 2, 3, 8, 10, 11 } );
+    REQUIRE( parse_cpu_list( "5-5" ) == std::vector< unsigned >{ 5 } );
+
+    // spaces are ignored, and the result is sorted without duplicates
+    REQUIRE( parse_cpu_list( " 8, 2-4 ,3" ) == std::vector< unsigned >{ 2, 3, 4, 8 } );
+
+    REQUIRE_THROWS_AS( parse_cpu_list( "" ), sandfly::error );
+    REQUIRE_THROWS_AS( parse_cpu_list( "a" ), sandfly::error );
+    REQUIRE_THROWS_AS( parse_cpu_list( "-1" ), sandfly::error );
+    REQUIRE_THROWS_AS( parse_cpu_list( "1,,2" ), sandfly::error );
+    REQUIRE_THROWS_AS( parse_cpu_list( "4-2" ), sandfly::error );
+    REQUIRE_THROWS_AS( parse_cpu_list( "0-" ), sandfly::error );
+    REQUIRE_THROWS_AS( parse_cpu_list( "1.5" ), sandfly::error );
+    REQUIRE_THROWS_AS( parse_cpu_list( "100000" ), sandfly::error );
+}
+
+TEST_CASE( "format_cpu_list", "[thread_placement]" )
+{
+    REQUIRE( format_cpu_list( std::vector< unsigned >() ) == "" );
+    REQUIRE( format_cpu_list( std::vector< unsigned >{ 3 } ) == "3" );
+    REQUIRE( format_cpu_list( std::vector< unsigned >{ 0, 1, 2, 3, 8, 10, 11 } ) == "0-3,8,10-11" );
+
+    // formatting and parsing are inverses
+    REQUIRE( parse_cpu_list( format_cpu_list( std::vector< unsigned >{ 1, 2, 5, 7, 8, 9 } ) ) == std::vector< unsigned >{ 1, 2, 5, 7, 8, 9 } );
+}
@@ -0,0 +1,58 @@
+/*
+ * test_name_registry.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "name_registry.hh"
+
+#include "sandfly_error.hh"
+
+#include "catch2/catch.hpp"
+
+using sandfly::name_registry;
+using sandfly::node_id_t;
+using sandfly::stream_id_t;
+
+TEST_CASE( "name_registry interns stream and node names", "[name_registry]" )
+{
+    name_registry t_names;
+    stream_id_t t_stream = t_names.intern_stream( "str0" );
+    node_id_t t_node = t_names.intern_node( t_stream, "tf" );
+
+    REQUIRE( t_names.intern_stream( "str0" ) == t_stream );
+    REQUIRE( t_names.intern_node( t_stream, "tf" ) == t_node );
+    REQUIRE( t_names.find_node( "str0", "tf" ) == t_node );
+    REQUIRE( t_names.find_node( "str0_tf" ) == t_node );
+    REQUIRE( t_names.full_node_name( t_node ) == "str0_tf" );
+    REQUIRE( t_names.node_stream( t_node ) == t_stream );
+    REQUIRE( t_names.find_node( "str1_tf" ) == name_registry::s_invalid_id );
+    REQUIRE_THROWS_AS( t_names.node_name( t_node + 1 ), sandfly::error );
+}
+
+TEST_CASE( "name_registry full names can be released", "[name_registry]" )
+{
+    name_registry t_names;
+    stream_id_t t_old_stream = t_names.intern_stream( "a_b" );
+    node_id_t t_old_node = t_names.intern_node( t_old_stream, "c" );
+    stream_id_t t_new_stream = t_names.intern_stream( "a" );
+
+    // both nodes would be "a_b_c"
+    REQUIRE_THROWS_AS( t_names.intern_node( t_new_stream, "b_c" ), sandfly::error );
+
+    t_names.release_stream( t_old_stream );
+    REQUIRE( t_names.find_node( "a_b_c" ) == name_registry::s_invalid_id );
+    // the released node's ID and names stay valid
+    REQUIRE( t_names.full_node_name( t_old_node ) == "a_b_c" );
+
+    node_id_t t_new_node = t_names.intern_node( t_new_stream, "b_c" );
+    REQUIRE( t_new_node != t_old_node );
+    REQUIRE( t_names.find_node( "a_b_c" ) == t_new_node );
+
+    // the old stream can't claim its full name back while another node has it
+    REQUIRE_THROWS_AS( t_names.intern_node( t_old_stream, "c" ), sandfly::error );
+
+    t_names.release_stream( t_new_stream );
+    REQUIRE( t_names.intern_node( t_old_stream, "c" ) == t_old_node );
+    REQUIRE( t_names.find_node( "a_b_c" ) == t_old_node );
+}
@@ -0,0 +1,154 @@
+/*
+ * test_node_config_schema.cc
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "node_config_schema.hh"
+#include "node_config_table.hh"
+
+#include "param.hh"
+
+#include "catch2/catch.hpp"
+
+using sandfly::config_field_table;
+using sandfly::config_type;
+using sandfly::node_config_schema;
+using sandfly::typed_node_config;
+
+namespace
+{
+    void define_schema( node_config_schema& a_schema )
+    {
+        a_schema.add( "rate", config_type::real ).range( 0., 1.e9 ).default_value( scarab::param_value( 100. ) );
+        a_schema.add( "n-channels", config_type::unsigned_integer ).required();
+        a_schema.add( "offset", config_type::integer ).default_value( scarab::param_value( -5 ) );
+        a_schema.add( "enabled", config_type::boolean );
+        a_schema.add( "label", config_type::string ).default_value( scarab::param_value( "none" ) );
+        return;
+    }
+
+    struct narrow_node
+    {
+        uint16_t f_count = 0;
+        int8_t f_offset = 0;
+        void set_count( uint16_t a_count ) { f_count = a_count; }
+        uint16_t get_count() const { return f_count; }
+        void set_offset( int8_t a_offset ) { f_offset = a_offset; }
+        int8_t get_offset() const { return f_offset; }
+    };
+}
+
+TEST_CASE( "node_config_schema::convert", "[node_config_schema]" )
+{
+    node_config_schema t_schema;
+    define_schema( t_schema );
+
+    SECTION( "values are converted to the fields' types, and defaults are filled in" )
+    {
+        scarab::param_node t_config;
+        t_config.add( "n-channels", scarab::param_value( 4 ) ); // a signed integer in the config
+        t_config.add( "rate", scarab::param_value( 250 ) ); // an integer for a real field
+        t_config.add( "device", scarab::param_node() ); // ignored by default
+
+        typed_node_config t_typed = t_schema.convert( t_config );
+        REQUIRE_FALSE( t_typed.empty() );
+        REQUIRE( t_typed.schema() == &t_schema );
+
+        REQUIRE( t_typed.get< uint64_t >( t_schema.index_of( "n-channels" ) ) == 4 );
+        REQUIRE( t_typed.get< double >( t_schema.index_of( "rate" ) ) == Approx( 250. ) );
+        REQUIRE( t_typed.get< int64_t >( t_schema.index_of( "offset" ) ) == -5 );
+        REQUIRE( t_typed.get< std::string >( t_schema.index_of( "label" ) ) == "none" );
+        // no value and no default
+        REQUIRE_FALSE( t_typed.has( t_schema.index_of( "enabled" ) ) );
+        REQUIRE_THROWS_AS( t_typed.get< bool >( t_schema.index_of( "enabled" ) ), sandfly::error );
+        // the wrong type
+        REQUIRE_THROWS_AS( t_typed.get< double >( t_schema.index_of( "n-channels" ) ), sandfly::error );
+    }
+
+    SECTION( "the converted config can be turned back into a param_node" )
+    {
+        scarab::param_node t_config;
+        t_config.add( "n-channels", scarab::param_value( 2U ) );
+        scarab::param_node t_param;
+        t_schema.convert( t_config ).to_param( t_param );
+        REQUIRE( t_param.has( "n-channels" ) );
+        REQUIRE( t_param.has( "rate" ) );
+        REQUIRE( t_param.has( "offset" ) );
+        REQUIRE( t_param.has( "label" ) );
+        REQUIRE_FALSE( t_param.has( "enabled" ) );
+        REQUIRE( t_param["rate"]().as_double() == Approx( 100. ) );
+    }
+
+    SECTION( "a missing required field is an error" )
+    {
+        scarab::param_node t_config;
+        REQUIRE_THROWS_AS( t_schema.convert( t_config ), sandfly::error );
+        // validate() accepts a partial config
+        REQUIRE_NOTHROW( t_schema.validate( t_config ) );
+    }
+
+    SECTION( "unknown keys, wrong types, and values out of range are errors" )
+    {
+        scarab::param_node t_unknown;
+        t_unknown.add( "n-channels", scarab::param_value( 1U ) );
+        t_unknown.add( "colour", scarab::param_value( "blue" ) );
+        REQUIRE_THROWS_AS( t_schema.convert( t_unknown ), sandfly::error );
+
+        scarab::param_node t_negative;
+        t_negative.add( "n-channels", scarab::param_value( -1 ) );
+        REQUIRE_THROWS_AS( t_schema.convert( t_negative ), sandfly::error );
+
+        scarab::param_node t_string;
+        t_string.add( "n-channels", scarab::param_value( 1U ) );
+        t_string.add( "enabled", scarab::param_value( "yes" ) );
+        REQUIRE_THROWS_AS( t_schema.convert( t_string ), sandfly::error );
+
+        scarab::param_node t_out_of_range;
+        t_out_of_range.add( "n-channels", scarab::param_value( 1U ) );
+        t_out_of_range.add( "rate", scarab::param_value( -1. ) );
+        REQUIRE_THROWS_AS( t_schema.convert( t_out_of_range ), sandfly::error );
+    }
+}
+
+TEST_CASE( "node_config_schema fields", "[node_config_schema]" )
+{
+    node_config_schema t_schema;
+    define_schema( t_schema );
+
+    REQUIRE( t_schema.fields().size() == 5 );
+    REQUIRE( t_schema.find( "rate" ) == 0 );
+    REQUIRE( t_schema.find( "label" ) == 4 );
+    REQUIRE( t_schema.find( "colour" ) == -1 );
+    REQUIRE_THROWS_AS( t_schema.index_of( "colour" ), sandfly::error );
+
+    // duplicate fields and defaults that don't fit are rejected
+    REQUIRE_THROWS_AS( t_schema.add( "rate", config_type::real ), sandfly::error );
+    REQUIRE_THROWS_AS( t_schema.add( "gain", config_type::real ).min( 1. ).default_value( scarab::param_value( 0.5 ) ), sandfly::error );
+}
+
+TEST_CASE( "config_field_table limits narrow integers to their type", "[node_config_schema]" )
+{
+    config_field_table< narrow_node > t_table;
+    t_table.field( "count", &narrow_node::set_count, &narrow_node::get_count );
+    t_table.field( "offset", &narrow_node::set_offset, &narrow_node::get_offset ).range( -1000., 10. );
+    const node_config_schema& t_schema = t_table.schema();
+
+    scarab::param_node t_in_range;
+    t_in_range.add( "count", scarab::param_value( 65535U ) );
+    t_in_range.add( "offset", scarab::param_value( -128 ) );
+    REQUIRE_NOTHROW( t_schema.convert( t_in_range ) );
+
+    scarab::param_node t_too_big;
+    t_too_big.add( "count", scarab::param_value( 65536U ) );
+    REQUIRE_THROWS_AS( t_schema.convert( t_too_big ), sandfly::error );
+
+    // a wider explicit range is narrowed to the type's
+    scarab::param_node t_too_small;
+    t_too_small.add( "offset", scarab::param_value( -129 ) );
+    REQUIRE_THROWS_AS( t_schema.convert( t_too_small ), sandfly::error );
+
+    scarab::param_node t_above_explicit;
+    t_above_explicit.add( "offset", scarab::param_value( 11 ) );
+    REQUIRE_THROWS_AS( t_schema.convert( t_above_explicit ), sandfly::error );
+}